@@ -0,0 +1,48 @@
+#include "pch.h"
+#include "CpuFeatures.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace Gaia
+{
+	namespace CpuFeatures
+	{
+		bool hasSsse3()
+		{
+			static const bool supported = [] {
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 1);
+				return (info[2] & (1 << 9)) != 0;
+#else
+				return __builtin_cpu_supports("ssse3") != 0;
+#endif
+			}();
+			return supported;
+		}
+
+		bool hasAvx2()
+		{
+			static const bool supported = [] {
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+				__cpuid(info, 1);
+				const bool osxsave = (info[2] & (1 << 27)) != 0;
+				const bool avx = (info[2] & (1 << 28)) != 0;
+				if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+					return false;
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				return __builtin_cpu_supports("avx2") != 0;
+#endif
+			}();
+			return supported;
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+//SSSE3 / AVX2 code is only compiled for the functions that use it and picked at runtime, the rest of the engine stays SSE2
+#if defined(_MSC_VER) && !defined(__clang__)
+#define GAIA_TARGET_SSSE3
+#define GAIA_TARGET_AVX2
+#else
+#define GAIA_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define GAIA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Gaia
+{
+	//instruction set extensions of the executing cpu, queried once
+	namespace CpuFeatures
+	{
+		bool hasSsse3();
+		bool hasAvx2();
+	}
+}
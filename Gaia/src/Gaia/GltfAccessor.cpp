@@ -0,0 +1,326 @@
+#include "pch.h"
+#include "GltfAccessor.h"
+#include "Gaia/GltfLoader/tiny_gltf.h"
+#include "CpuFeatures.h"
+#include <immintrin.h>
+
+namespace Gaia
+{
+	namespace GltfAccessor
+	{
+		template <typename T>
+		static void convertScalar(const uint8_t* src, size_t first, size_t numScalars, float scale, bool clampNegative, float* dst)
+		{
+			for (size_t i = first; i < numScalars; i++)
+			{
+				T value;
+				memcpy(&value, src + i * sizeof(T), sizeof(T));
+				float result = static_cast<float>(value) * scale;
+				dst[i] = clampNegative ? std::max(result, -1.0f) : result;
+			}
+		}
+
+		//widens 8 x 16 bit integers to floats per iteration
+		static size_t convert16Sse2(const uint8_t* src, size_t numScalars, bool isSigned, float scale, bool clampNegative, float* dst)
+		{
+			const __m128 vScale = _mm_set1_ps(scale);
+			const __m128 minusOne = _mm_set1_ps(-1.0f);
+			const __m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+			for (; i + 8 <= numScalars; i += 8)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+				__m128i lo = isSigned ? _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16) : _mm_unpacklo_epi16(v, zero);
+				__m128i hi = isSigned ? _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16) : _mm_unpackhi_epi16(v, zero);
+				__m128 fLo = _mm_mul_ps(_mm_cvtepi32_ps(lo), vScale);
+				__m128 fHi = _mm_mul_ps(_mm_cvtepi32_ps(hi), vScale);
+				if (clampNegative)
+				{
+					fLo = _mm_max_ps(fLo, minusOne);
+					fHi = _mm_max_ps(fHi, minusOne);
+				}
+				_mm_storeu_ps(dst + i, fLo);
+				_mm_storeu_ps(dst + i + 4, fHi);
+			}
+			return i;
+		}
+
+		//widens 16 x 8 bit integers to floats per iteration
+		static size_t convert8Sse2(const uint8_t* src, size_t numScalars, bool isSigned, float scale, bool clampNegative, float* dst)
+		{
+			const __m128 vScale = _mm_set1_ps(scale);
+			const __m128 minusOne = _mm_set1_ps(-1.0f);
+			const __m128i zero = _mm_setzero_si128();
+			size_t i = 0;
+			for (; i + 16 <= numScalars; i += 16)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i words[2] = {
+					isSigned ? _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8) : _mm_unpacklo_epi8(v, zero),
+					isSigned ? _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8) : _mm_unpackhi_epi8(v, zero),
+				};
+				for (int half = 0; half < 2; half++)
+				{
+					__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(words[half], words[half]), 16);
+					__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(words[half], words[half]), 16);
+					__m128 fLo = _mm_mul_ps(_mm_cvtepi32_ps(lo), vScale);
+					__m128 fHi = _mm_mul_ps(_mm_cvtepi32_ps(hi), vScale);
+					if (clampNegative)
+					{
+						fLo = _mm_max_ps(fLo, minusOne);
+						fHi = _mm_max_ps(fHi, minusOne);
+					}
+					_mm_storeu_ps(dst + i + half * 8, fLo);
+					_mm_storeu_ps(dst + i + half * 8 + 4, fHi);
+				}
+			}
+			return i;
+		}
+
+		//widens 8 integers of ComponentType to floats per iteration
+		template <int ComponentType>
+		GAIA_TARGET_AVX2 static size_t convertAvx2(const uint8_t* src, size_t numScalars, float scale, bool clampNegative, float* dst)
+		{
+			const __m256 vScale = _mm256_set1_ps(scale);
+			const __m256 minusOne = _mm256_set1_ps(-1.0f);
+			size_t i = 0;
+			for (; i + 8 <= numScalars; i += 8)
+			{
+				__m256i v;
+				if constexpr (ComponentType == TINYGLTF_COMPONENT_TYPE_BYTE)
+					v = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+				else if constexpr (ComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+					v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+				else if constexpr (ComponentType == TINYGLTF_COMPONENT_TYPE_SHORT)
+					v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+				else
+					v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+
+				__m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(v), vScale);
+				if (clampNegative)
+					f = _mm256_max_ps(f, minusOne);
+				_mm256_storeu_ps(dst + i, f);
+			}
+			return i;
+		}
+
+		uint32_t numComponents(const tinygltf::Accessor& accessor)
+		{
+			int32_t components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+			return components > 0 ? static_cast<uint32_t>(components) : 0;
+		}
+
+		void convertToFloat(const void* src, int componentType, bool normalized, size_t numScalars, float* dst)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(src);
+			const bool avx2 = CpuFeatures::hasAvx2();
+			size_t done = 0;
+			switch (componentType)
+			{
+			case TINYGLTF_COMPONENT_TYPE_FLOAT:
+				memcpy(dst, bytes, numScalars * sizeof(float));
+				break;
+			case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+				convertScalar<double>(bytes, 0, numScalars, 1.0f, false, dst);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_INT:
+				convertScalar<int32_t>(bytes, 0, numScalars, 1.0f, false, dst);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+				convertScalar<uint32_t>(bytes, 0, numScalars, 1.0f, false, dst);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_BYTE:
+			{
+				//normalized signed integers are clamped so that both -128 and -127 map to -1
+				const float scale = normalized ? 1.0f / 127.0f : 1.0f;
+				done = avx2 ? convertAvx2<TINYGLTF_COMPONENT_TYPE_BYTE>(bytes, numScalars, scale, normalized, dst)
+					: convert8Sse2(bytes, numScalars, true, scale, normalized, dst);
+				convertScalar<int8_t>(bytes, done, numScalars, scale, normalized, dst);
+				break;
+			}
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			{
+				const float scale = normalized ? 1.0f / 255.0f : 1.0f;
+				done = avx2 ? convertAvx2<TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE>(bytes, numScalars, scale, false, dst)
+					: convert8Sse2(bytes, numScalars, false, scale, false, dst);
+				convertScalar<uint8_t>(bytes, done, numScalars, scale, false, dst);
+				break;
+			}
+			case TINYGLTF_COMPONENT_TYPE_SHORT:
+			{
+				const float scale = normalized ? 1.0f / 32767.0f : 1.0f;
+				done = avx2 ? convertAvx2<TINYGLTF_COMPONENT_TYPE_SHORT>(bytes, numScalars, scale, normalized, dst)
+					: convert16Sse2(bytes, numScalars, true, scale, normalized, dst);
+				convertScalar<int16_t>(bytes, done, numScalars, scale, normalized, dst);
+				break;
+			}
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			{
+				const float scale = normalized ? 1.0f / 65535.0f : 1.0f;
+				done = avx2 ? convertAvx2<TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT>(bytes, numScalars, scale, false, dst)
+					: convert16Sse2(bytes, numScalars, false, scale, false, dst);
+				convertScalar<uint16_t>(bytes, done, numScalars, scale, false, dst);
+				break;
+			}
+			default:
+				memset(dst, 0, numScalars * sizeof(float));
+				break;
+			}
+		}
+
+		void convertToUint32(const void* src, int componentType, size_t numScalars, uint32_t* dst)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(src);
+			size_t i = 0;
+			switch (componentType)
+			{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+				memcpy(dst, bytes, numScalars * sizeof(uint32_t));
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			{
+				const __m128i zero = _mm_setzero_si128();
+				for (; i + 8 <= numScalars; i += 8)
+				{
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * 2));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(v, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(v, zero));
+				}
+				for (; i < numScalars; i++)
+				{
+					uint16_t value;
+					memcpy(&value, bytes + i * 2, sizeof(value));
+					dst[i] = value;
+				}
+				break;
+			}
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				for (; i < numScalars; i++)
+				{
+					dst[i] = bytes[i];
+				}
+				break;
+			default:
+				memset(dst, 0, numScalars * sizeof(uint32_t));
+				break;
+			}
+		}
+
+		//start of `count` elements of a buffer view, nullptr if any of them lies outside the view or its buffer
+		static const uint8_t* getViewData(const tinygltf::Model& model, BufferTable buffers, int bufferViewIndex, size_t byteOffset,
+			size_t stride, size_t elementSize, size_t count)
+		{
+			if (bufferViewIndex < 0 || static_cast<size_t>(bufferViewIndex) >= model.bufferViews.size())
+				return nullptr;
+			const tinygltf::BufferView& view = model.bufferViews[bufferViewIndex];
+			if (view.buffer < 0 || static_cast<size_t>(view.buffer) >= buffers.size())
+				return nullptr;
+
+			const std::span<const uint8_t> buffer = buffers[view.buffer];
+			const size_t required = count == 0 ? 0 : (count - 1) * stride + elementSize;
+			if (view.byteOffset > buffer.size() || view.byteLength > buffer.size() - view.byteOffset ||
+				byteOffset > view.byteLength || required > view.byteLength - byteOffset)
+				return nullptr;
+			return buffer.data() + view.byteOffset + byteOffset;
+		}
+
+		//shared by the float and index paths, convert(src, componentType, numScalars, dst) turns packed components into T
+		template <typename T, typename Convert>
+		static bool decodeAccessor(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, T* out, Convert convert)
+		{
+			const size_t components = numComponents(accessor);
+			const int32_t componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+			if (components == 0 || componentSize <= 0)
+				return false;
+			const size_t elementSize = components * componentSize;
+
+			if (accessor.bufferView < 0)
+			{
+				//only valid for sparse accessors, every element that is not substituted is zero
+				std::fill_n(out, accessor.count * components, T(0));
+			}
+			else
+			{
+				if (static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size())
+					return false;
+				const int stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+				if (stride <= 0)
+					return false;
+				const uint8_t* data = getViewData(model, buffers, accessor.bufferView, accessor.byteOffset, stride, elementSize, accessor.count);
+				if (!data)
+					return false;
+
+				if (static_cast<size_t>(stride) == elementSize)
+				{
+					convert(data, accessor.componentType, accessor.count * components, out);
+				}
+				else
+				{
+					for (size_t element = 0; element < accessor.count; element++)
+					{
+						convert(data + element * stride, accessor.componentType, components, out + element * components);
+					}
+				}
+			}
+
+			if (accessor.sparse.isSparse)
+			{
+				const auto& sparse = accessor.sparse;
+				const int32_t indexSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(sparse.indices.componentType));
+				if (indexSize <= 0 || sparse.count < 0)
+					return false;
+				const uint8_t* indexData = getViewData(model, buffers, sparse.indices.bufferView, sparse.indices.byteOffset,
+					indexSize, indexSize, sparse.count);
+				const uint8_t* valueData = getViewData(model, buffers, sparse.values.bufferView, sparse.values.byteOffset,
+					elementSize, elementSize, sparse.count);
+				if (!indexData || !valueData)
+					return false;
+
+				std::vector<uint32_t> indices(sparse.count);
+				convertToUint32(indexData, sparse.indices.componentType, indices.size(), indices.data());
+				for (size_t substitution = 0; substitution < indices.size(); substitution++)
+				{
+					if (indices[substitution] >= accessor.count)
+						return false;
+					convert(valueData + substitution * elementSize, accessor.componentType, components, out + size_t(indices[substitution]) * components);
+				}
+			}
+			return true;
+		}
+
+		bool decodeFloats(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, float* out)
+		{
+			return decodeAccessor(model, buffers, accessor, out, [&](const uint8_t* src, int componentType, size_t numScalars, float* dst) {
+				convertToFloat(src, componentType, accessor.normalized, numScalars, dst);
+			});
+		}
+
+		const float* readFloats(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, std::vector<float>& scratch)
+		{
+			const size_t components = numComponents(accessor);
+			if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && !accessor.sparse.isSparse && accessor.bufferView >= 0 &&
+				static_cast<size_t>(accessor.bufferView) < model.bufferViews.size() &&
+				static_cast<size_t>(accessor.ByteStride(model.bufferViews[accessor.bufferView])) == components * sizeof(float))
+			{
+				const uint8_t* data = getViewData(model, buffers, accessor.bufferView, accessor.byteOffset,
+					components * sizeof(float), components * sizeof(float), accessor.count);
+				return reinterpret_cast<const float*>(data);
+			}
+
+			scratch.resize(accessor.count * components);
+			return decodeFloats(model, buffers, accessor, scratch.data()) ? scratch.data() : nullptr;
+		}
+
+		bool decodeIndices(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, uint32_t* out)
+		{
+			if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+				accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+				accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+				return false;
+
+			return decodeAccessor(model, buffers, accessor, out, [](const uint8_t* src, int componentType, size_t numScalars, uint32_t* dst) {
+				convertToUint32(src, componentType, numScalars, dst);
+			});
+		}
+	}
+}
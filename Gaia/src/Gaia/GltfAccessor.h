@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//tiny_gltf.h is not included here, LoadMesh.cpp compiles its implementation and the header can only be included once there
+namespace tinygltf
+{
+	struct Accessor;
+	class Model;
+}
+
+namespace Gaia
+{
+	//Decoding of glTF accessors into tightly packed float / uint32 arrays.
+	//Handles byteStride, sparse substitution and every component type, (normalized) integers are converted with SSE2/AVX2 kernels
+	//so KHR_mesh_quantization assets load the same way as float assets.
+	namespace GltfAccessor
+	{
+		//raw bytes of every buffer of the model, indexed like model.buffers
+		using BufferTable = std::span<const std::span<const uint8_t>>;
+
+		//number of scalars per element, e.g. 3 for VEC3
+		uint32_t numComponents(const tinygltf::Accessor& accessor);
+
+		//decodes accessor.count * numComponents(accessor) floats into out, returns false if the accessor points outside its buffers
+		bool decodeFloats(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, float* out);
+
+		//returns tightly packed floats. Packed, non sparse float accessors are returned in place, anything else is decoded into scratch.
+		//Returns nullptr if the accessor is invalid
+		const float* readFloats(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, std::vector<float>& scratch);
+
+		//decodes an unsigned byte/short/int index accessor into out
+		bool decodeIndices(const tinygltf::Model& model, BufferTable buffers, const tinygltf::Accessor& accessor, uint32_t* out);
+
+		//converts numScalars contiguous components of componentType to float, normalized integers are mapped to [0,1] / [-1,1]
+		void convertToFloat(const void* src, int componentType, bool normalized, size_t numScalars, float* dst);
+		//converts numScalars contiguous unsigned components of componentType to uint32
+		void convertToUint32(const void* src, int componentType, size_t numScalars, uint32_t* dst);
+	}
+}
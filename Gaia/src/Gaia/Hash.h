@@ -0,0 +1,40 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace Gaia
+{
+	static constexpr uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+	static constexpr uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ull;
+
+	//single lane xxhash64 style hash, processes 8 bytes per step
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t h = seed ^ (size * HASH_PRIME_1);
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t k;
+			memcpy(&k, bytes + i, sizeof(k));
+			k *= HASH_PRIME_2;
+			k = std::rotl(k, 31);
+			k *= HASH_PRIME_1;
+			h ^= k;
+			h = std::rotl(h, 27) * HASH_PRIME_1 + HASH_PRIME_3;
+		}
+		for (; i < size; i++)
+		{
+			h ^= bytes[i] * HASH_PRIME_3;
+			h = std::rotl(h, 11) * HASH_PRIME_1;
+		}
+		h ^= h >> 33;
+		h *= HASH_PRIME_2;
+		h ^= h >> 29;
+		h *= HASH_PRIME_3;
+		h ^= h >> 32;
+		return h;
+	}
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "ImageConvert.h"
+#include "CpuFeatures.h"
+#include <immintrin.h>
+#include <cstring>
+
+namespace Gaia
+{
+	namespace ImageConvert
+	{
+		//moves the 3 bytes of every pixel to the low bytes of a 4 byte lane, the alpha byte is zeroed and ORed in afterwards
+		alignas(32) static constexpr int8_t RGB_TO_RGBA_SHUFFLE[32] = {
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		};
+
+		static void expandRgbToRgbaScalar(const uint8_t* rgb, size_t first, size_t numPixels, uint8_t* rgba)
+		{
+			for (size_t i = first; i < numPixels; i++)
+			{
+				rgba[i * 4 + 0] = rgb[i * 3 + 0];
+				rgba[i * 4 + 1] = rgb[i * 3 + 1];
+				rgba[i * 4 + 2] = rgb[i * 3 + 2];
+				rgba[i * 4 + 3] = 0xFF;
+			}
+		}
+
+		//4 pixels per shuffle. Every load reads 16 bytes of which 12 are used, so the loop stops early enough to stay inside rgb
+		GAIA_TARGET_SSSE3 static size_t expandRgbToRgbaSsse3(const uint8_t* rgb, size_t numPixels, uint8_t* rgba)
+		{
+			const __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(RGB_TO_RGBA_SHUFFLE));
+			const __m128i alpha = _mm_set1_epi32(int32_t(0xFF000000));
+			size_t i = 0;
+			for (; i + 16 + 2 <= numPixels; i += 16)
+			{
+				for (size_t block = 0; block < 4; block++)
+				{
+					__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (i + block * 4) * 3));
+					pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (i + block * 4) * 4), pixels);
+				}
+			}
+			return i;
+		}
+
+		//8 pixels per shuffle, the two 128 bit lanes are loaded 12 bytes apart
+		GAIA_TARGET_AVX2 static size_t expandRgbToRgbaAvx2(const uint8_t* rgb, size_t numPixels, uint8_t* rgba)
+		{
+			const __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(RGB_TO_RGBA_SHUFFLE));
+			const __m256i alpha = _mm256_set1_epi32(int32_t(0xFF000000));
+			size_t i = 0;
+			for (; i + 16 + 2 <= numPixels; i += 16)
+			{
+				for (size_t block = 0; block < 2; block++)
+				{
+					const uint8_t* src = rgb + (i + block * 8) * 3;
+					__m256i pixels = _mm256_inserti128_si256(
+						_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+						_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12)), 1);
+					pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + (i + block * 8) * 4), pixels);
+				}
+			}
+			return i;
+		}
+
+		void expandRgbToRgba(const uint8_t* rgb, size_t numPixels, uint8_t* rgba)
+		{
+			size_t done = 0;
+			if (CpuFeatures::hasAvx2())
+				done = expandRgbToRgbaAvx2(rgb, numPixels, rgba);
+			else if (CpuFeatures::hasSsse3())
+				done = expandRgbToRgbaSsse3(rgb, numPixels, rgba);
+			expandRgbToRgbaScalar(rgb, done, numPixels, rgba);
+		}
+
+		void expandToRgba(const uint8_t* src, size_t numPixels, int numChannels, uint8_t* rgba)
+		{
+			switch (numChannels)
+			{
+			case 1:
+				for (size_t i = 0; i < numPixels; i++)
+				{
+					rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = src[i];
+					rgba[i * 4 + 3] = 0xFF;
+				}
+				break;
+			case 2:
+				for (size_t i = 0; i < numPixels; i++)
+				{
+					rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = src[i * 2];
+					rgba[i * 4 + 3] = src[i * 2 + 1];
+				}
+				break;
+			case 3:
+				expandRgbToRgba(src, numPixels, rgba);
+				break;
+			default:
+				memcpy(rgba, src, numPixels * 4);
+				break;
+			}
+		}
+	}
+}
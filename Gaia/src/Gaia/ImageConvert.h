@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Gaia
+{
+	//Pixel layout conversions of decoded 8 bit images, the GPU textures are always RGBA8
+	namespace ImageConvert
+	{
+		//RGB -> RGBA with opaque alpha, uses AVX2 or SSSE3 shuffles when available. rgb and rgba must not overlap
+		void expandRgbToRgba(const uint8_t* rgb, size_t numPixels, uint8_t* rgba);
+
+		//expands 1 (grey), 2 (grey, alpha) or 3 channel pixels to RGBA the way stb_image does, 4 channels are copied
+		void expandToRgba(const uint8_t* src, size_t numPixels, int numChannels, uint8_t* rgba);
+	}
+}
@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "ImageDecoder.h"
+#include "Trace.h"
+#include "Log.h"
+#include "Gaia/GltfLoader/stb_image.h"
+
+namespace Gaia
+{
+	ImageDecoder::ImageDecoder(bool decodeToRgba, uint32_t numThreads) : decodeToRgba_(decodeToRgba)
+	{
+		if (numThreads == 0)
+			numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		for (uint32_t i = 0; i < numThreads; i++)
+			workers_.emplace_back(&ImageDecoder::workerThread, this);
+	}
+
+	ImageDecoder::~ImageDecoder()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		wakeWorker_.notify_all();
+		for (std::thread& worker : workers_)
+			worker.join();
+	}
+
+	void ImageDecoder::submit(uint32_t imageIndex, std::vector<uint8_t>&& encoded)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			jobs_[imageIndex] = Job{ .encoded = std::move(encoded), .image = {} };
+			queue_.push_back(imageIndex);
+		}
+		wakeWorker_.notify_one();
+	}
+
+	void ImageDecoder::consumeAll(const std::function<void(uint32_t imageIndex, Image&& image)>& consume)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		consume_ = &consume;
+		wakeWorker_.notify_all();
+		//the calling thread helps until the last image is consumed, the workers may still be consuming theirs
+		while (!jobs_.empty())
+		{
+			if (!runNextJob(lock))
+				imageDone_.wait(lock);
+		}
+		consume_ = nullptr;
+	}
+
+	ImageDecoder::Image ImageDecoder::decode(uint32_t imageIndex, const std::vector<uint8_t>& encoded) const
+	{
+		GAIA_TRACE_SCOPE("decode image");
+		Image image;
+		const int size = static_cast<int>(encoded.size());
+		const int requestedComponents = decodeToRgba_ ? 4 : 0;
+		uint8_t* pixels = nullptr;
+		if (stbi_is_16_bit_from_memory(encoded.data(), size))
+		{
+			pixels = reinterpret_cast<uint8_t*>(stbi_load_16_from_memory(encoded.data(), size, &image.width, &image.height, &image.component, requestedComponents));
+			image.bits = 16;
+		}
+		if (!pixels)
+		{
+			pixels = stbi_load_from_memory(encoded.data(), size, &image.width, &image.height, &image.component, requestedComponents);
+			image.bits = 8;
+		}
+		if (!pixels || image.width < 1 || image.height < 1)
+		{
+			GAIA_CORE_ERROR("Could not decode image {}: {}", imageIndex, stbi_failure_reason() ? stbi_failure_reason() : "unknown format");
+			stbi_image_free(pixels);
+			return {};
+		}
+		if (requestedComponents != 0)
+			image.component = requestedComponents;
+
+		const size_t numBytes = size_t(image.width) * size_t(image.height) * size_t(image.component) * size_t(image.bits / 8);
+		image.pixels.assign(pixels, pixels + numBytes);
+		image.isValid = true;
+		stbi_image_free(pixels);
+		return image;
+	}
+
+	bool ImageDecoder::runNextJob(std::unique_lock<std::mutex>& lock)
+	{
+		if (consume_ && !decoded_.empty())
+		{
+			const uint32_t imageIndex = decoded_.front();
+			decoded_.pop_front();
+			Image image = std::move(jobs_[imageIndex].image);
+			lock.unlock();
+			(*consume_)(imageIndex, std::move(image));
+			lock.lock();
+			jobs_.erase(imageIndex);
+			imageDone_.notify_all();
+			return true;
+		}
+		if (queue_.empty())
+			return false;
+
+		const uint32_t imageIndex = queue_.front();
+		queue_.pop_front();
+		std::vector<uint8_t> encoded = std::move(jobs_[imageIndex].encoded);
+		lock.unlock();
+		Image image = decode(imageIndex, encoded);
+		encoded = {};
+		lock.lock();
+		if (consume_)
+		{
+			//consume_ stays set until every job is erased, so it is safe to use without the lock
+			lock.unlock();
+			(*consume_)(imageIndex, std::move(image));
+			lock.lock();
+			jobs_.erase(imageIndex);
+			imageDone_.notify_all();
+		}
+		else
+		{
+			jobs_[imageIndex].image = std::move(image);
+			decoded_.push_back(imageIndex);
+		}
+		return true;
+	}
+
+	void ImageDecoder::workerThread()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true)
+		{
+			wakeWorker_.wait(lock, [&] { return stop_ || !queue_.empty() || (consume_ && !decoded_.empty()); });
+			if (stop_)
+				return;
+			runNextJob(lock);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Gaia
+{
+	//decodes encoded images (png, jpg and the other formats stb_image reads) on a pool of worker threads, so the glTF parse
+	//and the geometry decode keep going while the images are decoded. LoadMesh hands the bytes over from the tinygltf image
+	//loader callback and consumes the pixels in LoadTextures
+	class ImageDecoder
+	{
+	public:
+		struct Image
+		{
+			int width = 0;
+			int height = 0;
+			int component = 0;
+			int bits = 8;
+			std::vector<uint8_t> pixels;
+			bool isValid = false;
+		};
+
+		//decodeToRgba expands every 8 bit image to 4 channels while decoding, 0 threads uses every core but one
+		explicit ImageDecoder(bool decodeToRgba, uint32_t numThreads = 0);
+		~ImageDecoder();
+		ImageDecoder(const ImageDecoder&) = delete;
+		ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+		void submit(uint32_t imageIndex, std::vector<uint8_t>&& encoded);
+		//hands every submitted image to consume in the order they finish decoding and returns once all of them were consumed.
+		//The workers call consume right after their decode and the calling thread takes the images decoded before this call
+		//and decodes queued ones itself, so no thread is parked on a particular image. The image is invalid if it could not
+		//be decoded. consume runs on several threads at once
+		void consumeAll(const std::function<void(uint32_t imageIndex, Image&& image)>& consume);
+
+	private:
+		struct Job
+		{
+			std::vector<uint8_t> encoded;
+			Image image;
+		};
+		Image decode(uint32_t imageIndex, const std::vector<uint8_t>& encoded) const;
+		void workerThread();
+		//decodes the next queued image or consumes the next decoded one, false if there was neither. Called with the lock held
+		bool runNextJob(std::unique_lock<std::mutex>& lock);
+
+	private:
+		bool decodeToRgba_ = true;
+		std::vector<std::thread> workers_;
+		std::mutex mutex_;
+		std::condition_variable wakeWorker_;
+		std::condition_variable imageDone_;
+		std::map<uint32_t, Job> jobs_; //stable references while workers fill them in
+		std::deque<uint32_t> queue_;
+		std::deque<uint32_t> decoded_; //decoded before there was a consumer
+		const std::function<void(uint32_t, Image&&)>* consume_ = nullptr;
+		bool stop_ = false;
+	};
+}
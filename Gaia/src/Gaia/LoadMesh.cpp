@@ -5,12 +5,25 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
 #include "LoadMesh.h"
+#include "SceneCache.h"
+#include "GltfAccessor.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "TangentGenerator.h"
+#include "ImageConvert.h"
+#include "TextureCompressor.h"
+#include "TextureMips.h"
+#include "Hash.h"
+#include "Trace.h"
 #include "Log.h"
 #include "Core.h"
+#include "Gaia/GltfLoader/json.hpp"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <filesystem>
+#include <numeric>
 
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtx/quaternion.hpp"
@@ -18,26 +31,211 @@
 
 namespace fs = std::filesystem;
 
+//uri given to images that live in a mapped buffer view, resolved by the fs callbacks set up in LoadMapped
+static constexpr const char* MAPPED_IMAGE_PREFIX = "__gaia_mapped_image_";
+
 namespace Gaia
 { 
 	LoadMesh::LoadMesh()
 	{
 	}
-	LoadMesh::LoadMesh(const std::string& Path)
+	LoadMesh::LoadMesh(const std::string& Path, const MeshLoadOptions& options)
 	{
 		//std::filesystem::path mesh_path(Path);
 		//objectName = mesh_path.stem().string();
 		m_path = Path;
+		m_options = options;
 
+		if (!m_options.tracePath.empty())
+			Trace::start();
+		load(Path);
+		if (!m_options.tracePath.empty())
+			Trace::stop(m_options.tracePath);
+	}
+	void LoadMesh::load(const std::string& Path)
+	{
+		GAIA_TRACE_SCOPE("load scene");
 		//if (m_LOD.size() == 0)
 		//	m_LOD.push_back(this);
-		LoadObj(Path);
+		uint64_t sourceHash = 0;
+		std::string cachePath;
+		if (m_options.useSceneCache)
+		{
+			sourceHash = SceneCache::computeSourceHash(Path);
+			cachePath = SceneCache::getCachePath(Path);
+			GAIA_TRACE_SCOPE("read scene cache");
+			if (SceneCache::read(cachePath, sourceHash, *this))
+			{
+				GAIA_CORE_INFO("Loaded cooked scene {}", cachePath);
+				m_cachePath = cachePath;
+				if (m_options.residency == CpuResidency_Spill)
+					spillToDisk();
+				return;
+			}
+		}
+
+		if (!LoadObj(Path))
+			return;
 
 		calculateSceneBounds();
+
+		GAIA_TRACE_SCOPE("write scene cache");
+		if (m_options.useSceneCache && SceneCache::write(cachePath, sourceHash, *this))
+		{
+			GAIA_CORE_INFO("Wrote cooked scene {}", cachePath);
+			if (SceneCache::locateTexels(cachePath, *this))
+				m_cachePath = cachePath;
+		}
+		if (m_options.residency == CpuResidency_Spill)
+			spillToDisk();
 	}
 	LoadMesh::~LoadMesh()
 	{
 		//clear();
+		if (!m_spillPath.empty())
+		{
+			m_spillFile.close();
+			std::error_code ec;
+			fs::remove(m_spillPath, ec);
+		}
+	}
+
+	bool LoadMesh::spillToDisk()
+	{
+		GAIA_TRACE_SCOPE("spill to disk");
+		//textures in the scene cache can already be read back from there
+		const bool spillTextures = m_cachePath.empty() && !gltfTextures.empty();
+		const bool spillGeometry = ownsGeometry() && m_numVertices > 0;
+		if (!spillTextures && !spillGeometry)
+			return true;
+
+		std::error_code ec;
+		const fs::path tempDirectory = fs::temp_directory_path(ec);
+		const uint64_t nameHash = hashBytes(m_path.data(), m_path.size(), reinterpret_cast<uintptr_t>(this));
+		const fs::path spillPath = tempDirectory / (fs::path(m_path).stem().string() + "_" + std::to_string(nameHash) + ".spill");
+		std::ofstream file(spillPath, std::ios::binary | std::ios::trunc);
+
+		//offset 0 stays unused so a Texture::cacheOffset of 0 still means the texels are only in memory
+		constexpr uint64_t SPILL_ALIGNMENT = 16;
+		constexpr char padding[SPILL_ALIGNMENT] = {};
+		uint64_t offset = SPILL_ALIGNMENT;
+		file.write(padding, SPILL_ALIGNMENT);
+		auto write = [&](const void* data, size_t size) {
+			const uint64_t start = (offset + SPILL_ALIGNMENT - 1) & ~(SPILL_ALIGNMENT - 1);
+			file.write(padding, start - offset);
+			file.write(reinterpret_cast<const char*>(data), size);
+			offset = start + size;
+			return start;
+			};
+
+		std::vector<uint64_t> textureOffsets(gltfTextures.size(), 0);
+		if (spillTextures)
+		{
+			for (size_t i = 0; i < gltfTextures.size(); i++)
+			{
+				if (!gltfTextures[i].textureData.empty())
+					textureOffsets[i] = write(gltfTextures[i].textureData.data(), gltfTextures[i].textureData.size());
+			}
+		}
+		uint64_t vertexOffset = 0;
+		uint64_t indexOffset = 0;
+		if (spillGeometry)
+		{
+			vertexOffset = write(m_vertexData, m_numVertices * sizeof(VertexAttributes));
+			indexOffset = write(m_indexData, m_numIndices * sizeof(uint32_t));
+		}
+		file.close();
+		if (ec || !file)
+		{
+			GAIA_CORE_WARN("Could not write the spill file {}, the CPU scene data stays in memory", spillPath.string());
+			fs::remove(spillPath, ec);
+			m_options.residency = CpuResidency_Keep;
+			return false;
+		}
+
+		m_spillPath = spillPath.string();
+		m_spillVertexOffset = vertexOffset;
+		m_spillIndexOffset = indexOffset;
+		if (spillTextures)
+		{
+			for (size_t i = 0; i < gltfTextures.size(); i++)
+				gltfTextures[i].cacheOffset = textureOffsets[i];
+			m_cachePath = m_spillPath;
+		}
+		GAIA_CORE_INFO("Spilled {:.1f} MB of CPU scene data to {}", offset / (1024.0 * 1024.0), m_spillPath);
+		return true;
+	}
+
+	void LoadMesh::releaseCpuData()
+	{
+		if (m_options.residency == CpuResidency_Keep)
+			return;
+		const CpuMemoryStats before = getCpuMemoryStats();
+
+		//the textures are either on disk or were uploaded with every level (see TextureStreamingDesc::streamFromMemory)
+		for (Texture& texture : gltfTextures)
+		{
+			texture.textureData.clear();
+			texture.textureData.shrink_to_fit();
+			texture.mappedData = {};
+		}
+		//only the meshlet bounds have CPU consumers
+		m_meshletVertices.clear();
+		m_meshletVertices.shrink_to_fit();
+		m_meshletTriangles.clear();
+		m_meshletTriangles.shrink_to_fit();
+
+		if (ownsGeometry())
+		{
+			if (m_options.residency == CpuResidency_Spill && m_spillVertexOffset != 0 && m_spillFile.open(m_spillPath))
+			{
+				//the mapping is read only, spilled geometry must not be written through getVertices()/getIndices()
+				m_vertexData = const_cast<VertexAttributes*>(reinterpret_cast<const VertexAttributes*>(m_spillFile.data() + m_spillVertexOffset));
+				m_indexData = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(m_spillFile.data() + m_spillIndexOffset));
+			}
+			else
+			{
+				m_vertexData = nullptr;
+				m_indexData = nullptr;
+				m_numVertices = 0;
+				m_numIndices = 0;
+			}
+			m_vertices.clear();
+			m_vertices.shrink_to_fit();
+			m_indices.clear();
+			m_indices.shrink_to_fit();
+		}
+		else if (m_cacheFile.isOpen() && m_options.residency == CpuResidency_Drop)
+		{
+			//geometry read in place from the scene cache goes away with the mapping
+			const uint8_t* vertexData = reinterpret_cast<const uint8_t*>(m_vertexData);
+			if (vertexData >= m_cacheFile.data() && vertexData < m_cacheFile.data() + m_cacheFile.size())
+			{
+				m_vertexData = nullptr;
+				m_indexData = nullptr;
+				m_numVertices = 0;
+				m_numIndices = 0;
+			}
+		}
+		if (m_options.residency == CpuResidency_Drop)
+			m_cacheFile.close();
+
+		const CpuMemoryStats after = getCpuMemoryStats();
+		const uint64_t bytesBefore = before.textureBytes + before.vertexBytes + before.indexBytes + before.meshletBytes;
+		const uint64_t bytesAfter = after.textureBytes + after.vertexBytes + after.indexBytes + after.meshletBytes;
+		GAIA_CORE_INFO("Released {:.1f} MB of CPU scene data, {:.1f} MB stay resident", (bytesBefore - bytesAfter) / (1024.0 * 1024.0), bytesAfter / (1024.0 * 1024.0));
+	}
+
+	CpuMemoryStats LoadMesh::getCpuMemoryStats() const
+	{
+		CpuMemoryStats stats;
+		for (const Texture& texture : gltfTextures)
+			stats.textureBytes += texture.textureData.capacity();
+		stats.vertexBytes = m_vertices.capacity() * sizeof(VertexAttributes);
+		stats.indexBytes = m_indices.capacity() * sizeof(uint32_t);
+		stats.meshletBytes = m_meshlets.capacity() * sizeof(Meshlet) + m_meshletVertices.capacity() * sizeof(uint32_t) + m_meshletTriangles.capacity();
+		stats.spilledBytes = m_spillFile.size();
+		return stats;
 	}
 
 	int LoadMesh::addNode(int parentIndex, int level)
@@ -65,6 +263,59 @@ namespace Gaia
 		return hierarchyIndex;
 	}
 
+	void LoadMesh::sortHierarchyByLevel()
+	{
+		GAIA_TRACE_SCOPE("sort hierarchy");
+		const size_t numNodes = m_hierarchy.size();
+		//parents are always added before their children, so one pass in node order finds every level
+		uint32_t numLevels = 0;
+		for (Hierarchy& node : m_hierarchy)
+		{
+			node.level = node.parent == -1 ? 0 : m_hierarchy[node.parent].level + 1;
+			numLevels = std::max(numLevels, static_cast<uint32_t>(node.level) + 1);
+		}
+
+		//counting sort, the nodes of a level keep their order
+		std::vector<uint32_t> levelStart(numLevels + 1, 0);
+		for (const Hierarchy& node : m_hierarchy)
+			levelStart[node.level + 1]++;
+		for (uint32_t level = 0; level < numLevels; level++)
+			levelStart[level + 1] += levelStart[level];
+		std::vector<int> newIndex(numNodes);
+		bool isSorted = true;
+		for (size_t i = 0; i < numNodes; i++)
+		{
+			newIndex[i] = static_cast<int>(levelStart[m_hierarchy[i].level]++);
+			isSorted = isSorted && newIndex[i] == static_cast<int>(i);
+		}
+		if (isSorted)
+			return;
+
+		auto remap = [&](int index) { return index == -1 ? -1 : newIndex[index]; };
+		auto permute = [&](auto& values) {
+			std::remove_reference_t<decltype(values)> sorted(values.size());
+			for (size_t i = 0; i < numNodes; i++)
+				sorted[newIndex[i]] = std::move(values[i]);
+			values = std::move(sorted);
+			};
+		for (Hierarchy& node : m_hierarchy)
+		{
+			node.parent = remap(node.parent);
+			node.firstChild = remap(node.firstChild);
+			node.nextSibling = remap(node.nextSibling);
+		}
+		permute(m_hierarchy);
+		permute(localTransforms);
+		permute(globalTransforms);
+		permute(m_nodeNames);
+
+		for (SubMesh& subMesh : m_subMeshes)
+		{
+			subMesh.meshIndex = remap(subMesh.meshIndex);
+			subMesh.nodeIndex = remap(subMesh.nodeIndex);
+		}
+	}
+
 	void LoadMesh::parse_scene_rec(tinygltf::Node& node, glm::mat4 nodeTransform, int nodeIndex, int parentIndex, int level)
 	{
 		glm::mat4 transform = getTransform(nodeIndex);
@@ -77,7 +328,7 @@ namespace Gaia
 
 		if (node.mesh != -1)
 		{
-			LoadVertexData(node.mesh, hierarchyIndex, level);
+			AddMeshPrimitives(node.mesh, hierarchyIndex);
 		}
 		//TODO camera, Lights..
 		for (int children : node.children)
@@ -89,34 +340,98 @@ namespace Gaia
 	void LoadMesh::getTotalNodes(tinygltf::Node& node, int& totalNodes)
 	{
 		totalNodes++;
+		//every primitive gets its own child node
+		if (node.mesh != -1)
+		{
+			totalNodes += static_cast<int>(model.meshes[node.mesh].primitives.size());
+		}
 		for (int children : node.children)
 		{
 			getTotalNodes(model.nodes[children], totalNodes);
 		}
 	}
 
+	void LoadMesh::allocateGeometry(size_t numVertices, size_t numIndices)
+	{
+		m_vertices.clear();
+		m_indices.clear();
+		m_numVertices = numVertices;
+		m_numIndices = numIndices;
+		m_vertices.resize(numVertices);
+		m_indices.resize(numIndices);
+		m_vertexData = m_vertices.data();
+		m_indexData = m_indices.data();
+	}
+
+	void LoadMesh::mapGeometry(const VertexAttributes* vertices, size_t numVertices, const uint32_t* indices, size_t numIndices)
+	{
+		//the mapping is read only, mapped geometry must not be written through getVertices()/getIndices()
+		m_vertices.clear();
+		m_indices.clear();
+		m_vertexData = const_cast<VertexAttributes*>(vertices);
+		m_indexData = const_cast<uint32_t*>(indices);
+		m_numVertices = numVertices;
+		m_numIndices = numIndices;
+	}
+
 	void LoadMesh::calculateSceneBounds()
 	{
-		//create world space scene bounds
-		for (auto& subMesh : m_subMeshes)
+		//world space scene bounds from the corners of the sub mesh boxes, the vertices may not be in memory anymore (see CpuResidency)
+		sceneBounds_ = {};
+		for (const SubMesh& subMesh : m_subMeshes)
 		{
-			for (int i = 0; i < subMesh.second.Vertices.size(); i++)
+			const glm::mat4& modelTrans = globalTransforms[subMesh.meshIndex];
+			for (int corner = 0; corner < 8; corner++)
 			{
-				glm::mat4 modelTrans = globalTransforms[subMesh.second.meshIndices[i]];
-				glm::vec4 ws_pos = modelTrans * glm::vec4(subMesh.second.Vertices[i], 1.0);
+				glm::vec3 position = glm::vec3(
+					(corner & 1) ? subMesh.boundsMax.x : subMesh.boundsMin.x,
+					(corner & 2) ? subMesh.boundsMax.y : subMesh.boundsMin.y,
+					(corner & 4) ? subMesh.boundsMax.z : subMesh.boundsMin.z);
+				glm::vec4 ws_pos = modelTrans * glm::vec4(position, 1.0);
 				sceneBounds_.min = glm::min(sceneBounds_.min, glm::vec3(ws_pos));
 				sceneBounds_.max = glm::max(sceneBounds_.max, glm::vec3(ws_pos));
 			}
 		}
 	}
 
-	void LoadMesh::LoadObj(const std::string& Path)
+	bool LoadMesh::LoadObj(const std::string& Path)
 	{
 		
 		std::string err;
 		std::string warn;
 
-		bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, Path);
+		//by default stb_image expands every image to RGBA while decoding, otherwise LoadTextures expands them afterwards
+		loader.SetPreserveImageChannels(!m_options.decodeImagesToRgba);
+		if (m_options.deferImageDecoding)
+		{
+			//tinygltf only gets the image header, the pixels are decoded by the workers while the parse and the geometry continue
+			m_imageDecoder = std::make_unique<ImageDecoder>(m_options.decodeImagesToRgba);
+			loader.SetImageLoader([this](tinygltf::Image* image, const int imageIndex, std::string* err, std::string*, int, int,
+				const unsigned char* bytes, int size, void*) {
+					int width = 0, height = 0, component = 0;
+					if (!stbi_info_from_memory(bytes, size, &width, &height, &component))
+					{
+						if (err)
+							(*err) += "Unknown image format for image[" + std::to_string(imageIndex) + "] name = \"" + image->name + "\".\n";
+						return false;
+					}
+					image->width = width;
+					image->height = height;
+					image->component = m_options.decodeImagesToRgba ? 4 : component;
+					m_imageDecoder->submit(uint32_t(imageIndex), std::vector<uint8_t>(bytes, bytes + size));
+					return true;
+				}, nullptr);
+		}
+		bool ret = false;
+		{
+			GAIA_TRACE_SCOPE("parse glTF");
+			if (m_options.mapBuffers)
+				ret = LoadMapped(Path, err, warn);
+			else if (fs::path(Path).extension() == ".glb")
+				ret = loader.LoadBinaryFromFile(&model, &err, &warn, Path);
+			else
+				ret = loader.LoadASCIIFromFile(&model, &err, &warn, Path);
+		}
 
 		if (!warn.empty()) {
 			GAIA_CORE_ERROR("Warn: {}", warn.c_str());
@@ -128,9 +443,16 @@ namespace Gaia
 
 		if (!ret) {
 			GAIA_CORE_ERROR("Failed to parse glTF");
-			return;
+			m_imageDecoder.reset();
+			return false;
+		}
+		//buffers that were not mapped were loaded by tinygltf
+		m_buffers.resize(model.buffers.size());
+		for (size_t bufferIndex = 0; bufferIndex < model.buffers.size(); bufferIndex++)
+		{
+			if (m_buffers[bufferIndex].empty())
+				m_buffers[bufferIndex] = model.buffers[bufferIndex].data;
 		}
-		LoadTextures();
 		LoadMatrials();
 		/*transforms.resize(model.meshes.size());
 		m_subMeshes.resize(model.meshes.size());*/
@@ -146,10 +468,12 @@ namespace Gaia
 			totalNodes++;
 		}
 
-		m_hierarchy.reserve(sizeof(Hierarchy) * totalNodes);
-		localTransforms.reserve(sizeof(glm::mat4) * totalNodes);
-		globalTransforms.reserve(sizeof(glm::mat4) * totalNodes);
+		m_hierarchy.reserve(totalNodes);
+		localTransforms.reserve(totalNodes);
+		globalTransforms.reserve(totalNodes);
+		m_nodeNames.reserve(totalNodes);
 
+		//first pass builds the hierarchy and assigns every primitive its vertex and index range
 		for (tinygltf::Scene scene : model.scenes)
 		{
 			//root
@@ -165,284 +489,593 @@ namespace Gaia
 			}
 		}
 
-	}
-	void LoadMesh::LoadVertexData(int mesh_index, int hierarchyIndex, int level)
-	{
-		uint32_t numPrimitives = model.meshes[mesh_index].primitives.size();
-
-		SubMesh subMesh;
-
-		//get the total number of vertices so that I can preallocate memory for my vertex attributes
-		uint32_t totalVertexCount = 0;
-		uint32_t totalIndices = 0;
-		for (const auto& glTFPrimitive : model.meshes[mesh_index].primitives)
-		{
-			uint32_t vertexCount = 0;
-			const float* positionBuffer = nullptr;
-			LoadAccessor<float>(model.accessors[glTFPrimitive.attributes.find("POSITION")->second],
-				positionBuffer, &vertexCount);
-			const uint32_t* buffer;
-			uint32_t indicesCount = 0;
-			LoadAccessor<uint32_t>(model.accessors[glTFPrimitive.indices], buffer, &indicesCount);
-			totalVertexCount += vertexCount;
-			totalIndices += indicesCount;
-		}
-
-		subMesh.Vertices.reserve(sizeof(glm::vec3) * totalVertexCount);
-		subMesh.Normal.reserve(sizeof(glm::vec3) * totalVertexCount);
-		subMesh.Tangent.reserve(sizeof(glm::vec3) * totalVertexCount);
-		subMesh.BiTangent.reserve(sizeof(glm::vec3) * totalVertexCount);
-		subMesh.TexCoord.reserve(sizeof(glm::vec2) * totalVertexCount);
-		subMesh.m_MaterialID.reserve(sizeof(uint32_t) * totalVertexCount);
-		subMesh.meshIndices.reserve(sizeof(uint32_t) * totalVertexCount);
-		subMesh.indices.reserve(sizeof(uint32_t) * totalIndices);
+		//the node numbering is final before any vertex is written, so the vertices get the sorted mesh ids directly
+		sortHierarchyByLevel();
 
-		//A mesh can have multiple material so we also treat them as seperate meshes but we use same mesh index
-		for (const auto& glTFPrimitive : model.meshes[mesh_index].primitives)
+		//second pass decodes the accessors straight into the final interleaved arrays
+		size_t totalVertices = m_subMeshes.empty() ? 0 : size_t(m_subMeshes.back().vertexOffset) + m_subMeshes.back().vertexCount;
+		size_t totalIndices = m_subMeshes.empty() ? 0 : size_t(m_subMeshes.back().indexOffset) + m_subMeshes.back().indexCount;
+		allocateGeometry(totalVertices, totalIndices);
+		auto subMeshIter = std::views::iota(uint32_t(0), uint32_t(m_subMeshes.size()));
 		{
-			uint32_t vertexCount = 0;
-			uint32_t indexCount = 0;
-			//subMesh.m_MaterialID = glTFPrimitive.material;
-			// Vertices
+			GAIA_TRACE_SCOPE("decode geometry");
+			if (m_options.parallelDecode)
 			{
-				const float* positionBuffer = nullptr;
-				const float* colorBuffer = nullptr;
-				const float* normalsBuffer = nullptr;
-				const float* tangentsBuffer = nullptr;
-				const float* texCoordsBuffer = nullptr;
-				const uint32_t* jointsBuffer = nullptr;
-				const float* weightsBuffer = nullptr;
-
-				int jointsBufferDataType = 0;
-
-				// Get buffer data for vertex positions
-				if (glTFPrimitive.attributes.find("POSITION") != glTFPrimitive.attributes.end())
-				{
-					auto componentType =
-						LoadAccessor<float>(model.accessors[glTFPrimitive.attributes.find("POSITION")->second],
-							positionBuffer, &vertexCount);
-					GAIA_ASSERT(componentType == GL_FLOAT, "unexpected component type");
-				}
-				//// Get buffer data for vertex color
-				//if (glTFPrimitive.attributes.find("COLOR_0") != glTFPrimitive.attributes.end())
-				//{
-				//	auto componentType = LoadAccessor<float>(
-				//		model.accessors[glTFPrimitive.attributes.find("COLOR_0")->second], colorBuffer);
-				//	GAIA_ASSERT(componentType == GL_FLOAT, "unexpected component type");
-				//}
-				// Get buffer data for vertex normals
-				if (glTFPrimitive.attributes.find("NORMAL") != glTFPrimitive.attributes.end())
-				{
-					auto componentType = LoadAccessor<float>(
-						model.accessors[glTFPrimitive.attributes.find("NORMAL")->second], normalsBuffer);
-					GAIA_ASSERT(componentType == GL_FLOAT, "unexpected component type");
-				}
-				// Get buffer data for vertex tangents
-				if (glTFPrimitive.attributes.find("TANGENT") != glTFPrimitive.attributes.end())
-				{
-					auto componentType = LoadAccessor<float>(
-						model.accessors[glTFPrimitive.attributes.find("TANGENT")->second], tangentsBuffer);
-					GAIA_ASSERT(componentType == GL_FLOAT, "unexpected component type");
-				}
-				// Get buffer data for vertex texture coordinates
-				// glTF supports multiple sets, we only load the first one
-				if (glTFPrimitive.attributes.find("TEXCOORD_0") != glTFPrimitive.attributes.end())
-				{
-					auto componentType = LoadAccessor<float>(
-						model.accessors[glTFPrimitive.attributes.find("TEXCOORD_0")->second], texCoordsBuffer);
-					GAIA_ASSERT(componentType == GL_FLOAT, "unexpected component type");
-				}
-
-				// Get buffer data for joints
-				if (glTFPrimitive.attributes.find("JOINTS_0") != glTFPrimitive.attributes.end())
-				{
-					jointsBufferDataType = LoadAccessor<uint32_t>(
-						model.accessors[glTFPrimitive.attributes.find("JOINTS_0")->second], jointsBuffer);
-					GAIA_ASSERT((jointsBufferDataType == GL_BYTE) || (jointsBufferDataType == GL_UNSIGNED_BYTE),
-						"unexpected component type");
-				}
-				// Get buffer data for joint weights
-				if (glTFPrimitive.attributes.find("WEIGHTS_0") != glTFPrimitive.attributes.end())
+				//only reads the model and writes the ranges reserved above, so no synchronisation is needed
+				std::for_each(std::execution::par, subMeshIter.begin(), subMeshIter.end(), [&](uint32_t subMeshIndex) {
+					LoadVertexData(subMeshIndex);
+				});
+			}
+			else
+			{
+				for (uint32_t subMeshIndex : subMeshIter)
 				{
-					auto componentType = LoadAccessor<float>(
-						model.accessors[glTFPrimitive.attributes.find("WEIGHTS_0")->second], weightsBuffer);
-					GAIA_ASSERT(componentType == GL_FLOAT, "unexpected component type");
+					LoadVertexData(subMeshIndex);
 				}
+			}
+		}
+		if (m_options.optimizeMeshes || m_options.lodLevels > 1 || m_options.buildMeshlets)
+			processGeometry();
 
-				// Append data to model's vertex buffer
-				/*m_subMeshes[primitiveIndex].Vertices.resize(vertexCount);
-				m_subMeshes[primitiveIndex].Normal.resize(vertexCount);
-				m_subMeshes[primitiveIndex].Tangent.resize(vertexCount);
-				m_subMeshes[primitiveIndex].BiTangent.resize(vertexCount);
-				m_subMeshes[primitiveIndex].numVertices=vertexCount;*/
+		//the textures come last so the deferred image decoding overlaps everything above
+		LoadTextures();
+		m_primitiveSources.clear();
+		m_buffers.clear();
+		m_mappedImages.clear();
+		m_mappedFiles.clear();
+		return true;
+	}
+	bool LoadMesh::LoadMapped(const std::string& Path, std::string& err, std::string& warn)
+	{
+		fs::path parentPath = fs::path(Path).parent_path();
+		MappedFile& source = m_mappedFiles.emplace_back(Path);
+		if (!source.isOpen())
+		{
+			err = "Failed to map " + Path;
+			return false;
+		}
 
-				for (size_t vertexIterator = 0; vertexIterator < vertexCount; ++vertexIterator)
-				{
-					SubMesh vertex{};
-					// position
-					auto position = positionBuffer ? glm::make_vec3(&positionBuffer[vertexIterator * 3]) : glm::vec3(0.0f);
-					subMesh.Vertices.push_back(glm::vec3(position.x, position.y, position.z));
-
-					// normal
-					subMesh.Normal.push_back(glm::normalize(
-						glm::vec3(normalsBuffer ? glm::make_vec3(&normalsBuffer[vertexIterator * 3]) : glm::vec3(0.0f))));
-
-					// color TODO
-					/*auto vertexColor = colorBuffer ? glm::make_vec3(&colorBuffer[vertexIterator * 3]) : glm::vec3(1.0f);
-					vertex.m_Color = glm::vec4(vertexColor.x, vertexColor.y, vertexColor.z, 1.0f) * diffuseColor;*/
-
-					// uv
-					subMesh.TexCoord.push_back(texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[vertexIterator * 2]) : glm::vec2(0.0f));
-
-					// tangent
-					glm::vec4 t = tangentsBuffer ? glm::make_vec4(&tangentsBuffer[vertexIterator * 4]) : glm::vec4(0.0f);
-					subMesh.Tangent.push_back(glm::vec3(t.x, t.y, t.z) * t.w);
-
-					//need to construct it
-					subMesh.BiTangent.push_back(glm::vec3(t.x, t.y, t.z) * t.w);
-					subMesh.m_MaterialID.push_back((uint32_t)glTFPrimitive.material);
-					subMesh.meshIndices.push_back(hierarchyIndex);
-					// joint indices and joint weights TODO
-					/*if (jointsBuffer && weightsBuffer)
-					{
-						switch (jointsBufferDataType)
-						{
-						case GL_BYTE:
-						case GL_UNSIGNED_BYTE:
-							vertex.m_JointIds = glm::ivec4(
-								glm::make_vec4(&(reinterpret_cast<const int8_t*>(jointsBuffer)[vertexIterator * 4])));
-							break;
-						case GL_SHORT:
-						case GL_UNSIGNED_SHORT:
-							vertex.m_JointIds = glm::ivec4(
-								glm::make_vec4(&(reinterpret_cast<const int16_t*>(jointsBuffer)[vertexIterator * 4])));
-							break;
-						case GL_INT:
-						case GL_UNSIGNED_INT:
-							vertex.m_JointIds = glm::ivec4(
-								glm::make_vec4(&(reinterpret_cast<const int32_t*>(jointsBuffer)[vertexIterator * 4])));
-							break;
-						default:
-							LOG_CORE_CRITICAL("data type of joints buffer not found");
-							break;
-						}
-						vertex.m_Weights = glm::make_vec4(&weightsBuffer[vertexIterator * 4]);
-					}*/
-					
-				}
+		std::span<const uint8_t> json(source.data(), source.size());
+		std::span<const uint8_t> bin;
+		if (fs::path(Path).extension() == ".glb" && !parseGlbChunks(source.data(), source.size(), json, bin))
+		{
+			err = "Invalid binary glTF header in " + Path;
+			return false;
+		}
+		nlohmann::json document = nlohmann::json::parse(json.begin(), json.end(), nullptr, false);
+		if (document.is_discarded() || !document.is_object())
+		{
+			err = "Failed to parse the JSON of " + Path;
+			return false;
+		}
 
-				// calculate tangents
-				if (!tangentsBuffer)
-				{
-					//CalculateTangents();
-				}
-			}
-			// Indices
+		//every buffer that is backed by a file is mapped and replaced with a one byte data uri so tinygltf does not copy it,
+		//embedded data uris are still decoded by tinygltf
+		auto buffers = document.find("buffers");
+		if (buffers != document.end() && buffers->is_array())
+		{
+			m_buffers.resize(buffers->size());
+			for (size_t bufferIndex = 0; bufferIndex < buffers->size(); bufferIndex++)
 			{
-				const uint32_t* buffer;
-				uint32_t count = 0;
-				auto componentType = LoadAccessor<uint32_t>(model.accessors[glTFPrimitive.indices], buffer, &count);
-
-				//indexCount += count;
-
-				// glTF supports different component types of indices
-				switch (componentType)
+				nlohmann::json& buffer = (*buffers)[bufferIndex];
+				size_t byteLength = buffer.value("byteLength", size_t(0));
+				auto uri = buffer.find("uri");
+				if (uri == buffer.end())
 				{
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
-				{
-					const uint32_t* buf = buffer;
-					for (size_t index = 0; index < count; index++)
+					if (bin.size() < byteLength)
 					{
-						subMesh.indices.push_back(buf[index]);
+						err = "GLB BIN chunk is smaller than buffer " + std::to_string(bufferIndex);
+						return false;
 					}
-					break;
+					m_buffers[bufferIndex] = bin.subspan(0, byteLength);
 				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+				else
 				{
-					const uint16_t* buf = reinterpret_cast<const uint16_t*>(buffer);
-					for (size_t index = 0; index < count; index++)
-					{
-						subMesh.indices.push_back(buf[index]);
-					}
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
-				{
-					const uint8_t* buf = reinterpret_cast<const uint8_t*>(buffer);
-					for (size_t index = 0; index < count; index++)
+					if (!uri->is_string() || tinygltf::IsDataURI(uri->get_ref<const std::string&>()))
+						continue;
+
+					std::string decodedUri;
+					tinygltf::URIDecode(uri->get_ref<const std::string&>(), &decodedUri, nullptr);
+					MappedFile& file = m_mappedFiles.emplace_back((parentPath / decodedUri).string());
+					if (!file.isOpen() || file.size() < byteLength)
 					{
-						subMesh.indices.push_back(buf[index]);
+						err = "Failed to map buffer " + decodedUri;
+						return false;
 					}
-					break;
-				}
-				default:
-				{
-					GAIA_ASSERT(false, "unexpected component type, index component type not supported!");
-					return;
-				}
+					m_buffers[bufferIndex] = std::span<const uint8_t>(file.data(), byteLength);
 				}
+				buffer["uri"] = "data:application/octet-stream;base64,AA==";
+				buffer["byteLength"] = 1;
 			}
+		}
+
+		//images stored in a mapped buffer view are read back through the fs callbacks, only the encoded bytes are copied
+		auto images = document.find("images");
+		auto bufferViews = document.find("bufferViews");
+		if (images != document.end() && images->is_array() && bufferViews != document.end() && bufferViews->is_array())
+		{
+			for (nlohmann::json& image : *images)
+			{
+				auto bufferView = image.find("bufferView");
+				if (bufferView == image.end() || !bufferView->is_number_unsigned() || bufferView->get<size_t>() >= bufferViews->size())
+					continue;
+
+				const nlohmann::json& view = (*bufferViews)[bufferView->get<size_t>()];
+				size_t bufferIndex = view.value("buffer", size_t(0));
+				size_t byteOffset = view.value("byteOffset", size_t(0));
+				size_t byteLength = view.value("byteLength", size_t(0));
+				if (bufferIndex >= m_buffers.size() || m_buffers[bufferIndex].empty() ||
+					byteOffset > m_buffers[bufferIndex].size() || byteLength > m_buffers[bufferIndex].size() - byteOffset)
+					continue;
+
+				image.erase("bufferView");
+				image["uri"] = MAPPED_IMAGE_PREFIX + std::to_string(m_mappedImages.size());
+				m_mappedImages.push_back(m_buffers[bufferIndex].subspan(byteOffset, byteLength));
+			}
+		}
+
+		tinygltf::FsCallbacks callbacks{
+			.FileExists = [](const std::string& path, void* userData) {
+				return path.find(MAPPED_IMAGE_PREFIX) != std::string::npos || tinygltf::FileExists(path, userData);
+			},
+			.ExpandFilePath = tinygltf::ExpandFilePath,
+			.ReadWholeFile = [](std::vector<unsigned char>* out, std::string* err, const std::string& path, void* userData) {
+				size_t prefix = path.find(MAPPED_IMAGE_PREFIX);
+				if (prefix == std::string::npos)
+					return tinygltf::ReadWholeFile(out, err, path, userData);
+
+				const LoadMesh* mesh = static_cast<const LoadMesh*>(userData);
+				size_t imageIndex = std::stoull(path.substr(prefix + strlen(MAPPED_IMAGE_PREFIX)));
+				std::span<const uint8_t> encoded = mesh->m_mappedImages[imageIndex];
+				out->assign(encoded.begin(), encoded.end());
+				return true;
+			},
+			.WriteWholeFile = tinygltf::WriteWholeFile,
+			.GetFileSizeInBytes = [](size_t* size, std::string* err, const std::string& path, void* userData) {
+				size_t prefix = path.find(MAPPED_IMAGE_PREFIX);
+				if (prefix == std::string::npos)
+					return tinygltf::GetFileSizeInBytes(size, err, path, userData);
+
+				const LoadMesh* mesh = static_cast<const LoadMesh*>(userData);
+				*size = mesh->m_mappedImages[std::stoull(path.substr(prefix + strlen(MAPPED_IMAGE_PREFIX)))].size();
+				return true;
+			},
+			.user_data = this,
+		};
+		loader.SetFsCallbacks(callbacks);
+
+		std::string rewritten = document.dump();
+		return loader.LoadASCIIFromString(&model, &err, &warn, rewritten.c_str(),
+			static_cast<unsigned int>(rewritten.size()), parentPath.string());
+	}
+	bool parseGlbChunks(const uint8_t* data, size_t size, std::span<const uint8_t>& json, std::span<const uint8_t>& bin)
+	{
+		constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+		constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+		constexpr uint32_t CHUNK_BIN = 0x004E4942;
+
+		uint32_t header[3];
+		if (size < sizeof(header) + 8)
+			return false;
+		memcpy(header, data, sizeof(header));
+		if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size)
+			return false;
+
+		json = {};
+		bin = {};
+		size_t offset = sizeof(header);
+		while (offset + 8 <= header[2])
+		{
+			uint32_t chunk[2]; //length, type
+			memcpy(chunk, data + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+			if (chunk[0] > header[2] - offset)
+				return false;
+
+			if (chunk[1] == CHUNK_JSON && json.empty())
+				json = std::span<const uint8_t>(data + offset, chunk[0]);
+			else if (chunk[1] == CHUNK_BIN && bin.empty())
+				bin = std::span<const uint8_t>(data + offset, chunk[0]);
+			//chunks are 4 byte aligned
+			offset += (chunk[0] + 3) & ~3u;
+		}
+		return !json.empty();
+	}
+	void LoadMesh::AddMeshPrimitives(int mesh_index, int hierarchyIndex)
+	{
+		const tinygltf::Mesh& mesh = model.meshes[mesh_index];
+
+		//A mesh can have multiple material so we also treat them as seperate meshes but we use same mesh index
+		for (uint32_t primitiveIndex = 0; primitiveIndex < static_cast<uint32_t>(mesh.primitives.size()); primitiveIndex++)
+		{
+			const tinygltf::Primitive& glTFPrimitive = mesh.primitives[primitiveIndex];
+			if (glTFPrimitive.mode != -1 && glTFPrimitive.mode != TINYGLTF_MODE_TRIANGLES)
+			{
+				GAIA_CORE_WARN("Skipping primitive {} of mesh {}, only triangle lists are supported", primitiveIndex, mesh.name);
+				continue;
+			}
+			auto position = glTFPrimitive.attributes.find("POSITION");
+			if (position == glTFPrimitive.attributes.end())
+			{
+				GAIA_CORE_WARN("Skipping primitive {} of mesh {}, it has no positions", primitiveIndex, mesh.name);
+				continue;
+			}
+
+			//the accessor counts are enough to reserve the ranges, nothing is decoded here
+			uint32_t vertexCount = static_cast<uint32_t>(model.accessors[position->second].count);
+			uint32_t indexCount = glTFPrimitive.indices != -1 ?
+				static_cast<uint32_t>(model.accessors[glTFPrimitive.indices].count) : vertexCount;
+
+			SubMesh subMesh{
+				.vertexOffset = m_subMeshes.empty() ? 0 : m_subMeshes.back().vertexOffset + m_subMeshes.back().vertexCount,
+				.vertexCount = vertexCount,
+				.indexOffset = m_subMeshes.empty() ? 0 : m_subMeshes.back().indexOffset + m_subMeshes.back().indexCount,
+				.indexCount = indexCount,
+				.materialId = (uint32_t)glTFPrimitive.material,
+				.meshIndex = hierarchyIndex,
+			};
+
 			//add new nodes
-			int childIdx = addNode(hierarchyIndex, 0);
-			//localTransforms[childIdx] = getTransform(mesh_index);
-			//globalTransforms[childIdx] = localTransforms.back();
-			m_nodeNames[childIdx] = model.materials[glTFPrimitive.material].name;
-			subMesh.numVertices = subMesh.Vertices.size();
-			m_subMeshes.insert({ childIdx ,std::move(subMesh) });
+			int childIdx = addNode(hierarchyIndex, m_hierarchy[hierarchyIndex].level + 1);
+			m_nodeNames[childIdx] = glTFPrimitive.material != -1 ? model.materials[glTFPrimitive.material].name : mesh.name;
+			subMesh.nodeIndex = childIdx;
+
+			m_subMeshes.push_back(subMesh);
+			m_primitiveSources.push_back(PrimitiveSource{ .mesh = mesh_index, .primitive = static_cast<int>(primitiveIndex) });
 		}
 		numMeshes++;
+	}
+	void LoadMesh::LoadVertexData(uint32_t subMeshIndex)
+	{
+		SubMesh& subMesh = m_subMeshes[subMeshIndex];
+		const PrimitiveSource& source = m_primitiveSources[subMeshIndex];
+		const tinygltf::Primitive& glTFPrimitive = model.meshes[source.mesh].primitives[source.primitive];
+
+		VertexAttributes* vertices = m_vertexData + subMesh.vertexOffset;
+		uint32_t* indices = m_indexData + subMesh.indexOffset;
 
+		//returns tightly packed floats of the attribute, decoded from quantized / strided / sparse data when needed
+		auto readAttribute = [&](const char* name, uint32_t expectedComponents, std::vector<float>& scratch) -> const float* {
+			auto attribute = glTFPrimitive.attributes.find(name);
+			if (attribute == glTFPrimitive.attributes.end())
+				return nullptr;
+
+			const tinygltf::Accessor& accessor = model.accessors[attribute->second];
+			if (GltfAccessor::numComponents(accessor) != expectedComponents || accessor.count < subMesh.vertexCount)
+			{
+				GAIA_CORE_WARN("Ignoring {} of mesh {}, unexpected accessor layout", name, model.meshes[source.mesh].name);
+				return nullptr;
+			}
+			const float* data = GltfAccessor::readFloats(model, m_buffers, accessor, scratch);
+			if (!data)
+				GAIA_CORE_ERROR("Failed to decode {} of mesh {}, the accessor is out of bounds", name, model.meshes[source.mesh].name);
+			return data;
+		};
+
+		//non indexed primitives draw every three vertices as a triangle
+		auto decodeIndices = [&](uint32_t* out) {
+			if (glTFPrimitive.indices == -1)
+			{
+				std::iota(out, out + subMesh.indexCount, 0u);
+				return;
+			}
+			if (!GltfAccessor::decodeIndices(model, m_buffers, model.accessors[glTFPrimitive.indices], out))
+			{
+				GAIA_CORE_ERROR("Failed to decode the indices of mesh {}, index component type not supported or out of bounds",
+					model.meshes[source.mesh].name);
+				memset(out, 0, sizeof(uint32_t) * subMesh.indexCount);
+			}
+		};
+
+		std::vector<float> positionScratch, normalScratch, tangentScratch, texCoordScratch;
+		const float* positionBuffer = readAttribute("POSITION", 3, positionScratch);
+		const float* normalsBuffer = readAttribute("NORMAL", 3, normalScratch);
+		const float* tangentsBuffer = readAttribute("TANGENT", 4, tangentScratch);
+		// glTF supports multiple sets, we only load the first one
+		const float* texCoordsBuffer = readAttribute("TEXCOORD_0", 2, texCoordScratch);
+		//TODO vertex colors, joints and weights
+
+		//missing tangents are generated from the source attributes before the vertices are written.
+		//The indices are needed first and go through scratch memory in that case
+		std::vector<uint32_t> indexScratch;
+		if (!tangentsBuffer && m_options.generateTangents && positionBuffer && normalsBuffer && texCoordsBuffer)
+		{
+			indexScratch.resize(subMesh.indexCount);
+			decodeIndices(indexScratch.data());
+			tangentScratch.resize(size_t(subMesh.vertexCount) * 4);
+			TangentGenerator::generate(indexScratch, positionBuffer, normalsBuffer, texCoordsBuffer, subMesh.vertexCount,
+				reinterpret_cast<glm::vec4*>(tangentScratch.data()));
+			tangentsBuffer = tangentScratch.data();
+		}
+
+		// Vertices
+		{
+			glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+			for (uint32_t vertexIterator = 0; vertexIterator < subMesh.vertexCount; ++vertexIterator)
+			{
+				glm::vec3 position = positionBuffer ? glm::make_vec3(&positionBuffer[vertexIterator * 3]) : glm::vec3(0.0f);
+				glm::vec3 normal = normalsBuffer ? glm::normalize(glm::make_vec3(&normalsBuffer[vertexIterator * 3])) : glm::vec3(0.0f);
+				glm::vec2 uv = texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[vertexIterator * 2]) : glm::vec2(0.0f);
+				glm::vec4 t = tangentsBuffer ? glm::make_vec4(&tangentsBuffer[vertexIterator * 4]) : glm::vec4(0.0f);
+
+				vertices[vertexIterator] = VertexAttributes(glm::vec4(position, 1.0), uv, normal, t,
+					subMesh.materialId, (uint32_t)subMesh.meshIndex);
+
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+			subMesh.boundsMin = boundsMin;
+			subMesh.boundsMax = boundsMax;
+		}
+		// Indices
+		{
+			if (!indexScratch.empty())
+				memcpy(indices, indexScratch.data(), sizeof(uint32_t) * subMesh.indexCount);
+			else
+				decodeIndices(indices);
+		}
+	}
+	void LoadMesh::processGeometry()
+	{
+		GAIA_TRACE_SCOPE("process geometry");
+		if (m_options.optimizeMeshes)
+			m_optimizationStats.resize(m_subMeshes.size());
+		//indices of the coarser levels of every sub mesh, offsets in SubMesh::lods are relative to its vector until they are placed
+		std::vector<std::vector<uint32_t>> lodIndices(m_subMeshes.size());
+		auto processSubMesh = [&](uint32_t subMeshIndex) {
+			SubMesh& subMesh = m_subMeshes[subMeshIndex];
+			if (m_options.optimizeMeshes)
+			{
+				m_optimizationStats[subMeshIndex] = MeshOptimizer::optimize(m_vertexData + subMesh.vertexOffset, subMesh.vertexCount,
+					m_indexData + subMesh.indexOffset, subMesh.indexCount);
+			}
+			if (m_options.lodLevels > 1)
+				generateLods(subMesh, lodIndices[subMeshIndex]);
+		};
+		auto subMeshIter = std::views::iota(uint32_t(0), uint32_t(m_subMeshes.size()));
+		if (m_options.parallelDecode)
+			std::for_each(std::execution::par, subMeshIter.begin(), subMeshIter.end(), processSubMesh);
+		else
+			std::for_each(subMeshIter.begin(), subMeshIter.end(), processSubMesh);
+
+		//welding shrinks the ranges, move them together. Offsets only decrease so a front to back pass never overwrites unmoved data
+		uint32_t vertexOffset = 0;
+		uint32_t indexOffset = 0;
+		for (SubMesh& subMesh : m_subMeshes)
+		{
+			memmove(m_vertexData + vertexOffset, m_vertexData + subMesh.vertexOffset, subMesh.vertexCount * sizeof(VertexAttributes));
+			memmove(m_indexData + indexOffset, m_indexData + subMesh.indexOffset, subMesh.indexCount * sizeof(uint32_t));
+			subMesh.vertexOffset = vertexOffset;
+			subMesh.indexOffset = indexOffset;
+			vertexOffset += subMesh.vertexCount;
+			indexOffset += subMesh.indexCount;
+		}
+
+		if (!m_optimizationStats.empty())
+		{
+			uint64_t missesBefore = 0, missesAfter = 0, trianglesBefore = 0, trianglesAfter = 0;
+			for (uint32_t subMeshIndex = 0; subMeshIndex < m_subMeshes.size(); subMeshIndex++)
+			{
+				const MeshOptimizationStats& stats = m_optimizationStats[subMeshIndex];
+				GAIA_CORE_TRACE("Sub mesh {}: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", m_nodeNames[m_subMeshes[subMeshIndex].nodeIndex],
+					stats.verticesBefore, stats.verticesAfter, stats.acmrBefore, stats.acmrAfter, stats.atvrBefore, stats.atvrAfter);
+				missesBefore += uint64_t(std::llround(stats.acmrBefore * stats.trianglesBefore));
+				missesAfter += uint64_t(std::llround(stats.acmrAfter * stats.trianglesAfter));
+				trianglesBefore += stats.trianglesBefore;
+				trianglesAfter += stats.trianglesAfter;
+			}
+			if (trianglesBefore > 0 && trianglesAfter > 0)
+			{
+				GAIA_CORE_INFO("Optimized {} sub meshes: {} -> {} vertices, ACMR {:.3f} -> {:.3f}", m_subMeshes.size(), m_numVertices, vertexOffset,
+					double(missesBefore) / trianglesBefore, double(missesAfter) / trianglesAfter);
+			}
+		}
+
+		//the coarser levels follow the full resolution indices of all sub meshes, so level 0 stays one contiguous range
+		const uint32_t fullResolutionIndices = indexOffset;
+		for (uint32_t subMeshIndex = 0; subMeshIndex < m_subMeshes.size(); subMeshIndex++)
+		{
+			SubMesh& subMesh = m_subMeshes[subMeshIndex];
+			for (uint32_t level = 1; level < subMesh.numLods; level++)
+				subMesh.lods[level - 1].indexOffset += indexOffset;
+			indexOffset += static_cast<uint32_t>(lodIndices[subMeshIndex].size());
+		}
+		if (indexOffset > fullResolutionIndices)
+		{
+			GAIA_CORE_INFO("Generated levels of detail, {} -> {} indices", fullResolutionIndices, indexOffset);
+		}
+
+		m_vertices.resize(vertexOffset);
+		m_indices.resize(indexOffset);
+		m_vertexData = m_vertices.data();
+		m_indexData = m_indices.data();
+		m_numVertices = vertexOffset;
+		m_numIndices = indexOffset;
+		uint32_t* lodDestination = m_indexData + fullResolutionIndices;
+		for (const std::vector<uint32_t>& levels : lodIndices)
+		{
+			lodDestination = std::copy(levels.begin(), levels.end(), lodDestination);
+		}
+
+		if (m_options.buildMeshlets)
+			buildMeshlets();
+	}
+	void LoadMesh::buildMeshlets()
+	{
+		struct SubMeshMeshlets
+		{
+			std::vector<Meshlet> meshlets;
+			std::vector<uint32_t> vertices;
+			std::vector<uint8_t> triangles;
+		};
+		std::vector<SubMeshMeshlets> subMeshMeshlets(m_subMeshes.size());
+		auto buildSubMesh = [&](uint32_t subMeshIndex) {
+			const SubMesh& subMesh = m_subMeshes[subMeshIndex];
+			SubMeshMeshlets& result = subMeshMeshlets[subMeshIndex];
+			MeshletBuilder::build({ m_indexData + subMesh.indexOffset, subMesh.indexCount }, { m_vertexData + subMesh.vertexOffset, subMesh.vertexCount },
+				subMesh.vertexOffset, result.meshlets, result.vertices, result.triangles);
+		};
+		auto subMeshIter = std::views::iota(uint32_t(0), uint32_t(m_subMeshes.size()));
+		if (m_options.parallelDecode)
+			std::for_each(std::execution::par, subMeshIter.begin(), subMeshIter.end(), buildSubMesh);
+		else
+			std::for_each(subMeshIter.begin(), subMeshIter.end(), buildSubMesh);
+
+		//concatenate, the per sub mesh offsets become scene wide ones
+		m_meshlets.clear();
+		m_meshletVertices.clear();
+		m_meshletTriangles.clear();
+		for (uint32_t subMeshIndex = 0; subMeshIndex < m_subMeshes.size(); subMeshIndex++)
+		{
+			SubMeshMeshlets& result = subMeshMeshlets[subMeshIndex];
+			SubMesh& subMesh = m_subMeshes[subMeshIndex];
+			subMesh.meshletOffset = static_cast<uint32_t>(m_meshlets.size());
+			subMesh.meshletCount = static_cast<uint32_t>(result.meshlets.size());
+			for (Meshlet& meshlet : result.meshlets)
+			{
+				meshlet.vertexOffset += static_cast<uint32_t>(m_meshletVertices.size());
+				meshlet.triangleOffset += static_cast<uint32_t>(m_meshletTriangles.size());
+			}
+			m_meshlets.insert(m_meshlets.end(), result.meshlets.begin(), result.meshlets.end());
+			m_meshletVertices.insert(m_meshletVertices.end(), result.vertices.begin(), result.vertices.end());
+			m_meshletTriangles.insert(m_meshletTriangles.end(), result.triangles.begin(), result.triangles.end());
+		}
+		GAIA_CORE_INFO("Built {} meshlets", m_meshlets.size());
+	}
+	void LoadMesh::generateLods(SubMesh& subMesh, std::vector<uint32_t>& lodIndices) const
+	{
+		//a level that removes less than this fraction of the previous one is not worth its memory, the next ones would not get coarser either
+		constexpr float MIN_LOD_REDUCTION = 0.15f;
+
+		std::span<const VertexAttributes> vertices(m_vertexData + subMesh.vertexOffset, subMesh.vertexCount);
+		std::span<const uint32_t> indices(m_indexData + subMesh.indexOffset, subMesh.indexCount);
+		const float radius = 0.5f * glm::length(subMesh.boundsMax - subMesh.boundsMin);
+		if (indices.size() < 3 || !(radius > 0.0f))
+			return;
+
+		//every level is simplified from the full resolution mesh so the errors are measured against the original surface
+		const uint32_t numLevels = std::min(m_options.lodLevels, SubMesh::MAX_LODS);
+		uint32_t previousCount = subMesh.indexCount;
+		float previousError = 0.0f;
+		subMesh.numLods = 1;
+		for (uint32_t level = 1; level < numLevels; level++)
+		{
+			uint32_t targetCount = static_cast<uint32_t>(previousCount * m_options.lodReduction) / 3 * 3;
+			size_t first = lodIndices.size();
+			lodIndices.resize(first + indices.size());
+			float error = 0.0f;
+			uint32_t count = MeshSimplifier::simplify(lodIndices.data() + first, indices, vertices, targetCount, m_options.lodMaxError * radius, &error);
+			if (count == 0 || count > previousCount * (1.0f - MIN_LOD_REDUCTION))
+			{
+				lodIndices.resize(first);
+				break;
+			}
+			lodIndices.resize(first + count);
+			if (m_options.optimizeMeshes)
+				MeshOptimizer::optimizeVertexCache({ lodIndices.data() + first, count }, subMesh.vertexCount);
+
+			previousError = std::max(previousError, error);
+			subMesh.lods[level - 1] = SubMeshLod{
+				.indexOffset = static_cast<uint32_t>(first),
+				.indexCount = count,
+				.error = previousError,
+			};
+			subMesh.numLods++;
+			previousCount = count;
+		}
 	}
 	void LoadMesh::LoadTextures()
 	{
+		GAIA_TRACE_SCOPE("load textures");
 		fs::path meshPath = m_path;
 
 		fs::path parentPath = meshPath.parent_path();
 		size_t numTextures = model.images.size();
 		gltfTextures.resize(numTextures);
+		const bool processTextures = m_options.generateMips || m_options.compressTextures;
+		const std::vector<TextureRole> roles = processTextures ? getTextureRoles() : std::vector<TextureRole>(numTextures, TextureRole_Unused);
 
-		auto iter = std::views::iota(model.images.begin(), model.images.end());
-		std::for_each(std::execution::par, iter.begin(), iter.end(), [&](auto&& texIterator) {
-			Texture texture;
-			/*fs::path imagePath = model.images[imageIndex].uri;
-
-			fs::path absolutePath = parentPath / imagePath;*/
-			tinygltf::Image& glTFImage = model.images[texIterator - model.images.begin()];
-
-			uint8_t* buffer;
-			uint64_t bufferSize;
-			texture.width = glTFImage.width;
-			texture.height = glTFImage.height;
-			texture.num_channels = glTFImage.component;
-
-			if (glTFImage.component == 3)
+		std::atomic<uint64_t> bytesBefore = 0, bytesAfter = 0;
+		auto loadTexture = [&](size_t imageIndex, ImageDecoder::Image&& decoded) {
+			tinygltf::Image& glTFImage = model.images[imageIndex];
+			Texture& texture = gltfTextures[imageIndex];
+			if (m_imageDecoder && !decoded.isValid)
+			{
+				//magenta placeholder, the error was logged by the decoder
+				texture.textureData = { 255, 0, 255, 255 };
+			}
+			else
 			{
-				bufferSize = glTFImage.width * glTFImage.height * 4;
-				std::vector<uint8_t> imageData(bufferSize, 0);
-				//buffer = new uint8_t[bufferSize]{};
+				if (m_imageDecoder)
+				{
+					glTFImage.width = decoded.width;
+					glTFImage.height = decoded.height;
+					glTFImage.component = decoded.component;
+					glTFImage.bits = decoded.bits;
+					glTFImage.image = std::move(decoded.pixels);
+				}
+				texture.width = glTFImage.width;
+				texture.height = glTFImage.height;
+				texture.num_channels = glTFImage.component;
 
-				buffer = (uint8_t*)imageData.data();
-				uint8_t* rgba = buffer;
-				uint8_t* rgb = &glTFImage.image[0];
-				for (int j = 0; j < glTFImage.width * glTFImage.height; ++j)
+				//the decoded image is not used after this, so RGBA data is handed over instead of copied
+				const size_t numPixels = size_t(glTFImage.width) * size_t(glTFImage.height);
+				if (glTFImage.bits == 8 && glTFImage.component > 0 && glTFImage.component < 4 && glTFImage.image.size() >= numPixels * glTFImage.component)
+				{
+					texture.textureData.resize(numPixels * 4);
+					ImageConvert::expandToRgba(glTFImage.image.data(), numPixels, glTFImage.component, texture.textureData.data());
+					texture.num_channels = 4;
+					glTFImage.image = {};
+				}
+				else
 				{
-					memcpy(rgba, rgb, sizeof(uint8_t) * 3);
-					rgba += 4;
-					rgb += 3;
+					texture.textureData = std::move(glTFImage.image);
 				}
 			}
-			else
+
+			if (roles[imageIndex] == TextureRole_Unused)
+				return;
+			GAIA_TRACE_SCOPE("process texture");
+			const uint64_t size = texture.textureData.size();
+			if (processTexture(imageIndex, roles[imageIndex]))
 			{
-				buffer = &glTFImage.image[0];
-				bufferSize = glTFImage.image.size();
+				bytesBefore += size;
+				bytesAfter += texture.textureData.size();
 			}
-			texture.textureData.resize(bufferSize);
-			for (int i = 0; i < bufferSize; i++)
+			};
+
+		if (m_imageDecoder)
+		{
+			//the textures are processed in the order their images finish decoding, on the decoder workers right after the
+			//decode, so the mips and the block compression of one image overlap the decoding of the others
+			std::vector<uint8_t> isLoaded(numTextures, 0);
+			m_imageDecoder->consumeAll([&](uint32_t imageIndex, ImageDecoder::Image&& decoded) {
+				if (imageIndex >= numTextures)
+					return;
+				isLoaded[imageIndex] = 1;
+				loadTexture(imageIndex, std::move(decoded));
+				});
+			//images tinygltf never handed to the decoder get the placeholder
+			for (size_t imageIndex = 0; imageIndex < numTextures; imageIndex++)
 			{
-				texture.textureData[i] = buffer[i];
+				if (!isLoaded[imageIndex])
+					loadTexture(imageIndex, {});
 			}
-			gltfTextures[texIterator - model.images.begin()] = texture;
-			});
+		}
+		else
+		{
+			auto iter = std::views::iota(size_t(0), numTextures);
+			std::for_each(std::execution::par, iter.begin(), iter.end(), [&](size_t imageIndex) {
+				loadTexture(imageIndex, {});
+				});
+		}
+		m_imageDecoder.reset();
+		if (bytesBefore > 0)
+		{
+			GAIA_CORE_INFO("Processed textures (mips: {}, block compression: {}), {:.1f} MB -> {:.1f} MB", m_options.generateMips, m_options.compressTextures,
+				bytesBefore / (1024.0 * 1024.0), bytesAfter / (1024.0 * 1024.0));
+		}
 
 		//for (uint32_t imageIndex = 0; imageIndex < numTextures; ++imageIndex)
 		//{
@@ -487,6 +1120,47 @@ namespace Gaia
 		//	gltfTextures.push_back(texture);
 		//}
 	}
+	std::vector<LoadMesh::TextureRole> LoadMesh::getTextureRoles() const
+	{
+		std::vector<TextureRole> roles(model.images.size(), TextureRole_Unused);
+		auto useAs = [&](int textureIndex, TextureRole role) {
+			if (textureIndex < 0 || size_t(textureIndex) >= roles.size())
+				return;
+			TextureRole& current = roles[textureIndex];
+			current = current == TextureRole_Unused || current == role ? role : TextureRole_Mixed;
+		};
+		for (const Material& material : pbrMaterials)
+		{
+			useAs(material.baseColorTexture, TextureRole_BaseColor);
+			useAs(material.normalTexture, TextureRole_Normal);
+			useAs(material.metallicRoughnessTexture, TextureRole_MetallicRoughness);
+		}
+		return roles;
+	}
+	bool LoadMesh::processTexture(size_t textureIndex, TextureRole role)
+	{
+		Texture& texture = gltfTextures[textureIndex];
+		if (m_options.generateMips)
+		{
+			TextureMips::MipFilter filter = role == TextureRole_BaseColor ? TextureMips::MipFilter_SRGB : role == TextureRole_Normal ? TextureMips::MipFilter_NormalMap : TextureMips::MipFilter_Linear;
+			if (!TextureMips::generate(texture, filter))
+			{
+				GAIA_CORE_WARN("Texture {} ({}x{}) has no 8 bit RGBA texels, no mip chain is generated", textureIndex, texture.width, texture.height);
+				return false;
+			}
+		}
+
+		if (m_options.compressTextures && role != TextureRole_Mixed)
+		{
+			TextureEncoding encoding = role == TextureRole_BaseColor ? TextureEncoding_BC7 : role == TextureRole_Normal ? TextureEncoding_BC5 : TextureEncoding_BC1;
+			if (!TextureCompressor::compress(texture, encoding))
+			{
+				GAIA_CORE_WARN("Texture {} ({}x{}) has no 8 bit RGBA texels and stays uncompressed", textureIndex, texture.width, texture.height);
+				return false;
+			}
+		}
+		return true;
+	}
 	void LoadMesh::LoadMatrials()
 	{
 		size_t numMaterials = model.materials.size();
@@ -540,6 +1214,15 @@ namespace Gaia
 				tinygltf::Texture& metallicRoughnessTexture = model.textures[MetallicRoughnessTextureIndex];
 				material.metallicRoughnessTexture = metallicRoughnessTexture.source;
 			}
+
+			//the deferred renderer cannot blend, blended materials are alpha tested instead
+			if ((*matIterator).alphaMode != "OPAQUE")
+			{
+				material.features |= MaterialFeatures_AlphaTest;
+				material.alphaCutoff = (*matIterator).alphaMode == "MASK" ? static_cast<float>((*matIterator).alphaCutoff) : 0.5f;
+			}
+			if ((*matIterator).doubleSided)
+				material.features |= MaterialFeatures_DoubleSided;
 			pbrMaterials[matIterator - model.materials.begin()] = material;
 			});
 		//for (int i = 0; i < numMaterials; i++)
@@ -3,7 +3,10 @@
 #include "glm/glm.hpp"
 #include <glm/gtc/type_ptr.hpp>
 #include "Gaia/Material.h"
+#include "Gaia/MappedFile.h"
+#include "Gaia/ImageDecoder.h"
 #include <limits>
+#include <span>
 
 #define GL_BYTE 0x1400           // 5120
 #define GL_UNSIGNED_BYTE 0x1401  // 5121
@@ -22,23 +25,70 @@ struct aiNode;
 struct aiScene;
 namespace Gaia
 {
+	//simplified index range of a sub mesh, it references the same vertices as the full resolution mesh
+	struct SubMeshLod
+	{
+		uint32_t indexOffset = 0; //first index in LoadMesh::getIndices()
+		uint32_t indexCount = 0;
+		float error = 0.0f; //object space distance the simplified surface may deviate from the original
+	};
+	//a sub mesh is one glTF primitive, it is a range in the scene wide vertex and index arrays of LoadMesh
 	struct SubMesh
 	{
-		std::vector<glm::vec3> Vertices;
-		std::vector<glm::vec3> Normal;
-		std::vector<glm::vec3> Tangent;
-		std::vector<glm::vec3> BiTangent;
-		std::vector<glm::vec2> TexCoord;
-		std::vector<uint32_t> indices;
-		std::vector<uint32_t> m_MaterialID; //storing material id per vertex
-		std::vector<uint32_t> meshIndices; //storing mesh id per vertex
-
-		/*VkBufferCreator vk_mesh_vertex_buffer;
-		VkBufferCreator vk_mesh_index_buffer;*/
-
-		//ref<VertexArray> VertexArray;
-		uint32_t numVertices;
-		//Bounds mesh_bounds; //sub_mesh bounds
+		static constexpr uint32_t MAX_LODS = 4; //including the full resolution level
+
+
+		uint32_t vertexOffset = 0; //first vertex in LoadMesh::getVertices()
+		uint32_t vertexCount = 0;
+		uint32_t indexOffset = 0; //first index in LoadMesh::getIndices(), indices are relative to vertexOffset
+		uint32_t indexCount = 0;
+		uint32_t materialId = 0;
+		int meshIndex = -1; //hierarchy node whose global transform is applied to the sub mesh
+		int nodeIndex = -1; //hierarchy node created for the sub mesh itself
+		//object space bounds of the sub mesh
+		glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+		//level 0 is the range above, the coarser levels are stored behind the full resolution indices of all sub meshes
+		uint32_t numLods = 1;
+		SubMeshLod lods[MAX_LODS - 1] = {};
+		//clusters of the full resolution level, a range in LoadMesh::m_meshlets
+		uint32_t meshletOffset = 0;
+		uint32_t meshletCount = 0;
+
+		inline SubMeshLod getLod(uint32_t level) const
+		{
+			return level == 0 ? SubMeshLod{ .indexOffset = indexOffset, .indexCount = indexCount } : lods[level - 1];
+		}
+	};
+	//small cluster of a sub mesh (see MeshletBuilder.h). The triangles index a local vertex list which holds scene wide vertex indices,
+	//so meshlets read straight from the shared vertex buffer
+	struct Meshlet
+	{
+		uint32_t vertexOffset = 0; //first entry in LoadMesh::m_meshletVertices
+		uint32_t triangleOffset = 0; //first byte in LoadMesh::m_meshletTriangles, 3 local indices per triangle
+		uint32_t vertexCount = 0;
+		uint32_t triangleCount = 0;
+		//object space bounding sphere
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+		//normal cone, the meshlet faces away from a camera at p if dot(normalize(coneApex - p), coneAxis) >= coneCutoff
+		glm::vec3 coneApex = glm::vec3(0.0f);
+		float coneCutoff = 1.0f; //1 disables the cone test
+		glm::vec3 coneAxis = glm::vec3(0.0f);
+		float _pad = 0.0f;
+	};
+	//post transform vertex cache statistics of a sub mesh before and after the import time optimization (see MeshOptimizer.h),
+	//simulated with a MeshOptimizer::CACHE_SIZE entry FIFO
+	struct MeshOptimizationStats
+	{
+		uint32_t verticesBefore = 0;
+		uint32_t verticesAfter = 0;
+		uint32_t trianglesBefore = 0;
+		uint32_t trianglesAfter = 0;
+		float acmrBefore = 0.0f; //cache misses per triangle
+		float atvrBefore = 0.0f; //cache misses per referenced vertex
+		float acmrAfter = 0.0f;
+		float atvrAfter = 0.0f;
 	};
 	struct Hierarchy
 	{
@@ -52,12 +102,88 @@ namespace Gaia
 		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
 		glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
 	};
+	struct VertexAttributes {
+		glm::vec4 Position;
+		glm::vec2 TextureCoordinate;
+		glm::vec3 Normal;
+		glm::vec4 Tangent; //unit tangent in xyz, the bitangent is cross(Normal, Tangent) * w. All zero without tangents
+		uint32_t materialId;
+		uint32_t meshId;
+		VertexAttributes(const glm::vec4& Position, const glm::vec2& TextureCoordinate, const glm::vec3& normal = { 0,0,0 }, const glm::vec4& Tangent = { 0,0,0,0 }, const uint32_t& materialId = 0u, const uint32_t& meshId = 0)
+		{
+			this->Position = Position;
+			this->TextureCoordinate = TextureCoordinate;
+			Normal = normal;
+			this->Tangent = Tangent;
+			this->materialId = materialId;
+			this->meshId = meshId;
+		}
+		VertexAttributes() = default;
+	};
+	//what happens to the CPU copies of the textures and the geometry once the renderer has uploaded them (see LoadMesh::releaseCpuData)
+	enum CpuResidency : uint8_t
+	{
+		CpuResidency_Drop = 0, //freed, textures that are not in the scene cache are uploaded with every level instead of being streamed
+		CpuResidency_Keep, //kept in memory for CPU consumers and for streaming the textures from memory
+		CpuResidency_Spill, //written to a temporary file at load and memory mapped after the upload, the geometry stays readable
+	};
+	//bytes of the loaded scene that are held in memory, the mapped spill file is only counted in spilledBytes
+	struct CpuMemoryStats
+	{
+		uint64_t textureBytes = 0;
+		uint64_t vertexBytes = 0;
+		uint64_t indexBytes = 0;
+		uint64_t meshletBytes = 0;
+		uint64_t spilledBytes = 0;
+	};
+	struct MeshLoadOptions
+	{
+		//load from / write to the cooked scene file next to the glTF (see SceneCache.h)
+		bool useSceneCache = true;
+		//decode the primitives on all cores, every primitive owns a disjoint range so the result is the same as the serial path
+		bool parallelDecode = true;
+		//memory map the .glb / external .bin files and read the accessors straight out of the mapping instead of
+		//letting tinygltf copy every buffer to the heap. The mappings are released once the geometry is decoded.
+		bool mapBuffers = false;
+		//weld duplicate vertices and reorder every sub mesh for the vertex cache, overdraw and vertex fetch (see MeshOptimizer.h)
+		bool optimizeMeshes = true;
+		//levels of detail per sub mesh including the full resolution one, clamped to SubMesh::MAX_LODS. 1 disables the simplification
+		uint32_t lodLevels = SubMesh::MAX_LODS;
+		//target triangle count of a level relative to the previous one
+		float lodReduction = 0.5f;
+		//largest simplification error relative to the bounding sphere radius of the sub mesh
+		float lodMaxError = 0.05f;
+		//split the full resolution level of every sub mesh into meshlets with bounds and normal cones for cluster culling
+		bool buildMeshlets = true;
+		//compute MikkTSpace style tangents (see TangentGenerator.h) for primitives that have normals and uvs but no TANGENT attribute
+		bool generateTangents = true;
+		//let stb_image write RGBA while decoding so the decoded images are moved into the textures without another pass.
+		//When false images keep their channel count until LoadTextures expands them with SIMD, which needs less memory during the decode
+		bool decodeImagesToRgba = true;
+		//decode the images on a worker pool (see ImageDecoder.h) while the glTF is parsed and the geometry is decoded,
+		//instead of one after the other inside the tinygltf parse
+		bool deferImageDecoding = true;
+		//block compress the textures at import: BC7 for base color, BC5 for normal maps and BC1 for metallic roughness.
+		//The compressed blocks are stored in the scene cache, so the compression only runs on the first load
+		bool compressTextures = true;
+		//generate the full mip chain of every texture on the CPU, base color is filtered in linear space and normal maps are renormalized.
+		//The levels are stored after the top level in Texture::textureData and cooked into the scene cache with the texels
+		bool generateMips = true;
+		//residency of the CPU side textures and geometry after the upload, the sub meshes, materials and meshlet bounds always stay
+		CpuResidency residency = CpuResidency_Drop;
+		//writes a timeline of the load stages to this path (see Trace.h), empty records nothing
+		std::string tracePath;
+	};
+
+	//splits a binary glTF container into its JSON and BIN chunk, returns false if the header is invalid. bin is empty if the file has no BIN chunk
+	bool parseGlbChunks(const uint8_t* data, size_t size, std::span<const uint8_t>& json, std::span<const uint8_t>& bin);
 	class LoadMesh
 	{
 	public:
-		
+		using VertexAttributes = Gaia::VertexAttributes;
+
 		LoadMesh();
-		LoadMesh(const std::string& Path);
+		LoadMesh(const std::string& Path, const MeshLoadOptions& options = {});
 		void calculateSceneBounds();
 		~LoadMesh();
 		void clear() {
@@ -65,33 +191,45 @@ namespace Gaia
 			gltfTextures.clear();
 			m_subMeshes.clear();
 			pbrMaterials.clear();
+			m_optimizationStats.clear();
+			m_meshlets.clear();
+			m_meshletVertices.clear();
+			m_meshletTriangles.clear();
+			m_vertices.clear();
+			m_indices.clear();
+			m_vertexData = nullptr;
+			m_indexData = nullptr;
+			m_numVertices = 0;
+			m_numIndices = 0;
+			m_cacheFile.close();
 		}
-		/*void CreateLOD(const std::string& Path, LoadType type = LoadType::LOAD_MESH);
-		LoadMesh* GetLOD(int lodIndex);*/
+		//sizes the scene wide geometry arrays in memory owned by the mesh
+		void allocateGeometry(size_t numVertices, size_t numIndices);
+		//points the geometry at read only memory that outlives every use of getVertices()/getIndices(), e.g. the mapped scene cache
+		void mapGeometry(const VertexAttributes* vertices, size_t numVertices, const uint32_t* indices, size_t numIndices);
+		inline std::span<VertexAttributes> getVertices() { return { m_vertexData, m_numVertices }; }
+		inline std::span<uint32_t> getIndices() { return { m_indexData, m_numIndices }; }
+		inline std::span<const VertexAttributes> getVertices() const { return { m_vertexData, m_numVertices }; }
+		inline std::span<const uint32_t> getIndices() const { return { m_indexData, m_numIndices }; }
+		//false when the geometry lives in the spill file or the scene cache
+		inline bool ownsGeometry() const { return m_vertexData == m_vertices.data(); }
+
+		//applies MeshLoadOptions::residency, call once every texture and buffer has been uploaded
+		void releaseCpuData();
+		CpuMemoryStats getCpuMemoryStats() const;
 
 	public:
 		SceneBounds sceneBounds_;
-		struct VertexAttributes {
-			glm::vec4 Position;
-			glm::vec2 TextureCoordinate;
-			glm::vec3 Normal;
-			glm::vec3 Tangent;
-			uint32_t materialId;
-			uint32_t meshId;
-			VertexAttributes(const glm::vec4& Position, const glm::vec2& TextureCoordinate, const glm::vec3& normal = { 0,0,0 }, const glm::vec3& Tangent = { 0,0,0 }, const uint32_t& materialId = 0u, const uint32_t& meshId = 0)
-			{
-				this->Position = Position;
-				this->TextureCoordinate = TextureCoordinate;
-				Normal = normal;
-				this->Tangent = Tangent;
-				this->materialId = materialId;
-				this->meshId = meshId;
-			}
-			VertexAttributes() = default;
-		};
 		std::string m_path;
+		std::string m_cachePath; //cooked scene or spill file the textures can be streamed from (see Texture::cacheOffset), empty if there is none
+		MappedFile m_cacheFile; //cooked scene the geometry and Texture::mappedData are read from in place, closed if it was not loaded
+		MeshLoadOptions m_options;
 		std::vector<std::string> m_nodeNames;
-		std::unordered_map<int, SubMesh> m_subMeshes;
+		std::vector<SubMesh> m_subMeshes;
+		std::vector<MeshOptimizationStats> m_optimizationStats; //one per sub mesh, empty if the meshes were not optimized
+		std::vector<Meshlet> m_meshlets;
+		std::vector<uint32_t> m_meshletVertices; //scene wide vertex indices
+		std::vector<uint8_t> m_meshletTriangles; //meshlet local vertex indices, every meshlet starts 4 byte aligned
 		std::vector<Material> pbrMaterials;
 		std::vector<Texture> gltfTextures;
 		std::vector<glm::mat4> localTransforms;
@@ -101,31 +239,55 @@ namespace Gaia
 		tinygltf::Model model;
 		tinygltf::TinyGLTF loader;
 		int numMeshes = 0;//mesh count we get from gltf mesh
+
+		std::vector<VertexAttributes> m_vertices;
+		std::vector<uint32_t> m_indices;
+		VertexAttributes* m_vertexData = nullptr;
+		uint32_t* m_indexData = nullptr;
+		size_t m_numVertices = 0;
+		size_t m_numIndices = 0;
+
+		struct PrimitiveSource
+		{
+			int mesh = -1;
+			int primitive = -1;
+		};
+		std::vector<PrimitiveSource> m_primitiveSources; //glTF primitive of every sub mesh, only valid while importing
+
+		//data of every glTF buffer, points either into model.buffers or into one of the mapped files
+		std::vector<std::span<const uint8_t>> m_buffers;
+		std::vector<MappedFile> m_mappedFiles;
+		std::vector<std::span<const uint8_t>> m_mappedImages; //encoded images tinygltf reads back through the fs callbacks
+		std::unique_ptr<ImageDecoder> m_imageDecoder; //only alive while importing with MeshLoadOptions::deferImageDecoding
+
+		//CpuResidency_Spill: textures that are not cooked, then the vertices and indices
+		std::string m_spillPath;
+		MappedFile m_spillFile;
+		uint64_t m_spillVertexOffset = 0;
+		uint64_t m_spillIndexOffset = 0;
 	private:
+		void load(const std::string& Path); //reads the scene cache or imports the glTF
 		int addNode(int parentIndex, int level); //adds a new node to the hierarchy and returns the new node index
+		void sortHierarchyByLevel(); //renumbers the nodes level by level, see Scene::updateTransforms
 		void parse_scene_rec(tinygltf::Node& node, glm::mat4 nodeTransform, int Index, int parentIndex, int level);
 		void getTotalNodes(tinygltf::Node& node, int& totalNodes);
-		void LoadObj(const std::string& Path);
+		bool LoadObj(const std::string& Path);
+		bool LoadMapped(const std::string& Path, std::string& err, std::string& warn);
 		void LoadTextures();
 		void LoadMatrials();
+		//the mip filter and block format of a texture follow how the materials sample it,
+		//textures used in more than one role get a plain linear filter and stay uncompressed
+		enum TextureRole : uint32_t { TextureRole_Unused = 0, TextureRole_BaseColor, TextureRole_Normal, TextureRole_MetallicRoughness, TextureRole_Mixed };
+		std::vector<TextureRole> getTextureRoles() const;
+		//generates the mips and block compresses one texture, returns false if its texels are not 8 bit RGBA
+		bool processTexture(size_t textureIndex, TextureRole role);
 		glm::mat4 getTransform(int nodeIndex);
-		void LoadVertexData(int mesh_index, int hierarchyIndex, int level);
-		template <typename T>
-		int LoadAccessor(const tinygltf::Accessor& accessor, const T*& pointer, uint32_t* count = nullptr, int* type = nullptr)
-		{
-			const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-			pointer =
-				reinterpret_cast<const T*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-			if (count)
-			{
-				*count = static_cast<uint32_t>(accessor.count);
-			}
-			if (type)
-			{
-				*type = accessor.type;
-			}
-			return accessor.componentType;
-		}
+		void AddMeshPrimitives(int mesh_index, int hierarchyIndex);
+		void LoadVertexData(uint32_t subMeshIndex);
+		void processGeometry(); //optimization, lod and meshlet generation
+		void generateLods(SubMesh& subMesh, std::vector<uint32_t>& lodIndices) const;
+		void buildMeshlets();
+		bool spillToDisk(); //writes the spill file, releaseCpuData maps it
 	};
 }
 
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Gaia
+{
+	MappedFile::MappedFile(const std::string& path)
+	{
+		open(path);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			close();
+			std::swap(data_, other.data_);
+			std::swap(size_, other.size_);
+#if defined(_WIN32)
+			std::swap(file_, other.file_);
+			std::swap(mapping_, other.mapping_);
+#else
+			std::swap(fd_, other.fd_);
+#endif
+		}
+		return *this;
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize = {};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		file_ = file;
+		mapping_ = mapping;
+		data_ = static_cast<const uint8_t*>(view);
+		size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st = {};
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+		fd_ = fd;
+		data_ = static_cast<const uint8_t*>(view);
+		size_ = static_cast<size_t>(st.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+#if defined(_WIN32)
+		if (data_)
+			UnmapViewOfFile(data_);
+		if (mapping_)
+			CloseHandle(mapping_);
+		if (file_)
+			CloseHandle(file_);
+		mapping_ = nullptr;
+		file_ = nullptr;
+#else
+		if (data_)
+			munmap(const_cast<uint8_t*>(data_), size_);
+		if (fd_ >= 0)
+			::close(fd_);
+		fd_ = -1;
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+}
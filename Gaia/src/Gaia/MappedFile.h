@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace Gaia
+{
+	//read only memory mapping of a file on disk. The view stays valid until the object is closed or destroyed.
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		bool open(const std::string& path);
+		void close();
+
+		inline bool isOpen() const { return data_ != nullptr; }
+		inline const uint8_t* data() const { return data_; }
+		inline size_t size() const { return size_; }
+
+	private:
+		const uint8_t* data_ = nullptr;
+		size_t size_ = 0;
+#if defined(_WIN32)
+		void* file_ = nullptr;
+		void* mapping_ = nullptr;
+#else
+		int fd_ = -1;
+#endif
+	};
+}
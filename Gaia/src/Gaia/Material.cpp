@@ -1,2 +1,17 @@
 #include "pch.h"
 #include "Material.h"
+
+namespace Gaia
+{
+	uint32_t Material::getFeatures() const
+	{
+		uint32_t result = features & (MaterialFeatures_AlphaTest | MaterialFeatures_DoubleSided);
+		if (baseColorTexture != -1)
+			result |= MaterialFeatures_BaseColorTexture;
+		if (metallicRoughnessTexture != -1)
+			result |= MaterialFeatures_MetallicRoughnessTexture;
+		if (normalTexture != -1)
+			result |= MaterialFeatures_NormalTexture;
+		return result;
+	}
+}
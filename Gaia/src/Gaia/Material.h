@@ -1,9 +1,23 @@
 #pragma once
 #include "glm/glm.hpp"
+#include <span>
 
 namespace Gaia
 {
 
+//what a material needs from the g buffer shader, every feature set the scene uses gets its own pipeline with the
+//features as specialization constant, so the shader has no runtime branches and opaque materials keep early depth testing
+enum MaterialFeatures : uint32_t
+{
+	MaterialFeatures_None = 0,
+	MaterialFeatures_AlphaTest = 1 << 0, //discards texels below alphaCutoff, blended glTF materials are tested too
+	MaterialFeatures_DoubleSided = 1 << 1, //drawn without back face culling
+	MaterialFeatures_BaseColorTexture = 1 << 2,
+	MaterialFeatures_MetallicRoughnessTexture = 1 << 3,
+	MaterialFeatures_NormalTexture = 1 << 4,
+	MaterialFeatures_Count = 1 << 5,
+};
+
 struct Material
 {
 	glm::vec4 baseColorFactor = glm::vec4(1.0);
@@ -15,16 +29,36 @@ struct Material
 	int metallicRoughnessTexture = -1;
 	int normalTexture = -1;
 
-	int _pad1 = 0;
-	int _pad2 = 0;
+	uint32_t features = MaterialFeatures_None; //alpha test and double sided, the texture features follow the indices
+	float alphaCutoff = 0.5f;
 
+	//stored features combined with the textures the material has
+	uint32_t getFeatures() const;
+};
+
+//layout of Texture::textureData, the block compressed encodings store 4x4 texel blocks row by row (see TextureCompressor.h)
+enum TextureEncoding : uint32_t
+{
+	TextureEncoding_RGBA8 = 0,
+	TextureEncoding_BC1, //RGB, 8 bytes per block
+	TextureEncoding_BC3, //RGBA, BC4 alpha block followed by a BC1 color block
+	TextureEncoding_BC4, //R, 8 bytes per block
+	TextureEncoding_BC5, //RG, two BC4 blocks
+	TextureEncoding_BC7, //RGBA, 16 bytes per block
 };
 
 struct Texture {
 	int width = 1;
 	int height = 1;
 	int num_channels = 4;
-	std::vector<uint8_t> textureData = {};
+	TextureEncoding encoding = TextureEncoding_RGBA8;
+	uint32_t numMips = 1;
+	std::vector<uint8_t> textureData = {}; //every mip level back to back, starting with the full resolution one (see TextureMips.h)
+	uint64_t cacheOffset = 0; //where the same texels start in the cooked scene file, 0 if the texture is not cooked (see SceneCache.h)
+	std::span<const uint8_t> mappedData = {}; //the texels in the mapped scene cache, textureData stays empty then (see LoadMesh::m_cacheFile)
+
+	//every mip level back to back, wherever they live
+	inline std::span<const uint8_t> getTexels() const { return mappedData.empty() ? std::span<const uint8_t>(textureData) : mappedData; }
 };
 }
 
@@ -0,0 +1,382 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+#include "Log.h"
+#include "Core.h"
+#include <bit>
+
+namespace Gaia
+{
+	namespace MeshOptimizer
+	{
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+		//FIFO post transform cache, a vertex is resident while fewer than cacheSize misses happened since it was loaded
+		struct FifoCache
+		{
+			std::vector<uint32_t> timestamps;
+			uint32_t time;
+			uint32_t cacheSize;
+
+			FifoCache(uint32_t numVertices, uint32_t cacheSize)
+				:timestamps(numVertices, 0), time(cacheSize + 1), cacheSize(cacheSize)
+			{
+			}
+			//returns true on a miss
+			inline bool access(uint32_t vertex)
+			{
+				if (time - timestamps[vertex] <= cacheSize)
+					return false;
+				timestamps[vertex] = time++;
+				return true;
+			}
+			inline uint32_t triangleMisses(const uint32_t* triangle)
+			{
+				return uint32_t(access(triangle[0])) + uint32_t(access(triangle[1])) + uint32_t(access(triangle[2]));
+			}
+			//evicts everything
+			inline void flush()
+			{
+				time += cacheSize + 1;
+			}
+		};
+
+		CacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t numVertices, uint32_t cacheSize)
+		{
+			CacheStats stats;
+			if (indices.size() < 3)
+				return stats;
+
+			FifoCache cache(numVertices, cacheSize);
+			std::vector<uint8_t> referenced(numVertices, 0);
+			uint32_t misses = 0;
+			uint32_t numReferenced = 0;
+			for (size_t i = 0; i + 3 <= indices.size(); i += 3)
+			{
+				misses += cache.triangleMisses(indices.data() + i);
+				for (int k = 0; k < 3; k++)
+				{
+					numReferenced += referenced[indices[i + k]] == 0;
+					referenced[indices[i + k]] = 1;
+				}
+			}
+			stats.acmr = float(misses) / float(indices.size() / 3);
+			stats.atvr = float(misses) / float(numReferenced);
+			return stats;
+		}
+
+		static uint32_t hashVertex(const VertexAttributes& v)
+		{
+			//fnv-1a over the attribute bits, the ids are the same for every vertex of a sub mesh
+			uint32_t bits[15];
+			memcpy(bits, &v.Position, sizeof(glm::vec4));
+			memcpy(bits + 4, &v.TextureCoordinate, sizeof(glm::vec2));
+			memcpy(bits + 6, &v.Normal, sizeof(glm::vec3));
+			memcpy(bits + 9, &v.Tangent, sizeof(glm::vec4));
+			bits[13] = v.materialId;
+			bits[14] = v.meshId;
+			uint32_t hash = 2166136261u;
+			for (uint32_t word : bits)
+			{
+				hash ^= word;
+				hash *= 16777619u;
+			}
+			return hash ^ (hash >> 15);
+		}
+
+		static bool equalVertices(const VertexAttributes& a, const VertexAttributes& b)
+		{
+			return memcmp(&a.Position, &b.Position, sizeof(glm::vec4)) == 0 &&
+				memcmp(&a.TextureCoordinate, &b.TextureCoordinate, sizeof(glm::vec2)) == 0 &&
+				memcmp(&a.Normal, &b.Normal, sizeof(glm::vec3)) == 0 &&
+				memcmp(&a.Tangent, &b.Tangent, sizeof(glm::vec4)) == 0 &&
+				a.materialId == b.materialId && a.meshId == b.meshId;
+		}
+
+		uint32_t weldVertices(std::span<VertexAttributes> vertices, std::span<uint32_t> indices)
+		{
+			//open addressing table of unique vertex indices. Unique vertices are compacted to the front while iterating,
+			//the write position never passes the read position so this works in place
+			const uint32_t tableSize = std::bit_ceil(std::max<uint32_t>(uint32_t(vertices.size()) * 2, 16));
+			std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+			std::vector<uint32_t> remap(vertices.size());
+			uint32_t numUnique = 0;
+			for (uint32_t i = 0; i < vertices.size(); i++)
+			{
+				uint32_t slot = hashVertex(vertices[i]) & (tableSize - 1);
+				while (table[slot] != INVALID_INDEX && !equalVertices(vertices[table[slot]], vertices[i]))
+					slot = (slot + 1) & (tableSize - 1);
+
+				if (table[slot] == INVALID_INDEX)
+				{
+					vertices[numUnique] = vertices[i];
+					table[slot] = numUnique++;
+				}
+				remap[i] = table[slot];
+			}
+			for (uint32_t& index : indices)
+				index = remap[index];
+			return numUnique;
+		}
+
+		uint32_t removeDegenerateTriangles(std::span<uint32_t> indices)
+		{
+			uint32_t count = 0;
+			for (size_t i = 0; i + 3 <= indices.size(); i += 3)
+			{
+				uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				if (a == b || b == c || a == c)
+					continue;
+				indices[count++] = a;
+				indices[count++] = b;
+				indices[count++] = c;
+			}
+			return count;
+		}
+
+		void optimizeVertexCache(std::span<uint32_t> indices, uint32_t numVertices, uint32_t cacheSize)
+		{
+			//Tipsify (Sander, Nehab, Barczak 2007): fan around a vertex, continue with the adjacent vertex that is still
+			//in the cache and will not be evicted by its own remaining triangles, fall back to recently used vertices on dead ends
+			const uint32_t numTriangles = uint32_t(indices.size() / 3);
+			if (numTriangles == 0)
+				return;
+
+			//vertex -> triangle adjacency
+			std::vector<uint32_t> offsets(numVertices + 1, 0);
+			for (uint32_t index : indices)
+				offsets[index + 1]++;
+			for (uint32_t v = 0; v < numVertices; v++)
+				offsets[v + 1] += offsets[v];
+			std::vector<uint32_t> adjacency(indices.size());
+			std::vector<uint32_t> liveTriangles(numVertices, 0);
+			for (uint32_t t = 0; t < numTriangles; t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t v = indices[t * 3 + k];
+					adjacency[offsets[v] + liveTriangles[v]++] = t;
+				}
+			}
+
+			std::vector<uint32_t> cacheTime(numVertices, 0);
+			std::vector<uint8_t> emitted(numTriangles, 0);
+			std::vector<uint32_t> deadEnd;
+			std::vector<uint32_t> candidates;
+			std::vector<uint32_t> result;
+			deadEnd.reserve(indices.size());
+			result.reserve(indices.size());
+			uint32_t time = cacheSize + 1;
+			uint32_t cursor = 0;
+
+			auto skipDeadEnd = [&]() {
+				while (!deadEnd.empty())
+				{
+					uint32_t v = deadEnd.back();
+					deadEnd.pop_back();
+					if (liveTriangles[v] > 0)
+						return v;
+				}
+				for (; cursor < numVertices; cursor++)
+				{
+					if (liveTriangles[cursor] > 0)
+						return cursor;
+				}
+				return INVALID_INDEX;
+			};
+
+			uint32_t fanning = skipDeadEnd();
+			while (fanning != INVALID_INDEX)
+			{
+				candidates.clear();
+				for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++)
+				{
+					uint32_t t = adjacency[a];
+					if (emitted[t])
+						continue;
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t v = indices[t * 3 + k];
+						result.push_back(v);
+						deadEnd.push_back(v);
+						candidates.push_back(v);
+						liveTriangles[v]--;
+						if (time - cacheTime[v] > cacheSize)
+							cacheTime[v] = time++;
+					}
+					emitted[t] = 1;
+				}
+
+				uint32_t next = INVALID_INDEX;
+				int64_t bestPriority = -1;
+				for (uint32_t v : candidates)
+				{
+					if (liveTriangles[v] == 0)
+						continue;
+					int64_t priority = 0;
+					if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+						priority = time - cacheTime[v];
+					if (priority > bestPriority)
+					{
+						bestPriority = priority;
+						next = v;
+					}
+				}
+				fanning = next != INVALID_INDEX ? next : skipDeadEnd();
+			}
+
+			GAIA_ASSERT(result.size() == indices.size(), "Tipsify lost triangles");
+			std::copy(result.begin(), result.end(), indices.begin());
+		}
+
+		void optimizeOverdraw(std::span<uint32_t> indices, std::span<const VertexAttributes> vertices, uint32_t cacheSize, float threshold)
+		{
+			//view independent overdraw reduction (Sander et al. 2007): split the cache optimized order into clusters that keep
+			//the ACMR close to the whole mesh, then draw the clusters that face away from the mesh center first
+			const uint32_t numTriangles = uint32_t(indices.size() / 3);
+			if (numTriangles < 2)
+				return;
+			const uint32_t numVertices = uint32_t(vertices.size());
+
+			//hard boundaries, a triangle that misses with all three vertices starts from a cold cache anyway
+			std::vector<uint32_t> hardBoundaries;
+			{
+				FifoCache cache(numVertices, cacheSize);
+				uint32_t misses = 0;
+				for (uint32_t t = 0; t < numTriangles; t++)
+				{
+					uint32_t triangleMisses = cache.triangleMisses(indices.data() + t * 3);
+					misses += triangleMisses;
+					if (t == 0 || triangleMisses == 3)
+						hardBoundaries.push_back(t);
+				}
+				hardBoundaries.push_back(numTriangles);
+				threshold *= float(misses) / float(numTriangles);
+			}
+
+			//soft boundaries, cut a cluster as soon as its own ACMR is within the threshold of the mesh
+			std::vector<uint32_t> clusters;
+			{
+				FifoCache cache(numVertices, cacheSize);
+				for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+				{
+					uint32_t end = hardBoundaries[h + 1];
+					uint32_t clusterStart = hardBoundaries[h];
+					uint32_t misses = 0;
+					cache.flush();
+					clusters.push_back(clusterStart);
+					for (uint32_t t = clusterStart; t < end; t++)
+					{
+						misses += cache.triangleMisses(indices.data() + t * 3);
+						if (t + 1 < end && float(misses) <= threshold * float(t + 1 - clusterStart))
+						{
+							clusterStart = t + 1;
+							misses = 0;
+							cache.flush();
+							clusters.push_back(clusterStart);
+						}
+					}
+				}
+				clusters.push_back(numTriangles);
+			}
+			const uint32_t numClusters = uint32_t(clusters.size() - 1);
+			if (numClusters < 2)
+				return;
+
+			//area weighted centroid and normal of every cluster
+			std::vector<glm::vec3> clusterCentroids(numClusters, glm::vec3(0.0f));
+			std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0.0f));
+			glm::vec3 meshCentroid = glm::vec3(0.0f);
+			float meshArea = 0.0f;
+			for (uint32_t c = 0; c < numClusters; c++)
+			{
+				float clusterArea = 0.0f;
+				for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+				{
+					glm::vec3 p0 = glm::vec3(vertices[indices[t * 3 + 0]].Position);
+					glm::vec3 p1 = glm::vec3(vertices[indices[t * 3 + 1]].Position);
+					glm::vec3 p2 = glm::vec3(vertices[indices[t * 3 + 2]].Position);
+					glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+					float area = glm::length(normal);
+					clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+					clusterNormals[c] += normal;
+					clusterArea += area;
+				}
+				meshCentroid += clusterCentroids[c];
+				meshArea += clusterArea;
+				clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : glm::vec3(0.0f);
+			}
+			meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+			std::vector<float> sortKeys(numClusters);
+			std::vector<uint32_t> order(numClusters);
+			for (uint32_t c = 0; c < numClusters; c++)
+			{
+				float normalLength = glm::length(clusterNormals[c]);
+				glm::vec3 direction = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+				sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, direction);
+				order[c] = c;
+			}
+			//clusters far out along their normal are likely occluders, draw them first
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+			std::vector<uint32_t> result;
+			result.reserve(numTriangles * 3);
+			for (uint32_t c : order)
+				result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+			std::copy(result.begin(), result.end(), indices.begin());
+		}
+
+		uint32_t optimizeVertexFetch(std::span<VertexAttributes> vertices, std::span<uint32_t> indices)
+		{
+			std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+			std::vector<VertexAttributes> reordered;
+			reordered.reserve(vertices.size());
+			for (uint32_t& index : indices)
+			{
+				if (remap[index] == INVALID_INDEX)
+				{
+					remap[index] = uint32_t(reordered.size());
+					reordered.push_back(vertices[index]);
+				}
+				index = remap[index];
+			}
+			std::copy(reordered.begin(), reordered.end(), vertices.begin());
+			return uint32_t(reordered.size());
+		}
+
+		MeshOptimizationStats optimize(VertexAttributes* vertices, uint32_t& vertexCount, uint32_t* indices, uint32_t& indexCount)
+		{
+			MeshOptimizationStats stats{
+				.verticesBefore = vertexCount,
+				.trianglesBefore = indexCount / 3,
+			};
+			std::span<uint32_t> indexSpan(indices, indexCount);
+			bool valid = indexCount % 3 == 0 && std::all_of(indexSpan.begin(), indexSpan.end(), [&](uint32_t index) { return index < vertexCount; });
+			if (!valid)
+			{
+				GAIA_CORE_WARN("Not optimizing a sub mesh with {} indices, it is not a valid triangle list", indexCount);
+				stats.verticesAfter = vertexCount;
+				stats.trianglesAfter = indexCount / 3;
+				return stats;
+			}
+
+			CacheStats before = analyzeVertexCache(indexSpan, vertexCount);
+			stats.acmrBefore = before.acmr;
+			stats.atvrBefore = before.atvr;
+
+			vertexCount = weldVertices({ vertices, vertexCount }, indexSpan);
+			indexCount = removeDegenerateTriangles(indexSpan);
+			indexSpan = indexSpan.first(indexCount);
+			optimizeVertexCache(indexSpan, vertexCount);
+			optimizeOverdraw(indexSpan, { vertices, vertexCount });
+			vertexCount = optimizeVertexFetch({ vertices, vertexCount }, indexSpan);
+
+			CacheStats after = analyzeVertexCache(indexSpan, vertexCount);
+			stats.verticesAfter = vertexCount;
+			stats.trianglesAfter = indexCount / 3;
+			stats.acmrAfter = after.acmr;
+			stats.atvrAfter = after.atvr;
+			return stats;
+		}
+	}
+}
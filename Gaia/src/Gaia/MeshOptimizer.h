@@ -0,0 +1,39 @@
+#pragma once
+#include "Gaia/LoadMesh.h"
+#include <span>
+
+namespace Gaia
+{
+	//Import time reordering of the sub mesh geometry for the GPU:
+	//exact duplicate vertices are welded, triangles are reordered for the post transform cache (Tipsify) and then cluster wise
+	//for less overdraw, finally the vertices are renumbered in first use order so the vertex fetch walks memory linearly.
+	//Every function works in place on one sub mesh, the indices are relative to its first vertex.
+	namespace MeshOptimizer
+	{
+		//FIFO size used by the cache optimization and the statistics
+		constexpr uint32_t CACHE_SIZE = 16;
+		//an overdraw cluster may have an ACMR this much worse than the whole mesh
+		constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+		struct CacheStats
+		{
+			float acmr = 0.0f; //cache misses per triangle
+			float atvr = 0.0f; //cache misses per referenced vertex
+		};
+		CacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t numVertices, uint32_t cacheSize = CACHE_SIZE);
+
+		//removes bitwise identical vertices and rewrites the indices, returns the new vertex count
+		uint32_t weldVertices(std::span<VertexAttributes> vertices, std::span<uint32_t> indices);
+		//drops triangles that reference a vertex twice, returns the new index count
+		uint32_t removeDegenerateTriangles(std::span<uint32_t> indices);
+		void optimizeVertexCache(std::span<uint32_t> indices, uint32_t numVertices, uint32_t cacheSize = CACHE_SIZE);
+		//sorts the cache friendly clusters front to back from outside the mesh, expects the output of optimizeVertexCache
+		void optimizeOverdraw(std::span<uint32_t> indices, std::span<const VertexAttributes> vertices, uint32_t cacheSize = CACHE_SIZE,
+			float threshold = OVERDRAW_THRESHOLD);
+		//renumbers the vertices in first use order and drops unreferenced ones, returns the new vertex count
+		uint32_t optimizeVertexFetch(std::span<VertexAttributes> vertices, std::span<uint32_t> indices);
+
+		//runs every step above, vertexCount and indexCount are updated to the optimized counts
+		MeshOptimizationStats optimize(VertexAttributes* vertices, uint32_t& vertexCount, uint32_t* indices, uint32_t& indexCount);
+	}
+}
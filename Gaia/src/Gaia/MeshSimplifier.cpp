@@ -0,0 +1,255 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include <bit>
+
+namespace Gaia
+{
+	namespace MeshSimplifier
+	{
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+		static constexpr uint32_t MAX_PASSES = 64;
+
+		//area weighted sum of squared distances to the planes of the adjacent triangles
+		struct Quadric
+		{
+			double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+
+			void addPlane(const glm::dvec3& n, double d, double w)
+			{
+				a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+				a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+				b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+				c += w * d * d;
+				weight += w;
+			}
+			void add(const Quadric& q)
+			{
+				a00 += q.a00; a11 += q.a11; a22 += q.a22;
+				a01 += q.a01; a02 += q.a02; a12 += q.a12;
+				b0 += q.b0; b1 += q.b1; b2 += q.b2;
+				c += q.c;
+				weight += q.weight;
+			}
+			//mean squared distance of p to the planes
+			double evaluate(const glm::dvec3& p) const
+			{
+				double rx = a00 * p.x + a01 * p.y + a02 * p.z + b0;
+				double ry = a01 * p.x + a11 * p.y + a12 * p.z + b1;
+				double rz = a02 * p.x + a12 * p.y + a22 * p.z + b2;
+				double error = p.x * rx + p.y * ry + p.z * rz + b0 * p.x + b1 * p.y + b2 * p.z + c;
+				return weight > 0.0 ? std::max(error, 0.0) / weight : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+
+		static uint32_t hashPosition(const glm::vec3& p)
+		{
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+
+		//maps every vertex to the first vertex with the same position, vertices split by uvs or normals share a wedge
+		static void buildWedges(std::span<const glm::vec3> positions, std::vector<uint32_t>& wedges)
+		{
+			const uint32_t tableSize = std::bit_ceil(std::max<uint32_t>(uint32_t(positions.size()) * 2, 16));
+			std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+			wedges.resize(positions.size());
+			for (uint32_t v = 0; v < positions.size(); v++)
+			{
+				uint32_t slot = hashPosition(positions[v]) & (tableSize - 1);
+				while (table[slot] != INVALID_INDEX && positions[table[slot]] != positions[v])
+					slot = (slot + 1) & (tableSize - 1);
+				if (table[slot] == INVALID_INDEX)
+					table[slot] = v;
+				wedges[v] = table[slot];
+			}
+		}
+
+		static inline uint64_t edgeKey(uint32_t a, uint32_t b)
+		{
+			return (uint64_t(a) << 32) | b;
+		}
+
+		//vertices that have to stay in place: seams (more than one vertex per position) and open or non manifold borders
+		static void findLockedVertices(std::span<const uint32_t> indices, std::span<const uint32_t> wedges, std::vector<uint8_t>& locked)
+		{
+			locked.assign(wedges.size(), 0);
+			std::vector<uint32_t> wedgeSize(wedges.size(), 0);
+			for (uint32_t v = 0; v < wedges.size(); v++)
+				wedgeSize[wedges[v]]++;
+
+			std::unordered_map<uint64_t, uint32_t> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = wedges[indices[i + k]];
+					uint32_t b = wedges[indices[i + (k + 1) % 3]];
+					edges[edgeKey(a, b)]++;
+				}
+			}
+			std::vector<uint8_t> lockedWedge(wedges.size(), 0);
+			for (const auto& [key, count] : edges)
+			{
+				uint32_t a = uint32_t(key >> 32);
+				uint32_t b = uint32_t(key & 0xFFFFFFFF);
+				auto opposite = edges.find(edgeKey(b, a));
+				if (count != 1 || opposite == edges.end() || opposite->second != 1)
+				{
+					lockedWedge[a] = 1;
+					lockedWedge[b] = 1;
+				}
+			}
+			for (uint32_t v = 0; v < wedges.size(); v++)
+				locked[v] = lockedWedge[wedges[v]] || wedgeSize[wedges[v]] > 1;
+		}
+
+		//true if moving vertex 'from' onto 'to' would flip or collapse one of the triangles that survive the collapse
+		static bool flipsTriangle(uint32_t from, uint32_t to, std::span<const uint32_t> indices, std::span<const uint32_t> adjacency,
+			std::span<const uint32_t> offsets, std::span<const glm::vec3> positions)
+		{
+			for (uint32_t a = offsets[from]; a < offsets[from + 1]; a++)
+			{
+				const uint32_t* triangle = &indices[adjacency[a] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+					continue; //removed by the collapse
+
+				int corner = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+				glm::vec3 p1 = positions[triangle[(corner + 1) % 3]];
+				glm::vec3 p2 = positions[triangle[(corner + 2) % 3]];
+				glm::vec3 before = glm::cross(p1 - positions[from], p2 - positions[from]);
+				glm::vec3 after = glm::cross(p1 - positions[to], p2 - positions[to]);
+				if (glm::dot(before, after) <= 0.0f)
+					return true;
+			}
+			return false;
+		}
+
+		uint32_t simplify(uint32_t* destination, std::span<const uint32_t> indices, std::span<const VertexAttributes> vertices,
+			uint32_t targetIndexCount, float maxError, float* resultError)
+		{
+			const uint32_t numVertices = uint32_t(vertices.size());
+			std::vector<uint32_t> result(indices.begin(), indices.end());
+			double largestError = 0.0;
+
+			std::vector<glm::vec3> positions(numVertices);
+			for (uint32_t v = 0; v < numVertices; v++)
+				positions[v] = glm::vec3(vertices[v].Position);
+
+			std::vector<uint32_t> wedges;
+			std::vector<uint8_t> locked;
+			buildWedges(positions, wedges);
+			findLockedVertices(result, wedges, locked);
+
+			std::vector<Quadric> quadrics(numVertices);
+			for (size_t i = 0; i + 3 <= result.size(); i += 3)
+			{
+				glm::dvec3 p0 = positions[result[i]], p1 = positions[result[i + 1]], p2 = positions[result[i + 2]];
+				glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				double length = glm::length(normal);
+				if (length <= 0.0)
+					continue;
+				normal /= length;
+				for (int k = 0; k < 3; k++)
+					quadrics[wedges[result[i + k]]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+			}
+
+			const double maxCost = double(maxError) * double(maxError);
+			std::vector<uint32_t> offsets(numVertices + 1);
+			std::vector<uint32_t> adjacency;
+			std::vector<Collapse> collapses;
+			std::vector<uint32_t> remap(numVertices);
+			std::vector<uint8_t> touched(numVertices);
+			for (uint32_t pass = 0; pass < MAX_PASSES && result.size() > targetIndexCount; pass++)
+			{
+				const uint32_t numTriangles = uint32_t(result.size() / 3);
+
+				//vertex -> triangle adjacency of the current triangles
+				std::fill(offsets.begin(), offsets.end(), 0);
+				for (uint32_t index : result)
+					offsets[index + 1]++;
+				for (uint32_t v = 0; v < numVertices; v++)
+					offsets[v + 1] += offsets[v];
+				adjacency.resize(result.size());
+				std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+				for (uint32_t t = 0; t < numTriangles; t++)
+				{
+					for (int k = 0; k < 3; k++)
+						adjacency[fill[result[t * 3 + k]]++] = t;
+				}
+
+				collapses.clear();
+				for (uint32_t t = 0; t < numTriangles; t++)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t a = result[t * 3 + k];
+						uint32_t b = result[t * 3 + (k + 1) % 3];
+						if (!locked[a])
+							collapses.push_back({ a, b, quadrics[wedges[a]].evaluate(positions[b]) });
+						if (!locked[b])
+							collapses.push_back({ b, a, quadrics[wedges[b]].evaluate(positions[a]) });
+					}
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+				//every collapse removes about two triangles, collapses in one pass must not share a triangle fan
+				const size_t collapsesNeeded = (result.size() - targetIndexCount) / 6 + 1;
+				size_t numCollapsed = 0;
+				for (uint32_t v = 0; v < numVertices; v++)
+					remap[v] = v;
+				std::fill(touched.begin(), touched.end(), 0);
+				for (const Collapse& collapse : collapses)
+				{
+					if (numCollapsed >= collapsesNeeded || collapse.cost > maxCost)
+						break;
+					if (touched[collapse.from] || touched[collapse.to])
+						continue;
+					if (flipsTriangle(collapse.from, collapse.to, result, adjacency, offsets, positions))
+						continue;
+
+					for (uint32_t a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+					{
+						const uint32_t* triangle = &result[adjacency[a] * 3];
+						touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+					}
+					touched[collapse.to] = 1;
+					remap[collapse.from] = collapse.to;
+					quadrics[wedges[collapse.to]].add(quadrics[wedges[collapse.from]]);
+					largestError = std::max(largestError, collapse.cost);
+					numCollapsed++;
+				}
+				if (numCollapsed == 0)
+					break;
+
+				size_t count = 0;
+				for (size_t i = 0; i + 3 <= result.size(); i += 3)
+				{
+					uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+					if (a == b || b == c || a == c)
+						continue;
+					result[count++] = a;
+					result[count++] = b;
+					result[count++] = c;
+				}
+				result.resize(count);
+			}
+
+			std::copy(result.begin(), result.end(), destination);
+			if (resultError)
+				*resultError = float(std::sqrt(largestError));
+			return uint32_t(result.size());
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "Gaia/LoadMesh.h"
+#include <span>
+
+namespace Gaia
+{
+	//Edge collapse simplification driven by quadric error metrics (Garland & Heckbert 1997).
+	//Only the index buffer is rewritten, the simplified triangles keep referencing the original vertices so every level of detail
+	//shares the vertex range of its sub mesh. Vertices on UV/normal seams and open borders are never removed.
+	namespace MeshSimplifier
+	{
+		//writes at most indices.size() indices to destination and returns the simplified index count. Stops at targetIndexCount
+		//or when the next collapse would move the surface further than maxError (object space). resultError receives the
+		//largest error of the performed collapses
+		uint32_t simplify(uint32_t* destination, std::span<const uint32_t> indices, std::span<const VertexAttributes> vertices,
+			uint32_t targetIndexCount, float maxError, float* resultError = nullptr);
+	}
+}
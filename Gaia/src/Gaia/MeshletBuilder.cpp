@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "MeshletBuilder.h"
+
+namespace Gaia
+{
+	namespace MeshletBuilder
+	{
+		static constexpr uint8_t NOT_IN_MESHLET = 0xFF;
+		//cones wider than this (dot of the axis and the widest normal) can never be culled and are disabled
+		static constexpr float MIN_CONE_DOT = 0.1f;
+
+		void computeBounds(Meshlet& meshlet, std::span<const uint32_t> meshletVertices, std::span<const uint8_t> meshletTriangles,
+			std::span<const VertexAttributes> vertices, uint32_t baseVertex)
+		{
+			auto position = [&](uint32_t localIndex) {
+				return glm::vec3(vertices[meshletVertices[meshlet.vertexOffset + localIndex] - baseVertex].Position);
+			};
+			if (meshlet.vertexCount == 0)
+				return;
+
+			//Ritter's bounding sphere: start from two distant points and grow the sphere over the outliers
+			glm::vec3 first = position(0);
+			uint32_t farthest = 0;
+			for (uint32_t v = 1; v < meshlet.vertexCount; v++)
+			{
+				if (glm::dot(position(v) - first, position(v) - first) > glm::dot(position(farthest) - first, position(farthest) - first))
+					farthest = v;
+			}
+			glm::vec3 a = position(farthest);
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+			{
+				if (glm::dot(position(v) - a, position(v) - a) > glm::dot(position(farthest) - a, position(farthest) - a))
+					farthest = v;
+			}
+			glm::vec3 b = position(farthest);
+			glm::vec3 center = 0.5f * (a + b);
+			float radius = 0.5f * glm::length(b - a);
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+			{
+				float distance = glm::length(position(v) - center);
+				if (distance > radius)
+				{
+					float newRadius = 0.5f * (radius + distance);
+					center += (distance - newRadius) / distance * (position(v) - center);
+					radius = newRadius;
+				}
+			}
+			meshlet.center = center;
+			meshlet.radius = radius;
+
+			//normal cone
+			const uint8_t* triangles = meshletTriangles.data() + meshlet.triangleOffset;
+			glm::vec3 axis = glm::vec3(0.0f);
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				glm::vec3 p0 = position(triangles[t * 3]), p1 = position(triangles[t * 3 + 1]), p2 = position(triangles[t * 3 + 2]);
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float length = glm::length(normal);
+				if (length > 0.0f)
+					axis += normal / length;
+			}
+			meshlet.coneAxis = glm::vec3(0.0f);
+			meshlet.coneApex = center;
+			meshlet.coneCutoff = 1.0f;
+			float axisLength = glm::length(axis);
+			if (axisLength <= 0.0f)
+				return;
+			axis /= axisLength;
+
+			float minDot = 1.0f;
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				glm::vec3 p0 = position(triangles[t * 3]), p1 = position(triangles[t * 3 + 1]), p2 = position(triangles[t * 3 + 2]);
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float length = glm::length(normal);
+				if (length > 0.0f)
+					minDot = std::min(minDot, glm::dot(normal / length, axis));
+			}
+			if (minDot <= MIN_CONE_DOT)
+				return;
+
+			//move the apex back along the axis until it lies behind every triangle plane
+			float maxT = 0.0f;
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				glm::vec3 p0 = position(triangles[t * 3]), p1 = position(triangles[t * 3 + 1]), p2 = position(triangles[t * 3 + 2]);
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float length = glm::length(normal);
+				if (length <= 0.0f)
+					continue;
+				normal /= length;
+				maxT = std::max(maxT, glm::dot(center - p0, normal) / glm::dot(axis, normal));
+			}
+			meshlet.coneAxis = axis;
+			meshlet.coneApex = center - axis * maxT;
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+
+		void build(std::span<const uint32_t> indices, std::span<const VertexAttributes> vertices, uint32_t baseVertex,
+			std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+		{
+			//local index of every sub mesh vertex in the meshlet that is being filled
+			std::vector<uint8_t> localIndex(vertices.size(), NOT_IN_MESHLET);
+			const size_t firstMeshlet = meshlets.size();
+			Meshlet meshlet{
+				.vertexOffset = static_cast<uint32_t>(meshletVertices.size()),
+				.triangleOffset = static_cast<uint32_t>(meshletTriangles.size()),
+			};
+
+			auto finishMeshlet = [&]() {
+				for (uint32_t v = meshlet.vertexOffset; v < meshlet.vertexOffset + meshlet.vertexCount; v++)
+					localIndex[meshletVertices[v] - baseVertex] = NOT_IN_MESHLET;
+				meshlets.push_back(meshlet);
+				//keep every meshlet's triangles 4 byte aligned so the GPU can read them as uints
+				meshletTriangles.resize((meshletTriangles.size() + 3) & ~size_t(3), 0);
+				meshlet = Meshlet{
+					.vertexOffset = static_cast<uint32_t>(meshletVertices.size()),
+					.triangleOffset = static_cast<uint32_t>(meshletTriangles.size()),
+				};
+			};
+
+			for (size_t i = 0; i + 3 <= indices.size(); i += 3)
+			{
+				uint32_t newVertices = 0;
+				for (int k = 0; k < 3; k++)
+					newVertices += localIndex[indices[i + k]] == NOT_IN_MESHLET;
+				//a triangle that repeats a vertex is counted twice above, harmless since it only finishes the meshlet a bit early
+				if (meshlet.vertexCount + newVertices > MAX_VERTICES || meshlet.triangleCount + 1 > MAX_TRIANGLES)
+					finishMeshlet();
+
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t vertex = indices[i + k];
+					if (localIndex[vertex] == NOT_IN_MESHLET)
+					{
+						localIndex[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+						meshletVertices.push_back(vertex + baseVertex);
+					}
+					meshletTriangles.push_back(localIndex[vertex]);
+				}
+				meshlet.triangleCount++;
+			}
+			if (meshlet.triangleCount > 0)
+				finishMeshlet();
+
+			for (size_t m = firstMeshlet; m < meshlets.size(); m++)
+				computeBounds(meshlets[m], meshletVertices, meshletTriangles, vertices, baseVertex);
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Gaia/LoadMesh.h"
+#include <span>
+
+namespace Gaia
+{
+	//Splits a triangle list into meshlets in the order of the triangles, so a cache optimized index buffer (see MeshOptimizer.h)
+	//gives spatially coherent clusters. Every meshlet gets a bounding sphere and a normal cone for cluster level culling.
+	namespace MeshletBuilder
+	{
+		constexpr uint32_t MAX_VERTICES = 64;
+		constexpr uint32_t MAX_TRIANGLES = 124;
+
+		//appends the meshlets of one sub mesh, indices are relative to vertices and baseVertex is added to the stored vertex indices.
+		//Meshlet offsets are relative to the passed vectors
+		void build(std::span<const uint32_t> indices, std::span<const VertexAttributes> vertices, uint32_t baseVertex,
+			std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles);
+
+		//fills the bounding sphere and the normal cone from the meshlet's triangles, baseVertex is subtracted from the stored vertex indices
+		void computeBounds(Meshlet& meshlet, std::span<const uint32_t> meshletVertices, std::span<const uint8_t> meshletTriangles,
+			std::span<const VertexAttributes> vertices, uint32_t baseVertex = 0);
+	}
+}
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "FrustumCulling.h"
+#include "Gaia/LoadMesh.h"
+#include "Gaia/CpuFeatures.h"
+#include <immintrin.h>
+
+namespace Gaia
+{
+	namespace FrustumCulling
+	{
+		namespace
+		{
+			constexpr size_t LANES = 8;
+			//boxes per task of the parallel loops, small blocks cost more to schedule than to test
+			constexpr size_t CHUNK_SIZE = 1024;
+
+			//lanes past count are padding
+			inline void writeVisibility(const SubMeshBounds& bounds, size_t first, int outsideMask, uint8_t* visible)
+			{
+				const size_t numLanes = std::min(LANES, bounds.count - first);
+				for (size_t lane = 0; lane < numLanes; lane++)
+					visible[first + lane] = ((outsideMask >> lane) & 1) == 0;
+			}
+
+			//writes the visibility of the boxes from first to last, 8 at a time
+			GAIA_TARGET_AVX2 void cullRangeAvx2(const SubMeshBounds& bounds, const Frustum& frustum, size_t first, size_t last, uint8_t* visible)
+			{
+				for (; first < last; first += LANES)
+				{
+					const __m256 cx = _mm256_loadu_ps(&bounds.centerX[first]);
+					const __m256 cy = _mm256_loadu_ps(&bounds.centerY[first]);
+					const __m256 cz = _mm256_loadu_ps(&bounds.centerZ[first]);
+					const __m256 ex = _mm256_loadu_ps(&bounds.extentX[first]);
+					const __m256 ey = _mm256_loadu_ps(&bounds.extentY[first]);
+					const __m256 ez = _mm256_loadu_ps(&bounds.extentZ[first]);
+					const __m256 zero = _mm256_setzero_ps();
+					__m256 outside = zero;
+					for (const glm::vec4& plane : frustum.planes)
+					{
+						//distance of the box corner furthest along the plane normal
+						__m256 distance = _mm256_set1_ps(plane.w);
+						distance = _mm256_add_ps(distance, _mm256_mul_ps(cx, _mm256_set1_ps(plane.x)));
+						distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, _mm256_set1_ps(plane.y)));
+						distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+						distance = _mm256_add_ps(distance, _mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))));
+						distance = _mm256_add_ps(distance, _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y))));
+						distance = _mm256_add_ps(distance, _mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z))));
+						outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+					}
+					writeVisibility(bounds, first, _mm256_movemask_ps(outside), visible);
+				}
+			}
+
+			//the same test as two 4 wide halves for cpus without AVX2
+			void cullRangeSse(const SubMeshBounds& bounds, const Frustum& frustum, size_t first, size_t last, uint8_t* visible)
+			{
+				for (; first < last; first += LANES)
+				{
+					int outsideMask = 0;
+					for (size_t half = 0; half < LANES; half += 4)
+					{
+						const __m128 cx = _mm_loadu_ps(&bounds.centerX[first + half]);
+						const __m128 cy = _mm_loadu_ps(&bounds.centerY[first + half]);
+						const __m128 cz = _mm_loadu_ps(&bounds.centerZ[first + half]);
+						const __m128 ex = _mm_loadu_ps(&bounds.extentX[first + half]);
+						const __m128 ey = _mm_loadu_ps(&bounds.extentY[first + half]);
+						const __m128 ez = _mm_loadu_ps(&bounds.extentZ[first + half]);
+						__m128 outside = _mm_setzero_ps();
+						for (const glm::vec4& plane : frustum.planes)
+						{
+							__m128 distance = _mm_set1_ps(plane.w);
+							distance = _mm_add_ps(distance, _mm_mul_ps(cx, _mm_set1_ps(plane.x)));
+							distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+							distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+							distance = _mm_add_ps(distance, _mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))));
+							distance = _mm_add_ps(distance, _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y))));
+							distance = _mm_add_ps(distance, _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+							outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+						}
+						outsideMask |= _mm_movemask_ps(outside) << half;
+					}
+					writeVisibility(bounds, first, outsideMask, visible);
+				}
+			}
+		}
+
+		Frustum extractFrustum(const glm::mat4& viewProjection)
+		{
+			//Gribb and Hartmann, the planes are sums of the rows of the matrix
+			const glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+			const glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+			const glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+			const glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+			return Frustum{ .planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 } };
+		}
+
+		void updateBounds(std::span<const SubMesh> subMeshes, std::span<const glm::mat4> transforms, SubMeshBounds& bounds)
+		{
+			const size_t paddedCount = (subMeshes.size() + LANES - 1) / LANES * LANES;
+			for (std::vector<float>* component : { &bounds.centerX, &bounds.centerY, &bounds.centerZ, &bounds.extentX, &bounds.extentY, &bounds.extentZ })
+				component->assign(paddedCount, 0.0f);
+			bounds.count = subMeshes.size();
+
+			//Arvo's method, the half extent goes through the absolute 3x3 part of the transform
+			auto iter = std::views::iota(size_t(0), subMeshes.size());
+			std::for_each(std::execution::par, iter.begin(), iter.end(), [&](size_t subMeshIndex) {
+				const SubMesh& subMesh = subMeshes[subMeshIndex];
+				glm::vec3 center = glm::vec3(0.0f);
+				//empty sub meshes get a negative extent that no frustum contains
+				glm::vec3 extent = glm::vec3(std::numeric_limits<float>::lowest());
+				if (glm::all(glm::lessThanEqual(subMesh.boundsMin, subMesh.boundsMax)))
+				{
+					const glm::mat4& transform = transforms[subMesh.meshIndex];
+					const glm::vec3 localExtent = 0.5f * (subMesh.boundsMax - subMesh.boundsMin);
+					center = glm::vec3(transform * glm::vec4(0.5f * (subMesh.boundsMin + subMesh.boundsMax), 1.0f));
+					extent = glm::abs(glm::vec3(transform[0])) * localExtent.x
+						+ glm::abs(glm::vec3(transform[1])) * localExtent.y
+						+ glm::abs(glm::vec3(transform[2])) * localExtent.z;
+				}
+				bounds.centerX[subMeshIndex] = center.x;
+				bounds.centerY[subMeshIndex] = center.y;
+				bounds.centerZ[subMeshIndex] = center.z;
+				bounds.extentX[subMeshIndex] = extent.x;
+				bounds.extentY[subMeshIndex] = extent.y;
+				bounds.extentZ[subMeshIndex] = extent.z;
+			});
+		}
+
+		void cull(const SubMeshBounds& bounds, const Frustum& frustum, std::vector<uint8_t>& visible)
+		{
+			visible.resize(bounds.count);
+			const auto cullRange = CpuFeatures::hasAvx2() ? cullRangeAvx2 : cullRangeSse;
+			auto iter = std::views::iota(size_t(0), (bounds.count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+			std::for_each(std::execution::par, iter.begin(), iter.end(), [&](size_t chunk) {
+				cullRange(bounds, frustum, chunk * CHUNK_SIZE, std::min(bounds.count, (chunk + 1) * CHUNK_SIZE), visible.data());
+			});
+		}
+	}
+}
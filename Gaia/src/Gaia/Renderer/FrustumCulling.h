@@ -0,0 +1,37 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <span>
+#include <vector>
+
+namespace Gaia
+{
+	struct SubMesh;
+
+	//planes point inwards, a point p is inside if dot(plane.xyz, p) + plane.w >= 0 for all of them
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+	};
+
+	//world space boxes of the sub meshes as center and half extent, one array per component so 8 boxes are tested at once.
+	//The arrays are padded to a multiple of 8
+	struct SubMeshBounds
+	{
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+		size_t count = 0;
+	};
+
+	//culls the sub meshes against the camera or a shadow cascade before the levels of detail are selected (see LodSelection.h)
+	namespace FrustumCulling
+	{
+		//planes of a view projection matrix, the near plane is the one of a -1..1 depth range which also holds the 0..1 one
+		Frustum extractFrustum(const glm::mat4& viewProjection);
+
+		//transforms the object space boxes of the sub meshes (see SubMesh::boundsMin) with the global transforms
+		void updateBounds(std::span<const SubMesh> subMeshes, std::span<const glm::mat4> transforms, SubMeshBounds& bounds);
+
+		//visible[i] is 1 if box i intersects the frustum, in parallel over blocks of 8 boxes
+		void cull(const SubMeshBounds& bounds, const Frustum& frustum, std::vector<uint8_t>& visible);
+	}
+}
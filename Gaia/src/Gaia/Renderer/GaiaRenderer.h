@@ -1,5 +1,6 @@
 #pragma once
 #include <utility>
+#include <future>
 #include "Gaia/Core.h"
 #include "Gaia/Log.h"
 #include "memory"
@@ -14,6 +15,7 @@ namespace Gaia
 	enum { MAX_COLOR_ATTACHMENTS = 8 };
 	enum { MAX_VERTEX_BUFFERS = 16u };
 	enum {MAX_DESCRIPTOR_SETS = 100u};
+	enum { MAX_FRAMES_IN_FLIGHT = 2u }; //frames the cpu records while the gpu still renders older ones
 	template<typename ObjectType>
 	class Handle final
 	{
@@ -62,6 +64,21 @@ namespace Gaia
 	using RayTracingPipelineHandle = Handle<struct RayTracingPipeline>;
 	using ComputePipelineHandle = Handle<struct ComputePipeline>;
 
+	//identifies a submitted command buffer, see IContext::getLastSubmitHandle
+	struct SubmitHandle final
+	{
+		uint32_t bufferIndex_ = 0;
+		uint32_t submitId_ = 0;
+		SubmitHandle() = default;
+		explicit SubmitHandle(uint64_t handle) : bufferIndex_(uint32_t(handle & 0xffffffff)), submitId_(uint32_t(handle >> 32)) {}
+		bool empty() const {
+			return submitId_ == 0;
+		}
+		uint64_t handle() const {
+			return ((uint64_t)submitId_ << 32) + bufferIndex_;
+		}
+	};
+
 	//forward declare IContext
 	class IContext;
 	// forward declarations to access incomplete type IContext
@@ -112,6 +129,16 @@ namespace Gaia
 		IContext* context_ = nullptr;
 	};
 
+	//stages ordered by ICommandBuffer::cmdBufferBarrier
+	enum PipelineStageBits : uint8_t
+	{
+		PipelineStageBits_None = 0,
+		PipelineStageBits_Transfer = 1 << 0,
+		PipelineStageBits_ComputeShader = 1 << 1,
+		PipelineStageBits_DrawIndirect = 1 << 2,
+		PipelineStageBits_AllGraphics = 1 << 3,
+	};
+
 	enum BufferusageBits : uint8_t
 	{
 		BufferUsageBits_None = 0,
@@ -131,6 +158,7 @@ namespace Gaia
 		TextureType_2D,
 		TextureType_3D,
 		TextureType_Cube,
+		TextureType_2DArray, //always viewed as an array, also with a single layer
 	};
 
 	struct Dimensions
@@ -251,6 +279,13 @@ namespace Gaia
 		Format_ETC2_RGB8,
 		Format_ETC2_SRGB8,
 		Format_BC7_SRGB,
+		Format_BC7_UN,
+		Format_BC1_RGB_UN,
+		Format_BC1_RGB_SRGB,
+		Format_BC3_UN,
+		Format_BC3_SRGB,
+		Format_BC4_UN,
+		Format_BC5_UN,
 	};
 
 	enum ColorSpace
@@ -468,6 +503,49 @@ namespace Gaia
 		PipelineBindpoint_RayTracing = 3,
 	};
 
+	//byte range of a buffer, see IContext::upload
+	struct BufferRange final
+	{
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+	//same layout as VkDrawIndexedIndirectCommand, see ICommandBuffer::cmdDrawIndexedIndirect
+	struct DrawIndexedIndirectCommand final
+	{
+		uint32_t indexCount = 0;
+		uint32_t instanceCount = 1;
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t firstInstance = 0;
+	};
+
+	struct SpecializationConstantEntry final
+	{
+		uint32_t constantId = 0;
+		uint32_t offset = 0; //byte offset in SpecializationConstantDesc::data
+		size_t size = 0;
+	};
+
+	//values of the constants a shader declares with layout(constant_id = ...), every stage of the pipeline gets the same values
+	struct SpecializationConstantDesc final
+	{
+		static constexpr uint32_t MAX_SPECIALIZATION_CONSTANTS = 16;
+		SpecializationConstantEntry entries[MAX_SPECIALIZATION_CONSTANTS] = {};
+		const void* data = nullptr; //copied when the pipeline is created
+		size_t dataSize = 0;
+
+		uint32_t getNumSpecializationConstants() const
+		{
+			uint32_t n = 0;
+			while (n < MAX_SPECIALIZATION_CONSTANTS && entries[n].size != 0)
+			{
+				n++;
+			}
+			return n;
+		}
+	};
+
 	struct RenderPipelineDesc final
 	{
 		Topology topology = Topology_Triangle;
@@ -487,6 +565,8 @@ namespace Gaia
 		const char* entryPointMesh = "main";
 		const char* entryPointFrag = "main";
 
+		SpecializationConstantDesc specInfo = {};
+
 		ColorAttachment colorAttachments[MAX_COLOR_ATTACHMENTS] = {};
 		Format depthFormat = Format_Invalid;
 		Format stencilFormat = Format_Invalid;
@@ -779,7 +859,14 @@ namespace Gaia
 		virtual void cmdEndRendering() = 0;
 
 		virtual void cmdCopyBufferToBuffer(BufferHandle srcBufferHandle, BufferHandle dstBufferHandle, uint32_t offset = 0) = 0;
+		//fills a range of a device buffer with a repeated uint, compute shaders recorded after it see the values
+		virtual void cmdFillBuffer(BufferHandle buffer, size_t offset, size_t size, uint32_t value) = 0;
+		//the srcStages (PipelineStageBits) of the commands recorded or submitted before it are done with the buffer before the
+		//dstStages of the commands recorded after it touch it, and their writes are visible to them
+		virtual void cmdBufferBarrier(BufferHandle buffer, uint8_t srcStages, uint8_t dstStages) = 0;
 		virtual void cmdCopyBufferToImage(BufferHandle buffer, TextureHandle texture) = 0;
+		//copies every mip level of the texture, levelOffsets[i] is where level i starts in the buffer
+		virtual void cmdCopyBufferToImage(BufferHandle buffer, TextureHandle texture, const std::vector<uint64_t>& levelOffsets) = 0;
 		virtual void cmdCopyImageToImage(TextureHandle srcImageHandle, TextureHandle dstImageHandle) = 0;
 
 		virtual void cmdSetViewport(Viewport viewport) = 0;
@@ -797,6 +884,11 @@ namespace Gaia
 
 		virtual void cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) = 0;
 		virtual void cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,uint32_t vertexOffset, uint32_t firstInstance) = 0;
+		//draws drawCount DrawIndexedIndirectCommands read from the buffer, it needs BufferUsageBits_Indirect
+		virtual void cmdDrawIndexedIndirect(BufferHandle indirectBuffer, size_t bufferOffset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) = 0;
+		//like cmdDrawIndexedIndirect, the number of draws is the uint at countBufferOffset clamped to maxDrawCount
+		virtual void cmdDrawIndexedIndirectCount(BufferHandle indirectBuffer, size_t bufferOffset, BufferHandle countBuffer, size_t countBufferOffset,
+			uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) = 0;
 
 		virtual void cmdBindComputePipeline(ComputePipelineHandle handle) = 0;
 		virtual void cmdDispatch(uint32_t workGroupSizeX, uint32_t workGroupSizeY, uint32_t workGroupSizeZ) = 0;
@@ -813,8 +905,28 @@ namespace Gaia
 		virtual ~IContext() = default;
 
 		virtual ICommandBuffer& acquireCommandBuffer() = 0;
-		virtual void submit(ICommandBuffer& cmd, TextureHandle presentTexture) = 0;
-		virtual void submit(ICommandBuffer& cmd) = 0;
+		//submits do not wait for the gpu, they run in submission order. The present submit waits for the frame that used
+		//the next frame in flight slot, so the cpu records at most MAX_FRAMES_IN_FLIGHT frames ahead of the gpu
+		virtual SubmitHandle submit(ICommandBuffer& cmd, TextureHandle presentTexture) = 0;
+		virtual SubmitHandle submit(ICommandBuffer& cmd) = 0;
+
+		//copies the data into a persistent staging ring right away, the copy commands are batched and submitted ahead of
+		//the next submit() or by flushUploads(). The host only waits when the ring wraps onto copies the gpu has not done yet.
+		//Textures end up in ImageLayout_READ_ONLY_OPTIMAL
+		virtual void upload(BufferHandle handle, const void* data, size_t size, size_t offset = 0) = 0;
+		//data mirrors the whole buffer, only the ranges are staged and they are copied with a single copy command
+		virtual void upload(BufferHandle handle, const void* data, const std::vector<BufferRange>& ranges) = 0;
+		//levelOffsets[i] is where mip level i starts in data, the levels are copied into one array layer
+		virtual void upload(TextureHandle handle, const void* data, size_t size, const std::vector<uint64_t>& levelOffsets, uint32_t layer = 0) = 0;
+		virtual void flushUploads() = 0;
+
+		//handle of the last submitted command buffer, empty before the first submit
+		virtual SubmitHandle getLastSubmitHandle() const = 0;
+		//blocks until the command buffer of the handle has finished, an empty handle waits for the whole device
+		virtual void wait(SubmitHandle handle) = 0;
+		//runs the task once the command buffer of the handle has finished, with an empty handle once the command buffer
+		//being recorded has. Resources the gpu may still read are released this way
+		virtual void deferredTask(std::packaged_task<void()>&& task, SubmitHandle handle = SubmitHandle()) = 0;
 
 		virtual std::pair<uint32_t, uint32_t> getWindowSize() = 0;
 
@@ -849,6 +961,21 @@ namespace Gaia
 		virtual uint64_t gpuAddress(BufferHandle handle, size_t offset = 0) = 0;
 		virtual uint64_t gpuAddress(AccelStructHandle handle) = 0;
 
+		//persistently mapped pointer of a host visible buffer, nullptr for device local buffers
+		virtual uint8_t* getMappedPtr(BufferHandle handle) = 0;
+		//makes host writes through getMappedPtr() visible to the device (no-op on coherent memory)
+		virtual void flushMappedMemory(BufferHandle handle, size_t offset, size_t size) = 0;
+		//makes device writes visible to reads through getMappedPtr() (no-op on coherent memory)
+		virtual void invalidateMappedMemory(BufferHandle handle, size_t offset, size_t size) = 0;
+
+		//points one element of a texture array binding at another texture, the set must not be in use by the gpu
+		virtual void updateDescriptorSet(DescriptorSetLayoutHandle handle, uint32_t binding, uint32_t arrayElement, TextureHandle texture) = 0;
+
 		virtual uint32_t getFrameBufferMSAABitMask() const = 0;
+		//[0, MAX_FRAMES_IN_FLIGHT) slot of the frame being recorded, it advances with every present. Buffers the cpu rewrites
+		//every frame keep one slice per slot and write the slice of this one
+		virtual uint32_t getFrameInFlight() const = 0;
+		//cmdDrawIndexedIndirectCount is only valid when this is true
+		virtual bool supportsDrawIndirectCount() const = 0;
 	};
 }
\ No newline at end of file
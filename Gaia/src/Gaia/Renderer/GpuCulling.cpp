@@ -0,0 +1,201 @@
+#include "pch.h"
+#include "GpuCulling.h"
+#include "Renderer.h"
+#include "FrustumCulling.h"
+#include "Gaia/Scene/Scene.h"
+
+namespace Gaia
+{
+	namespace
+	{
+		constexpr uint32_t WORKGROUP_SIZE = 64; //local_size_x of the culling shader
+		constexpr const char* CULL_SHADER_PATH = "E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/cull_draws.comp.spv";
+	}
+
+	GpuCulling::GpuCulling(Renderer* renderer, Scene& scene, uint32_t maxViews)
+		: renderer_(renderer), maxViews_(std::max(maxViews, 1u))
+	{
+		IContext* context = renderer_->getContext();
+		const std::vector<SubMesh>& subMeshes = scene.getMeshes();
+		const std::vector<uint8_t>& subMeshPipelines = renderer_->subMeshPipelines_;
+		numSubMeshes_ = static_cast<uint32_t>(subMeshes.size());
+		numPipelines_ = std::max(static_cast<uint32_t>(renderer_->gBufferPipelines_.size()), 1u);
+
+		//the commands of a view are grouped by pipeline, every range holds all sub meshes of its pipeline
+		pipelineNumSubMeshes_.assign(numPipelines_, 0);
+		for (uint8_t pipeline : subMeshPipelines)
+			pipelineNumSubMeshes_[pipeline]++;
+		pipelineFirstCommand_.assign(numPipelines_, 0);
+		for (uint32_t pipeline = 1; pipeline < numPipelines_; pipeline++)
+			pipelineFirstCommand_[pipeline] = pipelineFirstCommand_[pipeline - 1] + pipelineNumSubMeshes_[pipeline - 1];
+
+		std::vector<GpuSubMesh> gpuSubMeshes(subMeshes.size());
+		for (size_t i = 0; i < subMeshes.size(); i++)
+		{
+			const SubMesh& subMesh = subMeshes[i];
+			const uint32_t pipeline = subMeshPipelines.empty() ? 0 : subMeshPipelines[i];
+			GpuSubMesh& gpuSubMesh = gpuSubMeshes[i];
+			gpuSubMesh.boundsMin = subMesh.boundsMin;
+			gpuSubMesh.transformIndex = static_cast<uint32_t>(subMesh.meshIndex);
+			gpuSubMesh.boundsMax = subMesh.boundsMax;
+			gpuSubMesh.pipeline = pipeline;
+			gpuSubMesh.firstCommand = pipelineFirstCommand_[pipeline];
+			gpuSubMesh.numLods = subMesh.numLods;
+			for (uint32_t level = 0; level < subMesh.numLods; level++)
+			{
+				const SubMeshLod lod = subMesh.getLod(level);
+				gpuSubMesh.lodErrors[level] = level == 0 ? 0.0f : subMesh.lods[level - 1].error;
+				gpuSubMesh.firstIndex[level] = lod.indexOffset;
+				gpuSubMesh.indexCount[level] = lod.indexCount;
+			}
+		}
+
+		BufferDesc subMeshBufferDesc{
+			.usage_type = BufferUsageBits_Storage,
+			.storage_type = StorageType_Device,
+			.size = std::max<size_t>(gpuSubMeshes.size(), 1) * sizeof(GpuSubMesh),
+		};
+		subMeshBuffer_ = context->createBuffer(subMeshBufferDesc);
+		if (!gpuSubMeshes.empty())
+			context->upload(subMeshBuffer_, gpuSubMeshes.data(), gpuSubMeshes.size() * sizeof(GpuSubMesh));
+
+		//the views are rewritten through the mapping every frame, into the slice of the frame in flight
+		BufferDesc viewBufferDesc{
+			.usage_type = BufferUsageBits_Storage,
+			.storage_type = StorageType_HostVisible,
+			.size = MAX_FRAMES_IN_FLIGHT * maxViews_ * sizeof(GpuView),
+		};
+		viewBuffer_ = context->createBuffer(viewBufferDesc);
+
+		BufferDesc drawCommandBufferDesc{
+			.usage_type = BufferUsageBits_Storage | BufferUsageBits_Indirect,
+			.storage_type = StorageType_Device,
+			.size = maxViews_ * std::max<size_t>(numSubMeshes_, 1) * sizeof(DrawIndexedIndirectCommand),
+		};
+		drawCommandBuffer_ = context->createBuffer(drawCommandBufferDesc);
+
+		BufferDesc drawCountBufferDesc{
+			.usage_type = BufferUsageBits_Storage | BufferUsageBits_Indirect,
+			.storage_type = StorageType_Device,
+			.size = maxViews_ * numPipelines_ * sizeof(uint32_t),
+		};
+		drawCountBuffer_ = context->createBuffer(drawCountBufferDesc);
+
+		std::vector<DescriptorSetLayoutDesc> cullingDSLDesc
+		{
+			DescriptorSetLayoutDesc{
+				.binding = 0,
+				.descriptorCount = 1,
+				.descriptorType = DescriptorType_StorageBuffer,
+				.shaderStage = Stage_Com,
+				.buffer = DescriptorSetLayoutDesc::getResource<BufferHandle>(renderer_->transformsBuffer),
+			},
+			DescriptorSetLayoutDesc{
+				.binding = 1,
+				.descriptorCount = 1,
+				.descriptorType = DescriptorType_StorageBuffer,
+				.shaderStage = Stage_Com,
+				.buffer = DescriptorSetLayoutDesc::getResource<BufferHandle>(subMeshBuffer_),
+			},
+			DescriptorSetLayoutDesc{
+				.binding = 2,
+				.descriptorCount = 1,
+				.descriptorType = DescriptorType_StorageBuffer,
+				.shaderStage = Stage_Com,
+				.buffer = DescriptorSetLayoutDesc::getResource<BufferHandle>(viewBuffer_),
+			},
+			DescriptorSetLayoutDesc{
+				.binding = 3,
+				.descriptorCount = 1,
+				.descriptorType = DescriptorType_StorageBuffer,
+				.shaderStage = Stage_Com,
+				.buffer = DescriptorSetLayoutDesc::getResource<BufferHandle>(drawCommandBuffer_),
+			},
+			DescriptorSetLayoutDesc{
+				.binding = 4,
+				.descriptorCount = 1,
+				.descriptorType = DescriptorType_StorageBuffer,
+				.shaderStage = Stage_Com,
+				.buffer = DescriptorSetLayoutDesc::getResource<BufferHandle>(drawCountBuffer_),
+			},
+		};
+		cullingDSL_ = context->createDescriptorSetLayout(cullingDSLDesc);
+
+		ShaderModuleDesc cullShaderDesc = ShaderModuleDesc(CULL_SHADER_PATH, Stage_Com);
+		cullShaderDesc.pushConstantSize = sizeof(PushConstant);
+		cullShader_ = context->createShaderModule(cullShaderDesc);
+
+		ComputePipelineDesc cullPipelineDesc{
+			.smComp = cullShader_
+		};
+		cullPipelineDesc.descriptorSetLayout[0] = cullingDSL_;
+		cullPipeline_ = context->createComputePipeline(cullPipelineDesc);
+		GAIA_CORE_INFO("Gpu culling: {} sub meshes, {} pipeline variants, {} views", numSubMeshes_, numPipelines_, maxViews_);
+	}
+
+	GpuCulling::~GpuCulling()
+	{
+	}
+
+	std::unique_ptr<GpuCulling> GpuCulling::create(Renderer* renderer, Scene& scene, uint32_t maxViews)
+	{
+		if (!renderer->getContext()->supportsDrawIndirectCount())
+		{
+			GAIA_CORE_WARN("The device does not support drawIndirectCount, culling the draws on the cpu");
+			return nullptr;
+		}
+		if (!std::filesystem::exists(CULL_SHADER_PATH))
+		{
+			GAIA_CORE_WARN("Shader {} was not compiled (see Shaders/compile.bat), culling the draws on the cpu", CULL_SHADER_PATH);
+			return nullptr;
+		}
+		return std::make_unique<GpuCulling>(renderer, scene, maxViews);
+	}
+
+	void GpuCulling::cull(const std::vector<CullingView>& views)
+	{
+		GAIA_ASSERT(views.size() <= maxViews_, "more culling views than the buffers were created for");
+		if (numSubMeshes_ == 0 || views.empty())
+			return;
+		IContext* context = renderer_->getContext();
+
+		//the slice of this frame in flight was last read MAX_FRAMES_IN_FLIGHT frames ago, the context waited for that frame
+		const uint32_t firstView = context->getFrameInFlight() * maxViews_;
+		GpuView* gpuViews = reinterpret_cast<GpuView*>(context->getMappedPtr(viewBuffer_)) + firstView;
+		for (size_t i = 0; i < views.size(); i++)
+		{
+			const CullingView& view = views[i];
+			const Frustum frustum = FrustumCulling::extractFrustum(view.projection * view.view);
+			GpuView& gpuView = gpuViews[i];
+			std::copy(std::begin(frustum.planes), std::end(frustum.planes), gpuView.planes);
+			gpuView.view = view.view;
+			gpuView.pixelsPerUnit = std::abs(view.projection[1][1]) * 0.5f * view.viewportHeight;
+			gpuView.orthographic = view.projection[2][3] == 0.0f ? 1 : 0;
+			gpuView.pixelError = Renderer::lodPixelError;
+		}
+		context->flushMappedMemory(viewBuffer_, firstView * sizeof(GpuView), views.size() * sizeof(GpuView));
+
+		const PushConstant pc{ .numSubMeshes = numSubMeshes_, .numPipelines = numPipelines_, .firstView = firstView };
+		ICommandBuffer& cmdBuf = context->acquireCommandBuffer();
+		//the commands and counts are shared by the frames in flight, the draws of the last frame read them before they are rewritten
+		cmdBuf.cmdBufferBarrier(drawCountBuffer_, PipelineStageBits_DrawIndirect, PipelineStageBits_Transfer);
+		cmdBuf.cmdBufferBarrier(drawCommandBuffer_, PipelineStageBits_DrawIndirect, PipelineStageBits_ComputeShader);
+		cmdBuf.cmdFillBuffer(drawCountBuffer_, 0, views.size() * numPipelines_ * sizeof(uint32_t), 0);
+		cmdBuf.cmdBindComputeDescriptorSets(0, cullPipeline_, { cullingDSL_ });
+		cmdBuf.cmdBindComputePipeline(cullPipeline_);
+		cmdBuf.cmdPushConstants(cullPipeline_, Stage_Com, &pc, sizeof(PushConstant));
+		cmdBuf.cmdDispatch((numSubMeshes_ + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, static_cast<uint32_t>(views.size()), 1);
+		cmdBuf.cmdBufferBarrier(drawCommandBuffer_, PipelineStageBits_ComputeShader, PipelineStageBits_DrawIndirect);
+		cmdBuf.cmdBufferBarrier(drawCountBuffer_, PipelineStageBits_ComputeShader, PipelineStageBits_DrawIndirect);
+		context->submit(cmdBuf);
+	}
+
+	void GpuCulling::draw(ICommandBuffer& cmdBuffer, uint32_t view, uint32_t pipeline)
+	{
+		if (pipelineNumSubMeshes_[pipeline] == 0)
+			return;
+		const size_t firstCommand = size_t(view) * numSubMeshes_ + pipelineFirstCommand_[pipeline];
+		cmdBuffer.cmdDrawIndexedIndirectCount(drawCommandBuffer_, firstCommand * sizeof(DrawIndexedIndirectCommand),
+			drawCountBuffer_, (size_t(view) * numPipelines_ + pipeline) * sizeof(uint32_t), pipelineNumSubMeshes_[pipeline]);
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "GaiaRenderer.h"
+#include "glm/glm.hpp"
+
+namespace Gaia
+{
+	class Scene;
+	class Renderer;
+
+	//view and projection of a pass, the viewport height in pixels drives the level of detail selection (see LodSelection.h)
+	struct CullingView
+	{
+		glm::mat4 view = glm::mat4(1.0);
+		glm::mat4 projection = glm::mat4(1.0);
+		float viewportHeight = 1.0f;
+	};
+
+	//culls the sub meshes against the camera and the shadow cascades in a compute shader, selects their levels of detail
+	//and writes compacted DrawIndexedIndirectCommands with one count per pipeline variant. The passes draw them with
+	//cmdDrawIndexedIndirectCount, so the cpu records the same few commands however many sub meshes the scene has.
+	//Every view owns one command per sub mesh, split into one range per g buffer pipeline variant
+	class GpuCulling
+	{
+	public:
+		GpuCulling(Renderer* renderer, Scene& scene, uint32_t maxViews);
+		~GpuCulling();
+		//null when the device lacks drawIndirectCount or the shader was not compiled, the renderer culls on the cpu then
+		static std::unique_ptr<GpuCulling> create(Renderer* renderer, Scene& scene, uint32_t maxViews);
+
+		//culls all views in one dispatch and submits it, the indirect draws of passes submitted afterwards wait for the results
+		void cull(const std::vector<CullingView>& views);
+		//draws the visible sub meshes of a pipeline variant in a view, the caller binds the pipeline and the mesh buffers
+		void draw(ICommandBuffer& cmdBuffer, uint32_t view, uint32_t pipeline);
+		inline uint32_t getNumPipelines() const { return numPipelines_; }
+
+	private:
+		//std430 layouts of Shaders/culling/cull_draws.comp
+		struct GpuSubMesh
+		{
+			glm::vec3 boundsMin = glm::vec3(0.0f);
+			uint32_t transformIndex = 0;
+			glm::vec3 boundsMax = glm::vec3(0.0f);
+			uint32_t pipeline = 0;
+			uint32_t firstCommand = 0; //first command of the pipeline range in every view
+			uint32_t numLods = 1;
+			uint32_t pad0 = 0;
+			uint32_t pad1 = 0;
+			glm::vec4 lodErrors = glm::vec4(0.0f);
+			glm::uvec4 firstIndex = glm::uvec4(0);
+			glm::uvec4 indexCount = glm::uvec4(0);
+		};
+		struct GpuView
+		{
+			glm::vec4 planes[6];
+			glm::mat4 view;
+			float pixelsPerUnit = 1.0f;
+			uint32_t orthographic = 0;
+			float pixelError = 0.0f;
+			uint32_t pad = 0;
+		};
+		struct PushConstant
+		{
+			uint32_t numSubMeshes = 0;
+			uint32_t numPipelines = 1;
+			uint32_t firstView = 0;
+		};
+
+		Renderer* renderer_ = nullptr;
+		uint32_t numSubMeshes_ = 0;
+		uint32_t numPipelines_ = 1;
+		uint32_t maxViews_ = 1;
+		std::vector<uint32_t> pipelineFirstCommand_;
+		std::vector<uint32_t> pipelineNumSubMeshes_;
+
+		Holder<BufferHandle> subMeshBuffer_;
+		Holder<BufferHandle> viewBuffer_; //maxViews_ views per frame in flight
+		Holder<BufferHandle> drawCommandBuffer_; //maxViews_ * numSubMeshes_ commands
+		Holder<BufferHandle> drawCountBuffer_; //maxViews_ * numPipelines_ counts
+		Holder<DescriptorSetLayoutHandle> cullingDSL_;
+		Holder<ShaderModuleHandle> cullShader_;
+		Holder<ComputePipelineHandle> cullPipeline_;
+	};
+}
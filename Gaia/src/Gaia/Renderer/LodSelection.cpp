@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "LodSelection.h"
+#include "Gaia/LoadMesh.h"
+
+namespace Gaia
+{
+	namespace LodSelection
+	{
+		float projectedRadius(const glm::vec3& viewSpaceCenter, float radius, const glm::mat4& projection, float viewportHeight)
+		{
+			float pixelsPerUnit = std::abs(projection[1][1]) * 0.5f * viewportHeight;
+			//orthographic projections have no perspective divide
+			if (projection[2][3] == 0.0f)
+				return radius * pixelsPerUnit;
+
+			//the camera inside the sphere gets the full resolution mesh
+			float distance = glm::length(viewSpaceCenter) - radius;
+			if (distance <= std::numeric_limits<float>::epsilon())
+				return std::numeric_limits<float>::max();
+			return radius * pixelsPerUnit / distance;
+		}
+
+		uint32_t selectLod(const SubMesh& subMesh, const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection,
+			float viewportHeight, float pixelError)
+		{
+			if (subMesh.numLods <= 1)
+				return 0;
+			const float radius = 0.5f * glm::length(subMesh.boundsMax - subMesh.boundsMin);
+			if (!(radius > 0.0f))
+				return 0;
+
+			glm::vec3 center = 0.5f * (subMesh.boundsMin + subMesh.boundsMax);
+			float scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+			glm::vec3 viewSpaceCenter = glm::vec3(view * transform * glm::vec4(center, 1.0f));
+			float pixels = projectedRadius(viewSpaceCenter, radius * scale, projection, viewportHeight);
+
+			//the level errors are object space, relative to the sphere they scale with its projected size
+			for (uint32_t level = subMesh.numLods - 1; level > 0; level--)
+			{
+				if (subMesh.lods[level - 1].error / radius * pixels <= pixelError)
+					return level;
+			}
+			return 0;
+		}
+
+		void buildDraws(std::span<const SubMesh> subMeshes, std::span<const glm::mat4> transforms, std::span<const uint8_t> visible, const glm::mat4& view,
+			const glm::mat4& projection, float viewportHeight, float pixelError, std::vector<uint8_t>& lods, std::vector<DrawRange>& draws,
+			std::span<const uint8_t> subMeshPipelines)
+		{
+			lods.resize(subMeshes.size());
+			auto iter = std::views::iota(size_t(0), subMeshes.size());
+			std::for_each(std::execution::par, iter.begin(), iter.end(), [&](size_t subMeshIndex) {
+				const SubMesh& subMesh = subMeshes[subMeshIndex];
+				if (!visible.empty() && !visible[subMeshIndex])
+					return;
+				lods[subMeshIndex] = static_cast<uint8_t>(selectLod(subMesh, transforms[subMesh.meshIndex], view, projection, viewportHeight, pixelError));
+			});
+
+			//full resolution ranges are stored back to back, so sub meshes that stay at level 0 collapse into a few draws
+			draws.clear();
+			for (size_t subMeshIndex = 0; subMeshIndex < subMeshes.size(); subMeshIndex++)
+			{
+				if (!visible.empty() && !visible[subMeshIndex])
+					continue;
+				SubMeshLod lod = subMeshes[subMeshIndex].getLod(lods[subMeshIndex]);
+				if (lod.indexCount == 0)
+					continue;
+				const uint32_t pipeline = subMeshPipelines.empty() ? 0 : subMeshPipelines[subMeshIndex];
+				if (!draws.empty() && draws.back().firstIndex + draws.back().indexCount == lod.indexOffset && draws.back().pipeline == pipeline)
+					draws.back().indexCount += lod.indexCount;
+				else
+					draws.push_back(DrawRange{ .firstIndex = lod.indexOffset, .indexCount = lod.indexCount, .pipeline = pipeline });
+			}
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <span>
+#include <vector>
+
+namespace Gaia
+{
+	struct SubMesh;
+
+	//index range of the batched index buffer that is drawn with one cmdDrawIndexed
+	struct DrawRange
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		uint32_t pipeline = 0; //pipeline variant the range is drawn with
+	};
+
+	//picks a level of detail (see SubMesh::lods) per sub mesh from the projected size of its bounding sphere.
+	//Used with the camera for the g buffer and with the light matrices for every shadow cascade
+	namespace LodSelection
+	{
+		//radius in pixels of a view space sphere, works for perspective and orthographic projections
+		float projectedRadius(const glm::vec3& viewSpaceCenter, float radius, const glm::mat4& projection, float viewportHeight);
+
+		//coarsest level whose simplification error covers at most pixelError pixels
+		uint32_t selectLod(const SubMesh& subMesh, const glm::mat4& transform, const glm::mat4& view, const glm::mat4& projection,
+			float viewportHeight, float pixelError);
+
+		//selects the level of every visible sub mesh and merges the draws of adjacent index ranges. visible comes from
+		//FrustumCulling::cull, empty draws every sub mesh. subMeshPipelines holds the pipeline variant of every sub mesh,
+		//ranges of different variants are never merged. Empty draws everything with variant 0
+		void buildDraws(std::span<const SubMesh> subMeshes, std::span<const glm::mat4> transforms, std::span<const uint8_t> visible, const glm::mat4& view,
+			const glm::mat4& projection, float viewportHeight, float pixelError, std::vector<uint8_t>& lods, std::vector<DrawRange>& draws,
+			std::span<const uint8_t> subMeshPipelines = {});
+	}
+}
@@ -1,10 +1,13 @@
 #include "pch.h"
 #include "Renderer.h"
 #include "Gaia/Scene/Scene.h"
+#include "Gaia/VertexFormat.h"
+#include "Gaia/TextureMips.h"
 #include "Gaia/Renderer/Vulkan/VulkanClasses.h"
 #include "Shadows.h"
 #include "ddgi.h"
 #include "ddgi.h"
+#include "GpuCulling.h"
 
 #include "Gaia/Input.h"
 #include "Gaia/Application.h"
@@ -14,53 +17,203 @@ namespace Gaia
 {
     bool Renderer::isFirstFrame = true;
     VertexInput Renderer::vertexInput = VertexInput{};
+    VertexFormat Renderer::vertexFormat = VertexFormat_Full;
+    float Renderer::lodPixelError = 1.0f;
+    TextureStreamingDesc Renderer::textureStreaming = {};
+    TexturePackingDesc Renderer::texturePacking = {};
+    bool Renderer::gpuCulling = true;
 
-    void Renderer::onFirstFrame(Scene& scene)
+    namespace
     {
-        //GBuffer render pipeline
+        //every shader with one variant per vertex format (see Renderer::getVertexShaderPath), built by Shaders/compile.bat
+        struct VertexFormatShader
         {
-            ShaderModuleDesc smVertexDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/g_buffer.vert.spv", Stage_Vert);
-            ShaderModuleDesc smFragDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/g_buffer.frag.spv", Stage_Frag);
-            vertexShaderModule = renderContext_->createShaderModule(smVertexDesc);
-            fragmentShaderModule = renderContext_->createShaderModule(smFragDesc);
+            const char* path;
+            bool readsVertexMemory;
+        };
+        constexpr VertexFormatShader VERTEX_FORMAT_SHADERS[] = {
+            { "E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/g_buffer.vert.spv", false },
+            { "E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/vert_shadow.spv", false },
+            { "E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/closestHit.rchit.spv", true },
+            { "E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/gi_closestHit.rchit.spv", true },
+        };
+    }
 
-            RenderPipelineDesc rps{
-                .topology = Topology_Triangle,
-                .smVertex = vertexShaderModule,
-                .smFragment = fragmentShaderModule,
-                .depthFormat = Format_Z_F32,
-                .cullMode = CullMode_Back,
-                .windingMode = WindingMode_CCW,
-                .polygonMode = PolygonMode_Fill,
-            };
+    std::string Renderer::getVertexShaderPath(const std::string& path, bool readsVertexMemory)
+    {
+        if (vertexFormat == VertexFormat_Full)
+            return path;
 
-            //albedo
-            rps.colorAttachments[0].format = Format_RGBA_UN8;
-            rps.colorAttachments[0].blendEnabled = false;
-            rps.colorAttachments[0].alphaBlendOp = BlendOp_Add;
-            rps.colorAttachments[0].rgbBlendOp = BlendOp_Add;
-            rps.colorAttachments[0].srcAlphaBlendFactor = BlendFactor_One;
-            rps.colorAttachments[0].dstAlphaBlendFactor = BlendFactor_One;
-            rps.colorAttachments[0].srcRGBBlendFactor = BlendFactor_SrcAlpha;
-            rps.colorAttachments[0].dstRGBBlendFactor = BlendFactor_OneMinusSrcAlpha;
+        //shaders that fetch through the vertex input only care about compact vs full, the rest also depend on the position type
+        const char* suffix = readsVertexMemory && vertexFormat == VertexFormat_CompactHalfPosition ? "_compact_half" : "_compact";
+        size_t extension = path.find('.', path.find_last_of('/') + 1);
+        return path.substr(0, extension) + suffix + path.substr(extension);
+    }
 
-            //metallic roughness
-            rps.colorAttachments[1].format = Format_RGBA_UN8;
-            rps.colorAttachments[1].blendEnabled = false;
+    void Renderer::setupVertexInput(Scene& scene)
+    {
+        vertexFormat = scene.getVertexFormat();
+        if (vertexFormat != VertexFormat_Full && !VertexEncoding::supportsCompactIds(scene.getMeshes()))
+        {
+            GAIA_CORE_WARN("Material or mesh ids do not fit into the compact vertex format, using the full vertex format");
+            vertexFormat = VertexFormat_Full;
+        }
+        for (const VertexFormatShader& shader : VERTEX_FORMAT_SHADERS)
+        {
+            const std::string variant = getVertexShaderPath(shader.path, shader.readsVertexMemory);
+            if (vertexFormat != VertexFormat_Full && !fs::exists(variant))
+            {
+                GAIA_CORE_WARN("Shader {} was not compiled (see Shaders/compile.bat), using the full vertex format", variant);
+                vertexFormat = VertexFormat_Full;
+            }
+        }
 
-            //normal
-            rps.colorAttachments[2].format = Format_RGBA_F16;
-            rps.colorAttachments[2].blendEnabled = false;
+        vertexInput = VertexInput{};
+        if (vertexFormat == VertexFormat_Full)
+        {
+            vertexInput.attributes[0].binding = 0;
+            vertexInput.attributes[0].format = Format_RGBA_F32;
+            vertexInput.attributes[0].location = 0;
+            vertexInput.attributes[0].offset = offsetof(LoadMesh::VertexAttributes, Position);
+
+            vertexInput.attributes[1].binding = 0;
+            vertexInput.attributes[1].format = Format_RG_F32;
+            vertexInput.attributes[1].location = 1;
+            vertexInput.attributes[1].offset = offsetof(LoadMesh::VertexAttributes, TextureCoordinate);
+
+            vertexInput.attributes[2].binding = 0;
+            vertexInput.attributes[2].format = Format_RGB_F32;
+            vertexInput.attributes[2].location = 2;
+            vertexInput.attributes[2].offset = offsetof(LoadMesh::VertexAttributes, Normal);
+
+            vertexInput.attributes[3].binding = 0;
+            vertexInput.attributes[3].format = Format_RGBA_F32;
+            vertexInput.attributes[3].location = 3;
+            vertexInput.attributes[3].offset = offsetof(LoadMesh::VertexAttributes, Tangent);
+
+            vertexInput.attributes[4].binding = 0;
+            vertexInput.attributes[4].format = Format_R_UI32;
+            vertexInput.attributes[4].location = 4;
+            vertexInput.attributes[4].offset = offsetof(LoadMesh::VertexAttributes, materialId);
+
+            vertexInput.attributes[5].binding = 0;
+            vertexInput.attributes[5].format = Format_R_UI32;
+            vertexInput.attributes[5].location = 5;
+            vertexInput.attributes[5].offset = offsetof(LoadMesh::VertexAttributes, meshId);
+        }
+        else
+        {
+            //both compact layouts share everything but the position, the vertex fetch expands the packed attributes
+            bool halfPosition = vertexFormat == VertexFormat_CompactHalfPosition;
+            vertexInput.attributes[0].binding = 0;
+            vertexInput.attributes[0].format = halfPosition ? Format_RGBA_F16 : Format_RGB_F32;
+            vertexInput.attributes[0].location = 0;
+            vertexInput.attributes[0].offset = 0;
+
+            vertexInput.attributes[1].binding = 0;
+            vertexInput.attributes[1].format = Format_RG_F16;
+            vertexInput.attributes[1].location = 1;
+            vertexInput.attributes[1].offset = halfPosition ? offsetof(CompactVertexHalf, TextureCoordinate) : offsetof(CompactVertex, TextureCoordinate);
+
+            vertexInput.attributes[2].binding = 0;
+            vertexInput.attributes[2].format = Format_RG_SN16;
+            vertexInput.attributes[2].location = 2;
+            vertexInput.attributes[2].offset = halfPosition ? offsetof(CompactVertexHalf, Normal) : offsetof(CompactVertex, Normal);
+
+            vertexInput.attributes[3].binding = 0;
+            vertexInput.attributes[3].format = Format_RG_SN16;
+            vertexInput.attributes[3].location = 3;
+            vertexInput.attributes[3].offset = halfPosition ? offsetof(CompactVertexHalf, Tangent) : offsetof(CompactVertex, Tangent);
+
+            vertexInput.attributes[4].binding = 0;
+            vertexInput.attributes[4].format = Format_R_UI32;
+            vertexInput.attributes[4].location = 4;
+            vertexInput.attributes[4].offset = halfPosition ? offsetof(CompactVertexHalf, Ids) : offsetof(CompactVertex, Ids);
+        }
+        vertexInput.inputBindings[0].stride = VertexEncoding::getVertexStride(vertexFormat);
+    }
 
+    void Renderer::onFirstFrame(Scene& scene)
+    {
+        //GBuffer render pipelines, one per material feature set the scene uses (see MaterialFeatures in Material.h)
+        {
+            std::string vertexShaderPath = getVertexShaderPath("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/g_buffer.vert.spv");
+            ShaderModuleDesc smVertexDesc(vertexShaderPath.c_str(), Stage_Vert);
+            ShaderModuleDesc smFragDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/g_buffer.frag.spv", Stage_Frag);
+            vertexShaderModule = renderContext_->createShaderModule(smVertexDesc);
+            fragmentShaderModule = renderContext_->createShaderModule(smFragDesc);
 
-            rps.descriptorSetLayout[0] = mvpMatrixDescriptorSetLayout;
-            rps.descriptorSetLayout[1] = meshDescriptorSet;
+            //variant of every material, then of every sub mesh
+            const std::vector<Material>& materials = scene.getMaterials();
+            std::vector<uint8_t> materialPipelines(materials.size());
+            gBufferPipelineFeatures_.clear();
+            for (size_t i = 0; i < materials.size(); i++)
+            {
+                const uint32_t features = materials[i].getFeatures();
+                auto variant = std::find(gBufferPipelineFeatures_.begin(), gBufferPipelineFeatures_.end(), features);
+                if (variant == gBufferPipelineFeatures_.end())
+                    variant = gBufferPipelineFeatures_.insert(variant, features);
+                materialPipelines[i] = static_cast<uint8_t>(variant - gBufferPipelineFeatures_.begin());
+            }
+            if (gBufferPipelineFeatures_.empty())
+                gBufferPipelineFeatures_.push_back(MaterialFeatures_None);
 
-            rps.vertexInput = vertexInput;
+            std::span<const SubMesh> subMeshes = scene.getMeshes();
+            subMeshPipelines_.resize(subMeshes.size());
+            for (size_t i = 0; i < subMeshes.size(); i++)
+                subMeshPipelines_[i] = subMeshes[i].materialId < materialPipelines.size() ? materialPipelines[subMeshes[i].materialId] : 0;
 
-            renderPipelineGBuffer = renderContext_->createRenderPipeline(rps);
+            gBufferPipelines_.clear();
+            for (uint32_t features : gBufferPipelineFeatures_)
+            {
+                RenderPipelineDesc rps{
+                    .topology = Topology_Triangle,
+                    .smVertex = vertexShaderModule,
+                    .smFragment = fragmentShaderModule,
+                    .specInfo = {
+                        .entries = { {.constantId = 0, .offset = 0, .size = sizeof(features)} },
+                        .data = &features,
+                        .dataSize = sizeof(features),
+                    },
+                    .depthFormat = Format_Z_F32,
+                    .cullMode = (features & MaterialFeatures_DoubleSided) ? CullMode_None : CullMode_Back,
+                    .windingMode = WindingMode_CCW,
+                    .polygonMode = PolygonMode_Fill,
+                };
+
+                //albedo
+                rps.colorAttachments[0].format = Format_RGBA_UN8;
+                rps.colorAttachments[0].blendEnabled = false;
+                rps.colorAttachments[0].alphaBlendOp = BlendOp_Add;
+                rps.colorAttachments[0].rgbBlendOp = BlendOp_Add;
+                rps.colorAttachments[0].srcAlphaBlendFactor = BlendFactor_One;
+                rps.colorAttachments[0].dstAlphaBlendFactor = BlendFactor_One;
+                rps.colorAttachments[0].srcRGBBlendFactor = BlendFactor_SrcAlpha;
+                rps.colorAttachments[0].dstRGBBlendFactor = BlendFactor_OneMinusSrcAlpha;
+
+                //metallic roughness
+                rps.colorAttachments[1].format = Format_RGBA_UN8;
+                rps.colorAttachments[1].blendEnabled = false;
+
+                //normal
+                rps.colorAttachments[2].format = Format_RGBA_F16;
+                rps.colorAttachments[2].blendEnabled = false;
+
+
+                rps.descriptorSetLayout[0] = mvpMatrixDescriptorSetLayout;
+                rps.descriptorSetLayout[1] = meshDescriptorSet;
+
+                rps.vertexInput = vertexInput;
+
+                gBufferPipelines_.push_back(renderContext_->createRenderPipeline(rps));
+            }
+            GAIA_CORE_INFO("G buffer pipeline variants: {} for {} materials", gBufferPipelines_.size(), materials.size());
         }
 
+        //the camera and every shadow cascade are culled in one dispatch, the commands are grouped by g buffer pipeline
+        if (gpuCulling)
+            gpuCulling_ = GpuCulling::create(this, scene, 1 + shadows_->getNumCascades());
+
 
         //gi render pipeline
         {
@@ -119,38 +272,7 @@ namespace Gaia
 
     Renderer::Renderer(void* window, Scene& scene)
     {
-        //set up the vertex attributes
-        vertexInput.attributes[0].binding = 0;
-        vertexInput.attributes[0].format = Format_RGBA_F32;
-        vertexInput.attributes[0].location = 0;
-        vertexInput.attributes[0].offset = offsetof(LoadMesh::VertexAttributes, Position);
-
-        vertexInput.attributes[1].binding = 0;
-        vertexInput.attributes[1].format = Format_RG_F32;
-        vertexInput.attributes[1].location = 1;
-        vertexInput.attributes[1].offset = offsetof(LoadMesh::VertexAttributes, TextureCoordinate);
-
-        vertexInput.attributes[2].binding = 0;
-        vertexInput.attributes[2].format = Format_RGB_F32;
-        vertexInput.attributes[2].location = 2;
-        vertexInput.attributes[2].offset = offsetof(LoadMesh::VertexAttributes, Normal);
-
-        vertexInput.attributes[3].binding = 0;
-        vertexInput.attributes[3].format = Format_RGB_F32;
-        vertexInput.attributes[3].location = 3;
-        vertexInput.attributes[3].offset = offsetof(LoadMesh::VertexAttributes, Tangent);
-
-        vertexInput.attributes[4].binding = 0;
-        vertexInput.attributes[4].format = Format_R_UI32;
-        vertexInput.attributes[4].location = 4;
-        vertexInput.attributes[4].offset = offsetof(LoadMesh::VertexAttributes, materialId);
-
-        vertexInput.attributes[5].binding = 0;
-        vertexInput.attributes[5].format = Format_R_UI32;
-        vertexInput.attributes[5].location = 5;
-        vertexInput.attributes[5].offset = offsetof(LoadMesh::VertexAttributes, meshId);
-
-        vertexInput.inputBindings[0].stride = sizeof(LoadMesh::VertexAttributes);
+        setupVertexInput(scene);
 
         renderContext_ = std::make_unique<VulkanContext>(window);
 
@@ -200,6 +322,9 @@ namespace Gaia
         
         //create vertex, index buffers and build the acceleration structure
         createStaticBuffers(scene);
+        createMeshletBuffers(scene);
+        //everything the gpu needs is uploaded, the scene decides what happens to its CPU copies (see CpuResidency)
+        scene.releaseCpuData();
 
         SamplerStateDesc samplerDesc{
             .minFilter = SamplerFilter_Linear,
@@ -235,13 +360,6 @@ namespace Gaia
         };
         mvpBuffer = renderContext_->createBuffer(bufDesc);
 
-        BufferDesc bufDesc2 = {
-           .usage_type = BufferUsageBits_Uniform,
-           .storage_type = StorageType_HostVisible,
-           .size = sizeof(MVPMatrices),
-        };
-        mvpBufferStaging = renderContext_->createBuffer(bufDesc2);
-
         BufferDesc lightParamBufferDesc{
             .usage_type = BufferUsageBits_Uniform,
            .storage_type = StorageType_Device,
@@ -249,18 +367,12 @@ namespace Gaia
         };
         lightParameterBuffer = renderContext_->createBuffer(lightParamBufferDesc);
 
-        lightParamBufferDesc.storage_type = StorageType_HostVisible;
-        lightParameterBufferStaging = renderContext_->createBuffer(lightParamBufferDesc);
-
         BufferDesc lightMatrixBufferDesc{
            .usage_type = BufferUsageBits_Uniform,
           .storage_type = StorageType_Device,
           .size = sizeof(LightData) * MAX_SHADOW_CASCADES,
         };
         lightMatricesBuffer = renderContext_->createBuffer(lightMatrixBufferDesc);
-
-        lightMatrixBufferDesc.storage_type = StorageType_HostVisible;
-        lightMatricesBufferStaging = renderContext_->createBuffer(lightMatrixBufferDesc);
         
 
         //create descriptor sets
@@ -290,6 +402,7 @@ namespace Gaia
         };
          mvpMatrixDescriptorSetLayout = renderContext_->createDescriptorSetLayout(layoutDesc);
 
+         BufferHandle textureFeedbackBuffer = textureStreamer_->getFeedbackBuffer();
          std::vector<DescriptorSetLayoutDesc> meshLayoutDesc{
              DescriptorSetLayoutDesc{
                  .binding = 0,
@@ -306,6 +419,21 @@ namespace Gaia
                  .texture = DescriptorSetLayoutDesc::getResource<TextureHandle>(glTfTextures),
                  .sampler = imageSampler,
              },
+             DescriptorSetLayoutDesc{
+                 .binding = 2,
+                 .descriptorCount = 1,
+                 .descriptorType = DescriptorType_StorageBuffer,
+                 .shaderStage = Stage_Frag,
+                 .buffer = DescriptorSetLayoutDesc::getResource<BufferHandle>(textureFeedbackBuffer),
+             },
+             DescriptorSetLayoutDesc{
+                 .binding = 3,
+                 .descriptorCount = static_cast<uint32_t>(textureArrays_.size()),
+                 .descriptorType = DescriptorType_CombinedImageSampler,
+                 .shaderStage = Stage_Frag | Stage_RayGen | Stage_ClosestHit | Stage_Miss,
+                 .texture = DescriptorSetLayoutDesc::getResource<TextureHandle>(textureArrays_),
+                 .sampler = imageSampler,
+             },
          };
         meshDescriptorSet = renderContext_->createDescriptorSetLayout(meshLayoutDesc);
 
@@ -442,7 +570,8 @@ namespace Gaia
         ShaderModuleDesc rayGenShaderDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/rayGen.rgen.spv", Stage_RayGen);
         ShaderModuleDesc missShaderDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/rayMiss.rmiss.spv", Stage_Miss);
         ShaderModuleDesc shadowMissShaderDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/shadowMiss.rmiss.spv", Stage_Miss);
-        ShaderModuleDesc closestHitShaderDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/closestHit.rchit.spv", Stage_ClosestHit);
+        std::string closestHitShaderPath = getVertexShaderPath("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/closestHit.rchit.spv", true);
+        ShaderModuleDesc closestHitShaderDesc(closestHitShaderPath.c_str(), Stage_ClosestHit);
 
         rayGenShaderModule = renderContext_->createShaderModule(rayGenShaderDesc);
         missShaderModule = renderContext_->createShaderModule(missShaderDesc);
@@ -471,78 +600,130 @@ namespace Gaia
     }
     void Renderer::createGpuMeshTexturesAndBuffers(Scene& scene)
     {
-        //lamda function that constructs a texture handle and copies the gltf texture data to there
-        auto textureFunction = [&](Texture& gltfTexture, Format _textureFormat) {
-            Texture& texture = gltfTexture;
-            TextureDesc Desc{
-                .type = TextureType_2D,
-                .format = _textureFormat,
-                .dimensions = {(uint32_t)texture.width, (uint32_t)texture.height, 1},
-                .usage = TextureUsageBits_Sampled,
-                .numMipLevels = 1,
-                .storage = StorageType_Device,
-                .generateMipmaps = false,
-            };
-            glTfTextures.push_back(renderContext_->createTexture(Desc));
-            Holder<TextureHandle>& _textureHandle = glTfTextures.back();
-
-            BufferDesc stagingBufferDesc{
-                .usage_type = BufferUsageBits_Storage,
-                .storage_type = StorageType_HostVisible,
-                .size = texture.textureData.size(),
-            };
-            Holder<BufferHandle> stagingBufferHandle = renderContext_->createBuffer(stagingBufferDesc);
-
-            //copy the texture data to the gpu texture
+        //block compressed textures (see TextureCompressor.h) are uploaded as is, srgb only applies to color textures
+        auto textureFormat = [](const Texture& texture, bool srgb) {
+            switch (texture.encoding)
             {
-                ICommandBuffer& cmdBuffer = renderContext_->acquireCommandBuffer();
-                cmdBuffer.copyBuffer(stagingBufferHandle, texture.textureData.data(), texture.textureData.size());
-                cmdBuffer.cmdTransitionImageLayout(_textureHandle, ImageLayout_TRANSFER_DST_OPTIMAL);
-                cmdBuffer.cmdCopyBufferToImage(stagingBufferHandle, _textureHandle);
-                cmdBuffer.cmdTransitionImageLayout(_textureHandle, ImageLayout_READ_ONLY_OPTIMAL);
-                renderContext_->submit(cmdBuffer);
+            case TextureEncoding_BC1:
+                return srgb ? Format_BC1_RGB_SRGB : Format_BC1_RGB_UN;
+            case TextureEncoding_BC3:
+                return srgb ? Format_BC3_SRGB : Format_BC3_UN;
+            case TextureEncoding_BC4:
+                return Format_BC4_UN;
+            case TextureEncoding_BC5:
+                return Format_BC5_UN;
+            case TextureEncoding_BC7:
+                return srgb ? Format_BC7_SRGB : Format_BC7_UN;
+            default:
+                return srgb ? Format_RGBA_SRGB8 : Format_RGBA_UN8;
             }
-            /* texture.textureData.clear();
-             texture.textureData.shrink_to_fit();*/
             };
 
-        int numGpuTextures = 0;
         std::vector<Material>& pbrMaterials = scene.getMaterials();
         std::vector<Texture>& gltfTextures = scene.getTextures();
         std::vector<glm::mat4>& globalTransforms = scene.getGlobalTransforms();
 
+        //the small levels of every texture go through the staging ring with the other uploads, the finer ones are streamed in
+        //when the g buffer pass asks for them (see TextureStreamer.h)
+        TextureStreamingDesc streamingDesc = textureStreaming;
+        streamingDesc.streamFromMemory &= scene.getCpuResidency() == CpuResidency_Keep;
+        textureStreamer_ = std::make_unique<TextureStreamer>(renderContext_.get(), streamingDesc, scene.getTextureCachePath(), glTfTextures);
+
+        //materials that share an image share its gpu texture, the material index is replaced by the registry slot first
+        textureRegistry.beginAsset();
+        const uint32_t firstSlot = static_cast<uint32_t>(textureSlots_.size());
+        std::vector<TexturePacking::Candidate> newTextures; //textures of the slots this asset adds, in slot order
+        auto registerTexture = [&](int& textureIndex, bool srgb) {
+            if (textureIndex == -1)
+                return;
+            Texture& texture = gltfTextures[textureIndex];
+            Format format = textureFormat(texture, srgb);
+            TextureRegistry::Slot slot = textureRegistry.acquire(texture, textureIndex, format);
+            if (slot.isNew)
+            {
+                newTextures.push_back({ .texture = &texture, .format = format });
+                GAIA_ASSERT(slot.index == firstSlot + newTextures.size() - 1, "texture registry slots must be handed out in order");
+            }
+            textureIndex = static_cast<int>(slot.index);
+            };
+
         for (int i = 0; i < pbrMaterials.size(); i++)
         {
             Material& pbrMaterial = pbrMaterials[i];
+            registerTexture(pbrMaterial.baseColorTexture, true);
+            registerTexture(pbrMaterial.normalTexture, false);
+            registerTexture(pbrMaterial.metallicRoughnessTexture, false);
+        }
 
-            //albedo texture
-            if (pbrMaterial.baseColorTexture != -1)
-            {
-                textureFunction(
-                    gltfTextures[pbrMaterial.baseColorTexture],
-                    Format_RGBA_SRGB8);
-                pbrMaterial.baseColorTexture = numGpuTextures;
-                numGpuTextures++;
-            }
-            //normal Texture
-            if (pbrMaterial.normalTexture != -1)
+        //packed slots become layers of array textures (see TexturePacking.h), the others get their own streamed texture
+        textureSlots_.resize(firstSlot + newTextures.size(), -1);
+        uint32_t numPackedTextures = 0;
+        if (texturePacking.enabled)
+        {
+            for (const TexturePacking::Group& group : TexturePacking::group(newTextures, texturePacking.minLayers))
             {
-                textureFunction(
-                    gltfTextures[pbrMaterial.normalTexture],
-                    Format_RGBA_UN8);
-                pbrMaterial.normalTexture = numGpuTextures;
-                numGpuTextures++;
+                TextureDesc arrayDesc{
+                    .type = TextureType_2DArray,
+                    .format = group.format,
+                    .dimensions = {group.width, group.height, 1},
+                    .numLayers = static_cast<uint32_t>(group.layers.size()),
+                    .usage = TextureUsageBits_Sampled,
+                    .numMipLevels = group.numMips,
+                    .storage = StorageType_Device,
+                };
+                textureArrays_.push_back(renderContext_->createTexture(arrayDesc));
+                const uint32_t arrayIndex = static_cast<uint32_t>(textureArrays_.size() - 1);
+                for (uint32_t layer = 0; layer < group.layers.size(); layer++)
+                {
+                    const Texture& texture = *newTextures[group.layers[layer]].texture;
+                    std::vector<uint64_t> levelOffsets(texture.numMips);
+                    for (uint32_t level = 0; level < texture.numMips; level++)
+                        levelOffsets[level] = TextureMips::getLevelOffset(texture, level);
+                    renderContext_->upload(textureArrays_.back(), texture.getTexels().data(), texture.getTexels().size(), levelOffsets, layer);
+                    textureSlots_[firstSlot + group.layers[layer]] = TexturePacking::encode(arrayIndex, layer);
+                }
+                numPackedTextures += static_cast<uint32_t>(group.layers.size());
             }
-            //metallic roughness texture
-            if (pbrMaterial.metallicRoughnessTexture != -1)
+        }
+        for (uint32_t i = 0; i < newTextures.size(); i++)
+        {
+            if (textureSlots_[firstSlot + i] != -1)
+                continue;
+            textureStreamer_->addTexture(*newTextures[i].texture, newTextures[i].format);
+            textureSlots_[firstSlot + i] = static_cast<int>(glTfTextures.size() - 1);
+        }
+        for (Material& pbrMaterial : pbrMaterials)
+        {
+            for (int* textureIndex : { &pbrMaterial.baseColorTexture, &pbrMaterial.normalTexture, &pbrMaterial.metallicRoughnessTexture })
             {
-                textureFunction(
-                    gltfTextures[pbrMaterial.metallicRoughnessTexture],
-                    Format_RGBA_UN8);
-                pbrMaterial.metallicRoughnessTexture = numGpuTextures;
-                numGpuTextures++;
+                if (*textureIndex != -1)
+                    *textureIndex = textureSlots_[*textureIndex];
             }
         }
+        //the array binding of the mesh descriptor set needs at least one texture
+        if (textureArrays_.empty())
+        {
+            TextureDesc emptyDesc{
+                .type = TextureType_2DArray,
+                .format = Format_RGBA_UN8,
+                .usage = TextureUsageBits_Sampled,
+                .storage = StorageType_Device,
+            };
+            textureArrays_.push_back(renderContext_->createTexture(emptyDesc));
+            const uint8_t white[4] = { 255, 255, 255, 255 };
+            renderContext_->upload(textureArrays_.back(), white, sizeof(white), { 0 });
+        }
+        if (texturePacking.enabled)
+        {
+            GAIA_CORE_INFO("Texture packing: {} textures in {} arrays, {} textures of their own", numPackedTextures, textureArrays_.size(),
+                newTextures.size() - numPackedTextures);
+        }
+        const TextureRegistry::Stats& textureStats = textureRegistry.getStats();
+        GAIA_CORE_INFO("Texture registry: {} references -> {} gpu textures, {:.1f} MB uploaded, {:.1f} MB saved by sharing",
+            textureStats.numRequests, textureStats.numTextures, textureStats.uploadedBytes / (1024.0 * 1024.0), textureStats.savedBytes / (1024.0 * 1024.0));
+        textureStreamer_->createFeedbackBuffer();
+        GAIA_CORE_INFO("Texture streaming: {:.1f} MB resident at load", textureStreamer_->getStats().residentBytes / (1024.0 * 1024.0));
+
         BufferDesc matBufferDesc{
             .usage_type = BufferUsageBits_Storage,
             .storage_type = StorageType_Device,
@@ -550,9 +731,6 @@ namespace Gaia
         };
         materialsBuffer = renderContext_->createBuffer(matBufferDesc);
 
-        matBufferDesc.storage_type = StorageType_HostVisible;
-        Holder<BufferHandle> materialsBufferStaging = renderContext_->createBuffer(matBufferDesc);
-
         BufferDesc transformBufferDesc{
             .usage_type = BufferUsageBits_Storage,
             .storage_type = StorageType_Device,
@@ -560,18 +738,10 @@ namespace Gaia
         };
         transformsBuffer = renderContext_->createBuffer(transformBufferDesc);
 
-        transformBufferDesc.storage_type = StorageType_HostVisible;
-        Holder<BufferHandle> transformBufferStaging = renderContext_->createBuffer(transformBufferDesc);
-
-        //copy the staging buffers to device visible buffers
-        {
-            ICommandBuffer& cmdBuffer = renderContext_->acquireCommandBuffer();
-            cmdBuffer.copyBuffer(materialsBufferStaging, pbrMaterials.data(), matBufferDesc.size);
-            cmdBuffer.copyBuffer(transformBufferStaging, globalTransforms.data(), transformBufferDesc.size);
-            cmdBuffer.cmdCopyBufferToBuffer(materialsBufferStaging, materialsBuffer);
-            cmdBuffer.cmdCopyBufferToBuffer(transformBufferStaging, transformsBuffer);
-            renderContext_->submit(cmdBuffer);
-        }
+        //textures, materials and transforms are copied in one batch, the gpu works on it while the cpu keeps loading
+        renderContext_->upload(materialsBuffer, pbrMaterials.data(), matBufferDesc.size);
+        renderContext_->upload(transformsBuffer, globalTransforms.data(), transformBufferDesc.size);
+        renderContext_->flushUploads();
     }
     std::shared_ptr<Renderer> Renderer::create(void* window, Scene& scene)
     {
@@ -580,34 +750,65 @@ namespace Gaia
         return std::make_shared<Renderer>(window, scene);
     }
 
-    void Renderer::createStaticBuffers(Scene& scene) 
+    void Renderer::createMeshletBuffers(Scene& scene)
     {
-        std::vector<LoadMesh::VertexAttributes> buffer;
-        std::vector<uint32_t> indicesBuffer;
-        std::vector<uint32_t> indicesBufferRT;
+        std::vector<Meshlet>& meshlets = scene.getMeshlets();
+        std::vector<uint32_t>& meshletVertices = scene.getMeshletVertices();
+        std::vector<uint8_t>& meshletTriangles = scene.getMeshletTriangles();
+        if (meshlets.empty())
+            return;
+
+        BufferDesc meshletBufferDesc{
+            .usage_type = BufferUsageBits_Storage,
+            .storage_type = StorageType_Device,
+            .size = meshlets.size() * sizeof(Meshlet),
+        };
+        BufferDesc meshletVertexBufferDesc{
+            .usage_type = BufferUsageBits_Storage,
+            .storage_type = StorageType_Device,
+            .size = meshletVertices.size() * sizeof(uint32_t),
+        };
+        BufferDesc meshletTriangleBufferDesc{
+            .usage_type = BufferUsageBits_Storage,
+            .storage_type = StorageType_Device,
+            .size = meshletTriangles.size(),
+        };
+        meshletBuffer = renderContext_->createBuffer(meshletBufferDesc);
+        meshletVertexBuffer = renderContext_->createBuffer(meshletVertexBufferDesc);
+        meshletTriangleBuffer = renderContext_->createBuffer(meshletTriangleBufferDesc);
+
+        meshletBufferDesc.storage_type = StorageType_HostVisible;
+        meshletVertexBufferDesc.storage_type = StorageType_HostVisible;
+        meshletTriangleBufferDesc.storage_type = StorageType_HostVisible;
+        Holder<BufferHandle> meshletBufferStaging = renderContext_->createBuffer(meshletBufferDesc);
+        Holder<BufferHandle> meshletVertexBufferStaging = renderContext_->createBuffer(meshletVertexBufferDesc);
+        Holder<BufferHandle> meshletTriangleBufferStaging = renderContext_->createBuffer(meshletTriangleBufferDesc);
 
-        int totalIndices = 0;
-        for (auto& subMesh_ : scene.getMeshes())
+        //copy the staging buffers to device visible buffers
         {
-            SubMesh& subMesh = subMesh_.second;
-            for (int i = 0; i < subMesh.Vertices.size(); i++)
-            {
-                glm::vec3 transformed_normals = (subMesh.Normal[i]);//re-orienting the normals (do not include translation as normals only needs to be orinted)
-                glm::vec3 transformed_tangents = (subMesh.Tangent[i]);
-                glm::vec3 transformed_binormals = (subMesh.BiTangent[i]);
-                buffer.push_back(LoadMesh::VertexAttributes(glm::vec4(subMesh.Vertices[i], 1.0), subMesh.TexCoord[i], transformed_normals, transformed_tangents,subMesh.m_MaterialID[i], subMesh.meshIndices[i]));
-            }
-            for (int i = 0; i < subMesh.indices.size(); i++)
-            {  
-                indicesBuffer.push_back(subMesh.indices[i] + totalIndices); //offset the indices
-                indicesBufferRT.push_back(subMesh.indices[i]); //for RT indices I dont offset the indices
-            }
-            totalIndices += subMesh.Vertices.size();
+            ICommandBuffer& cmdBuffer = renderContext_->acquireCommandBuffer();
+            cmdBuffer.copyBuffer(meshletBufferStaging, meshlets.data(), meshletBufferDesc.size);
+            cmdBuffer.copyBuffer(meshletVertexBufferStaging, meshletVertices.data(), meshletVertexBufferDesc.size);
+            cmdBuffer.copyBuffer(meshletTriangleBufferStaging, meshletTriangles.data(), meshletTriangleBufferDesc.size);
+            cmdBuffer.cmdCopyBufferToBuffer(meshletBufferStaging, meshletBuffer);
+            cmdBuffer.cmdCopyBufferToBuffer(meshletVertexBufferStaging, meshletVertexBuffer);
+            cmdBuffer.cmdCopyBufferToBuffer(meshletTriangleBufferStaging, meshletTriangleBuffer);
+            renderContext_->submit(cmdBuffer);
         }
+    }
+
+    void Renderer::createStaticBuffers(Scene& scene) 
+    {
+        //the scene already holds the interleaved vertices and sub mesh relative indices in their final layout
+        std::span<LoadMesh::VertexAttributes> vertices = scene.getVertices();
+        std::span<uint32_t> indices = scene.getIndices();
+        std::vector<SubMesh>& subMeshes = scene.getMeshes();
+
+        const uint32_t vertexStride = VertexEncoding::getVertexStride(vertexFormat);
         BufferDesc vertexBufferDesc{
             .usage_type = BufferUsageBits_Vertex | BufferUsageBits_AccelStructBuildInputReadOnly,
             .storage_type = StorageType_Device,
-            .size = buffer.size() * sizeof(LoadMesh::VertexAttributes),
+            .size = vertices.size() * vertexStride,
         };
         vertexBuffer = renderContext_->createBuffer(vertexBufferDesc);
 
@@ -615,7 +816,7 @@ namespace Gaia
         {
             .usage_type = BufferUsageBits_Index | BufferUsageBits_AccelStructBuildInputReadOnly,
             .storage_type = StorageType_Device,
-            .size = indicesBuffer.size() * sizeof(uint32_t),
+            .size = indices.size_bytes(),
         };
         indexBuffer = renderContext_->createBuffer(indexBufferDesc);
         indexBufferRT = renderContext_->createBuffer(indexBufferDesc); //buffer sizes are same
@@ -628,14 +829,37 @@ namespace Gaia
         Holder<BufferHandle> indexbufferStaging = renderContext_->createBuffer(indexBufferDesc);
         Holder<BufferHandle> indexbufferStagingRT = renderContext_->createBuffer(indexBufferDesc);
 
-        numIndicesPerMesh = indicesBuffer.size();
+        //the full resolution indices of all sub meshes come first, the coarser levels of detail follow
+        numIndicesPerMesh = 0;
+        for (const SubMesh& subMesh : subMeshes)
+        {
+            numIndicesPerMesh = std::max(numIndicesPerMesh, subMesh.indexOffset + subMesh.indexCount);
+        }
+
+        //rasterization draws the whole scene at once so the vertex offset of every sub mesh is baked into the indices,
+        //they are written straight into the mapped staging memory. For RT indices I dont offset the indices
+        uint32_t* rasterIndices = reinterpret_cast<uint32_t*>(renderContext_->getMappedPtr(indexbufferStaging));
+        for (const SubMesh& subMesh : subMeshes)
+        {
+            for (uint32_t level = 0; level < subMesh.numLods; level++)
+            {
+                SubMeshLod lod = subMesh.getLod(level);
+                for (uint32_t i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; i++)
+                {
+                    rasterIndices[i] = indices[i] + subMesh.vertexOffset;
+                }
+            }
+        }
+        renderContext_->flushMappedMemory(indexbufferStaging, 0, indexBufferDesc.size);
+
+        //vertices are encoded into the GPU layout straight in the mapped staging memory
+        VertexEncoding::encodeVertices(vertexFormat, vertices, renderContext_->getMappedPtr(vertexBufferStaging));
+        renderContext_->flushMappedMemory(vertexBufferStaging, 0, vertexBufferDesc.size);
 
         //copy the staging buffers to device visible buffers
         {
             ICommandBuffer& cmdBuffer = renderContext_->acquireCommandBuffer();
-            cmdBuffer.copyBuffer(vertexBufferStaging, buffer.data(), vertexBufferDesc.size);
-            cmdBuffer.copyBuffer(indexbufferStaging, indicesBuffer.data(), indexBufferDesc.size);
-            cmdBuffer.copyBuffer(indexbufferStagingRT, indicesBufferRT.data(), indexBufferDesc.size);
+            cmdBuffer.copyBuffer(indexbufferStagingRT, indices.data(), indexBufferDesc.size);
 
             cmdBuffer.cmdCopyBufferToBuffer(vertexBufferStaging, vertexBuffer);
             cmdBuffer.cmdCopyBufferToBuffer(indexbufferStaging, indexBuffer);
@@ -643,6 +867,17 @@ namespace Gaia
             renderContext_->submit(cmdBuffer);
         }
 
+        //every sub mesh adds at most one draw range, the commands are rewritten through the mapping every frame
+        //into the slice of the frame in flight, so the gpu can still draw the previous frame from its own slice
+        maxCameraDraws_ = std::max<size_t>(subMeshes.size(), 1);
+        BufferDesc indirectBufferDesc{
+            .usage_type = BufferUsageBits_Indirect,
+            .storage_type = StorageType_HostVisible,
+            .size = MAX_FRAMES_IN_FLIGHT * maxCameraDraws_ * sizeof(DrawIndexedIndirectCommand),
+        };
+        cameraIndirectBuffer_ = renderContext_->createBuffer(indirectBufferDesc);
+        FrustumCulling::updateBounds(subMeshes, scene.getGlobalTransforms(), subMeshBounds_);
+
         //need a 3x4 transform buffer for blas build
         BufferDesc blasTransform{
             .usage_type = BufferUsageBits_AccelStructBuildInputReadOnly,
@@ -659,29 +894,24 @@ namespace Gaia
 
         //create blas for every sub meshes and also record the gpu addresses
         std::vector<MeshGPUBufferAddress> gpuAddresses;
-        uint32_t offset = 0;
-        uint32_t index_offset = 0;
-        for (auto& subMesh_ : scene.getMeshes())
+        for (const SubMesh& subMesh : subMeshes)
         {
-            SubMesh& subMesh = subMesh_.second;
             AccelStructDesc blasDesc{
                 .type = AccelStructType_BLAS,
                 .geometryType = AccelStructGeomType_Triangles,
                 .geometryFlags = AccelStructGeometryFlagBits_Opaque,
-                .vertexFormat = Format_RGB_F32,
-                .vertexBufferAddress = renderContext_->gpuAddress(vertexBuffer, sizeof(LoadMesh::VertexAttributes) * offset),
-                .vertexStride = sizeof(LoadMesh::VertexAttributes),
-                .numVertices = static_cast<uint32_t>(subMesh.Vertices.size()),
+                .vertexFormat = vertexFormat == VertexFormat_CompactHalfPosition ? Format_RGBA_F16 : Format_RGB_F32,
+                .vertexBufferAddress = renderContext_->gpuAddress(vertexBuffer, vertexStride * subMesh.vertexOffset),
+                .vertexStride = vertexStride,
+                .numVertices = subMesh.vertexCount,
                 .indexFormat = IndexFormat_U32,
-                .indexBufferAddress = renderContext_->gpuAddress(indexBufferRT, sizeof(uint32_t) * index_offset),
+                .indexBufferAddress = renderContext_->gpuAddress(indexBufferRT, sizeof(uint32_t) * subMesh.indexOffset),
                 .transformBufferAddress = renderContext_->gpuAddress(transformBufferBLAS),
-                .buildrange = {.primitiveCount = static_cast<uint32_t>(subMesh.indices.size()/3) },
+                .buildrange = {.primitiveCount = subMesh.indexCount / 3 },
                 .buildFlags = AccelStructBuildFlagBits_PreferFastTrace
             };
             gpuAddresses.push_back({.vertexBufferAddress = blasDesc.vertexBufferAddress, .indexBufferAddress=blasDesc.indexBufferAddress});
             BLAS.push_back(renderContext_->createAccelerationStructure(blasDesc));
-            offset += subMesh.Vertices.size();
-            index_offset += subMesh.indices.size();
         }
 
         //copy the gpuAddresses buffer
@@ -712,11 +942,10 @@ namespace Gaia
         }
         std::vector<AccelStructInstance> instances;
         int index = 0;
-        for (auto& subMesh_ : scene.getMeshes())
+        for (const SubMesh& subMesh : subMeshes)
         {
-            SubMesh& subMesh = subMesh_.second;
             instances.push_back({
-                .transform = transformMatrices[subMesh.meshIndices[0]],
+                .transform = transformMatrices[subMesh.meshIndex],
                 .flags = AccelStructInstanceFlagBits_TriangleFacingCullDisable,
                 .accelerationStructureReference = renderContext_->gpuAddress(BLAS[index++]),
                 });
@@ -753,24 +982,22 @@ namespace Gaia
     {
         if (Input::IsButtonPressed(0) || Input::IsButtonPressed(1) || Input::IsButtonPressed(2))
             Application::frameNum = 0;
+        //reads the feedback of the g buffer pass and swaps the streamed textures, see TextureStreamer::update
+        textureStreamer_->update(meshDescriptorSet, 1);
         if (scene.isTransformUpdated())
         {
-            GAIA_CORE_INFO("transform updated");
             scene.updateSceneBounds();
-            BufferDesc transformBufferDesc{
-               .usage_type = BufferUsageBits_Storage,
-               .storage_type = StorageType_HostVisible,
-               .size = scene.getGlobalTransforms().size() * sizeof(glm::mat4),
-            };
-            Holder<BufferHandle> transformBufferStaging = renderContext_->createBuffer(transformBufferDesc);
-
-            //copy the staging buffers to device visible buffers
+            FrustumCulling::updateBounds(scene.getMeshes(), scene.getGlobalTransforms(), subMeshBounds_);
+            //only the changed transforms go through the staging ring, the next submit flushes them without an extra wait
+            std::vector<BufferRange> transformRanges;
+            for (const TransformRange& range : scene.takeUpdatedTransforms())
             {
-                ICommandBuffer& cmdBuffer = renderContext_->acquireCommandBuffer();
-                cmdBuffer.copyBuffer(transformBufferStaging, scene.getGlobalTransforms().data(), transformBufferDesc.size);
-                cmdBuffer.cmdCopyBufferToBuffer(transformBufferStaging, transformsBuffer);
-                renderContext_->submit(cmdBuffer);
+                transformRanges.push_back(BufferRange{
+                    .offset = range.first * sizeof(glm::mat4),
+                    .size = range.count * sizeof(glm::mat4),
+                    });
             }
+            renderContext_->upload(transformsBuffer, scene.getGlobalTransforms().data(), transformRanges);
 
             ////update tlas
             //// Use transform matrices from the glTF nodes and convert to
@@ -784,11 +1011,10 @@ namespace Gaia
 
             //std::vector<AccelStructInstance> instances;
             //int index = 0;
-            //for (auto& subMesh_ : scene.getMeshes())
+            //for (const SubMesh& subMesh : scene.getMeshes())
             //{
-            //    SubMesh& subMesh = subMesh_.second;
             //    instances.push_back({
-            //        .transform = transformMatrices[subMesh.meshIndices[0]],
+            //        .transform = transformMatrices[subMesh.meshIndex],
             //        .flags = AccelStructInstanceFlagBits_TriangleFacingCullDisable,
             //        .accelerationStructureReference = renderContext_->gpuAddress(BLAS[index++]),
             //        });
@@ -829,17 +1055,10 @@ namespace Gaia
         mvpData.camPos = camera.GetCameraPosition();
         mvpData.frameNumber = Application::frameNum;
 
-        {
-            ICommandBuffer& cmdBuffer = renderContext_->acquireCommandBuffer();
-            cmdBuffer.copyBuffer(mvpBufferStaging, &mvpData, sizeof(MVPMatrices));
-            cmdBuffer.copyBuffer(lightParameterBufferStaging, &scene.lightParameter.color, sizeof(LightParameters));
-            cmdBuffer.copyBuffer(lightMatricesBufferStaging, &shadows_->lightData_[0], sizeof(LightData) * MAX_SHADOW_CASCADES);
-
-            cmdBuffer.cmdCopyBufferToBuffer(mvpBufferStaging, mvpBuffer);
-            cmdBuffer.cmdCopyBufferToBuffer(lightParameterBufferStaging, lightParameterBuffer);
-            cmdBuffer.cmdCopyBufferToBuffer(lightMatricesBufferStaging, lightMatricesBuffer);
-            renderContext_->submit(cmdBuffer);
-        }
+        //staged in the ring and copied ahead of the next submit, after the frames in flight are done reading the uniforms
+        renderContext_->upload(mvpBuffer, &mvpData, sizeof(MVPMatrices));
+        renderContext_->upload(lightParameterBuffer, &scene.lightParameter.color, sizeof(LightParameters));
+        renderContext_->upload(lightMatricesBuffer, &shadows_->lightData_[0], sizeof(LightData) * MAX_SHADOW_CASCADES);
 
     }
 
@@ -853,6 +1072,17 @@ namespace Gaia
         {
             onFirstFrame(scene);
         }
+        if (gpuCulling_)
+        {
+            std::vector<CullingView> cullingViews = { CullingView{
+                .view = mvpData.view,
+                .projection = mvpData.projection,
+                .viewportHeight = (float)renderContext_->getWindowSize().second,
+                } };
+            for (uint32_t k = 0; k < shadows_->getNumCascades(); k++)
+                cullingViews.push_back(shadows_->getCullingView(k));
+            gpuCulling_->cull(cullingViews);
+        }
         shadows_->render(scene);
         ddgi_->render(scene);
         auto windowSize = renderContext_->getWindowSize();
@@ -893,7 +1123,6 @@ namespace Gaia
             };
 
             cmdBuffer.cmdBeginRendering({gBufferAlbedo, gBufferMetallicRoughness, gBufferNormal}, depthAttachment, &clearVal);
-            cmdBuffer.cmdBindGraphicsPipeline(renderPipelineGBuffer);
             std::pair<uint32_t, uint32_t> windowDimensions = renderContext_->getWindowSize();
             cmdBuffer.cmdSetViewport(Viewport{
                 .width = (float)windowDimensions.first,
@@ -904,16 +1133,64 @@ namespace Gaia
                 .width = windowDimensions.first,
                 .height = windowDimensions.second,
                 });
-            cmdBuffer.cmdBindGraphicsDescriptorSets(0, renderPipelineGBuffer, {
-                mvpMatrixDescriptorSetLayout,
-                meshDescriptorSet,
-                });
-            //draw the batched mesh
+            cmdBuffer.cmdBindVertexBuffer(0, vertexBuffer, 0);
+            cmdBuffer.cmdBindIndexBuffer(indexBuffer, IndexFormat_U32, 0);
+            if (gpuCulling_)
             {
-                cmdBuffer.cmdBindVertexBuffer(0, vertexBuffer, 0);
-                cmdBuffer.cmdBindIndexBuffer(indexBuffer, IndexFormat_U32, 0);
-
-                cmdBuffer.cmdDrawIndexed(numIndicesPerMesh, 1, 0, 0, 0);
+                //every variant draws the commands the culling shader wrote for it, opaque ones first so alpha tested
+                //geometry is depth tested against them
+                for (bool alphaTested : { false, true })
+                {
+                    for (uint32_t pipeline = 0; pipeline < gBufferPipelines_.size(); pipeline++)
+                    {
+                        if (((gBufferPipelineFeatures_[pipeline] & MaterialFeatures_AlphaTest) != 0) != alphaTested)
+                            continue;
+                        cmdBuffer.cmdBindGraphicsPipeline(gBufferPipelines_[pipeline]);
+                        cmdBuffer.cmdBindGraphicsDescriptorSets(0, gBufferPipelines_[pipeline], {
+                            mvpMatrixDescriptorSetLayout,
+                            meshDescriptorSet,
+                            });
+                        gpuCulling_->draw(cmdBuffer, 0, pipeline);
+                    }
+                }
+            }
+            else
+            {
+                //cpu culling, one draw per run of visible sub meshes that share the full resolution range and the pipeline variant
+                FrustumCulling::cull(subMeshBounds_, FrustumCulling::extractFrustum(mvpData.projection * mvpData.view), cameraVisibility_);
+                LodSelection::buildDraws(scene.getMeshes(), scene.getGlobalTransforms(), cameraVisibility_, mvpData.view, mvpData.projection,
+                    (float)windowDimensions.second, lodPixelError, cameraLods_, cameraDraws_, subMeshPipelines_);
+                //every variant is bound once, opaque ones first so alpha tested geometry is depth tested against them
+                std::stable_sort(cameraDraws_.begin(), cameraDraws_.end(), [this](const DrawRange& a, const DrawRange& b) {
+                    const bool alphaTestA = gBufferPipelineFeatures_[a.pipeline] & MaterialFeatures_AlphaTest;
+                    const bool alphaTestB = gBufferPipelineFeatures_[b.pipeline] & MaterialFeatures_AlphaTest;
+                    return alphaTestA != alphaTestB ? alphaTestB : a.pipeline < b.pipeline;
+                    });
+                //the slice of this frame in flight was last read MAX_FRAMES_IN_FLIGHT frames ago, the context waited for that frame
+                const size_t sliceOffset = renderContext_->getFrameInFlight() * maxCameraDraws_ * sizeof(DrawIndexedIndirectCommand);
+                DrawIndexedIndirectCommand* commands = reinterpret_cast<DrawIndexedIndirectCommand*>(renderContext_->getMappedPtr(cameraIndirectBuffer_) + sliceOffset);
+                for (size_t i = 0; i < cameraDraws_.size(); i++)
+                {
+                    commands[i] = DrawIndexedIndirectCommand{ .indexCount = cameraDraws_[i].indexCount, .firstIndex = cameraDraws_[i].firstIndex };
+                }
+                if (!cameraDraws_.empty())
+                    renderContext_->flushMappedMemory(cameraIndirectBuffer_, sliceOffset, cameraDraws_.size() * sizeof(DrawIndexedIndirectCommand));
+
+                //the draws of a variant are contiguous after the sort and go out as one indirect draw
+                for (size_t first = 0; first < cameraDraws_.size();)
+                {
+                    const uint32_t pipeline = cameraDraws_[first].pipeline;
+                    size_t last = first + 1;
+                    while (last < cameraDraws_.size() && cameraDraws_[last].pipeline == pipeline)
+                        last++;
+                    cmdBuffer.cmdBindGraphicsPipeline(gBufferPipelines_[pipeline]);
+                    cmdBuffer.cmdBindGraphicsDescriptorSets(0, gBufferPipelines_[pipeline], {
+                        mvpMatrixDescriptorSetLayout,
+                        meshDescriptorSet,
+                        });
+                    cmdBuffer.cmdDrawIndexedIndirect(cameraIndirectBuffer_, sliceOffset + first * sizeof(DrawIndexedIndirectCommand), static_cast<uint32_t>(last - first));
+                    first = last;
+                }
             }
             cmdBuffer.cmdEndRendering();
             renderContext_->submit(cmdBuffer);
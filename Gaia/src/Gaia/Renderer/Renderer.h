@@ -1,12 +1,19 @@
 #pragma once
 #include "Gaia/Renderer/GaiaRenderer.h"
+#include "Gaia/Renderer/FrustumCulling.h"
+#include "Gaia/Renderer/LodSelection.h"
+#include "Gaia/Renderer/TextureRegistry.h"
+#include "Gaia/Renderer/TextureStreamer.h"
+#include "Gaia/Renderer/TexturePacking.h"
 #include "glm/glm.hpp"
 
 namespace Gaia
 {
 	class Scene;
+	enum VertexFormat : uint8_t;
 	class Shadows;
 	class DDGI;
+	class GpuCulling;
 	struct MVPMatrices
 	{
 		glm::mat4 view = glm::mat4(1.0);
@@ -27,8 +34,18 @@ namespace Gaia
 	{
 		friend class Shadows;
 		friend class DDGI;
+		friend class GpuCulling;
 	public:
 		static VertexInput vertexInput;
+		static VertexFormat vertexFormat; //layout of the vertex buffer, falls back to VertexFormat_Full if the scene does not fit the compact one
+		static float lodPixelError; //screen space error in pixels a level of detail may introduce, 0 always draws the full resolution meshes
+		static TextureStreamingDesc textureStreaming; //mip streaming of the glTF textures, read when the renderer is created
+		static TexturePackingDesc texturePacking; //packing of same size glTF textures into arrays, read when the renderer is created
+		static bool gpuCulling; //cull and select the levels of detail in a compute shader (see GpuCulling::create) instead of on the cpu where the device allows it
+
+		/// returns the variant of a shader compiled for the active vertex format, readsVertexMemory is set for shaders that
+		/// load vertices through buffer addresses and therefore also depend on the position type
+		static std::string getVertexShaderPath(const std::string& path, bool readsVertexMemory = false);
 
 	public:
 		static std::shared_ptr<Renderer> create(void* window, Scene& scene);
@@ -55,8 +72,10 @@ namespace Gaia
 		Holder<TextureHandle> renderTarget_;
 		Holder<TextureHandle> rtOutputTexture; //storage texture that stores the ray-tracing output
 
-		//this renders into GBuffer textures
-		Holder<RenderPipelineHandle> renderPipelineGBuffer;
+		//these render into GBuffer textures, one pipeline per material feature set the scene uses
+		std::vector<Holder<RenderPipelineHandle>> gBufferPipelines_;
+		std::vector<uint32_t> gBufferPipelineFeatures_; //MaterialFeatures of every g buffer pipeline
+		std::vector<uint8_t> subMeshPipelines_; //g buffer pipeline of every sub mesh
 		//deferred pipeline that shades the pixels
 		Holder<RenderPipelineHandle> renderPipelineDeferred;
 		//Gi pass render pipeline
@@ -80,16 +99,17 @@ namespace Gaia
 		Holder<ShaderModuleHandle> shadowMissShaderModule;
 
 		Holder<BufferHandle> mvpBuffer;
-		Holder<BufferHandle> mvpBufferStaging;
 		Holder<BufferHandle> transformsBuffer;
 		Holder<BufferHandle> lightParameterBuffer;
-		Holder<BufferHandle> lightParameterBufferStaging;
 		Holder<BufferHandle> lightMatricesBuffer;
-		Holder<BufferHandle> lightMatricesBufferStaging;
 
 		Holder<BufferHandle> vertexBuffer;
 		Holder<BufferHandle> indexBuffer;
 		Holder<BufferHandle> indexBufferRT; //need a seperate index buffer with out the offset applied for ray tracing
+		//meshlets of the full resolution sub meshes, the vertex lists index vertexBuffer
+		Holder<BufferHandle> meshletBuffer;
+		Holder<BufferHandle> meshletVertexBuffer;
+		Holder<BufferHandle> meshletTriangleBuffer;
 
 		//gbuffer data.
 		Holder<TextureHandle> depthAttachment;
@@ -99,6 +119,10 @@ namespace Gaia
 		Holder<TextureHandle> giTexture;
 
 		std::vector<Holder<TextureHandle>> glTfTextures;
+		TextureRegistry textureRegistry;
+		std::unique_ptr<TextureStreamer> textureStreamer_; //owns the mip levels of glTfTextures
+		std::vector<Holder<TextureHandle>> textureArrays_; //packed glTF textures, one layer per image (see TexturePacking.h)
+		std::vector<int> textureSlots_; //material texture index of every texture registry slot
 
 		Holder<BufferHandle> materialsBuffer;
 
@@ -116,11 +140,20 @@ namespace Gaia
 		Holder<DescriptorSetLayoutHandle> giOutputDescSetLayout;
 
 		MVPMatrices mvpData = {};
+		std::vector<uint8_t> cameraLods_; //selected level of every sub mesh for the g buffer pass
+		std::vector<DrawRange> cameraDraws_;
+		SubMeshBounds subMeshBounds_; //world space boxes of the sub meshes, refreshed when transforms change
+		std::vector<uint8_t> cameraVisibility_;
+		Holder<BufferHandle> cameraIndirectBuffer_; //compacted draws of the g buffer pass, one slice of maxCameraDraws_ per frame in flight
+		size_t maxCameraDraws_ = 1; //at most one per sub mesh
 
 		//other components
 		std::unique_ptr<Shadows> shadows_;
 		std::unique_ptr<DDGI> ddgi_;
+		std::unique_ptr<GpuCulling> gpuCulling_; //null when the draws are culled on the cpu
 	private:
+		void setupVertexInput(Scene& scene);
 		void createGpuMeshTexturesAndBuffers(Scene& scene);
+		void createMeshletBuffers(Scene& scene);
 	};
 }
\ No newline at end of file
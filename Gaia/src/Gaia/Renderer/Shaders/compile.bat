@@ -1,26 +1,43 @@
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 deferred/g_buffer.vert -o g_buffer.vert.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 deferred/g_buffer.frag -o g_buffer.frag.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 deferred/global_illumination.vert -o global_illumination.vert.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 deferred/global_illumination.frag -o global_illumination.frag.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 deferred/deferred.vert -o deferred.vert.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 deferred/deferred.frag -o deferred.frag.spv
+set failed=0
+rem glslc of the installed Vulkan SDK, its installer sets VULKAN_SDK
+if "%VULKAN_SDK%"=="" (
+	echo VULKAN_SDK is not set, install the Vulkan SDK to compile the shaders
+	exit /b 1
+)
+set glslc="%VULKAN_SDK%\Bin\glslc"
+%glslc% --target-spv=spv1.6 deferred/g_buffer.vert -o g_buffer.vert.spv || set failed=1
+%glslc% --target-spv=spv1.6 -DCOMPACT_VERTEX deferred/g_buffer.vert -o g_buffer_compact.vert.spv || set failed=1
+%glslc% --target-spv=spv1.6 deferred/g_buffer.frag -o g_buffer.frag.spv || set failed=1
+%glslc% --target-spv=spv1.6 deferred/global_illumination.vert -o global_illumination.vert.spv || set failed=1
+%glslc% --target-spv=spv1.6 deferred/global_illumination.frag -o global_illumination.frag.spv || set failed=1
+%glslc% --target-spv=spv1.6 deferred/deferred.vert -o deferred.vert.spv || set failed=1
+%glslc% --target-spv=spv1.6 deferred/deferred.frag -o deferred.frag.spv || set failed=1
 
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 shadow.vert -o vert_shadow.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 shadow.frag -o frag_shadow.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 rayGen.rgen -o rayGen.rgen.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 rayMiss.rmiss -o rayMiss.rmiss.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 shadowMiss.rmiss -o shadowMiss.rmiss.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 closestHit.rchit -o closestHit.rchit.spv
+%glslc% --target-spv=spv1.6 shadow.vert -o vert_shadow.spv || set failed=1
+%glslc% --target-spv=spv1.6 -DCOMPACT_VERTEX shadow.vert -o vert_shadow_compact.spv || set failed=1
+%glslc% --target-spv=spv1.6 shadow.frag -o frag_shadow.spv || set failed=1
+%glslc% --target-spv=spv1.6 rayGen.rgen -o rayGen.rgen.spv || set failed=1
+%glslc% --target-spv=spv1.6 rayMiss.rmiss -o rayMiss.rmiss.spv || set failed=1
+%glslc% --target-spv=spv1.6 shadowMiss.rmiss -o shadowMiss.rmiss.spv || set failed=1
+%glslc% --target-spv=spv1.6 closestHit.rchit -o closestHit.rchit.spv || set failed=1
+%glslc% --target-spv=spv1.6 -DCOMPACT_VERTEX closestHit.rchit -o closestHit_compact.rchit.spv || set failed=1
+%glslc% --target-spv=spv1.6 -DCOMPACT_VERTEX -DCOMPACT_VERTEX_HALF_POSITION closestHit.rchit -o closestHit_compact_half.rchit.spv || set failed=1
 
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_rayGen.rgen -o gi_rayGen.rgen.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_rayMiss.rmiss -o gi_rayMiss.rmiss.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_rayMissShadow.rmiss -o gi_rayMissShadow.rmiss.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_closestHit.rchit -o gi_closestHit.rchit.spv
+%glslc% --target-spv=spv1.6 ddgi/gi_rayGen.rgen -o gi_rayGen.rgen.spv || set failed=1
+%glslc% --target-spv=spv1.6 ddgi/gi_rayMiss.rmiss -o gi_rayMiss.rmiss.spv || set failed=1
+%glslc% --target-spv=spv1.6 ddgi/gi_rayMissShadow.rmiss -o gi_rayMissShadow.rmiss.spv || set failed=1
+%glslc% --target-spv=spv1.6 ddgi/gi_closestHit.rchit -o gi_closestHit.rchit.spv || set failed=1
+%glslc% --target-spv=spv1.6 -DCOMPACT_VERTEX ddgi/gi_closestHit.rchit -o gi_closestHit_compact.rchit.spv || set failed=1
+%glslc% --target-spv=spv1.6 -DCOMPACT_VERTEX -DCOMPACT_VERTEX_HALF_POSITION ddgi/gi_closestHit.rchit -o gi_closestHit_compact_half.rchit.spv || set failed=1
 
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_depth_probe_update.comp -o gi_depth_probe_update.comp.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_irradiance_probe_update.comp -o gi_irradiance_probe_update.comp.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_irradiance_border_update.comp -o gi_irradiance_border_update.comp.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc --target-spv=spv1.6 ddgi/gi_depth_border_update.comp -o gi_depth_border_update.comp.spv
+%glslc% --target-spv=spv1.6 ddgi/gi_depth_probe_update.comp -o gi_depth_probe_update.comp.spv || set failed=1
+%glslc% --target-spv=spv1.6 ddgi/gi_irradiance_probe_update.comp -o gi_irradiance_probe_update.comp.spv || set failed=1
+%glslc% --target-spv=spv1.6 ddgi/gi_irradiance_border_update.comp -o gi_irradiance_border_update.comp.spv || set failed=1
+%glslc% --target-spv=spv1.6 ddgi/gi_depth_border_update.comp -o gi_depth_border_update.comp.spv || set failed=1
 
+%glslc% --target-spv=spv1.6 culling/cull_draws.comp -o cull_draws.comp.spv || set failed=1
 
-pause
\ No newline at end of file
+
+rem the engine build runs this before compiling with nopause, a shader that does not compile fails the build
+if not "%1"=="nopause" pause
+exit /b %failed%
\ No newline at end of file
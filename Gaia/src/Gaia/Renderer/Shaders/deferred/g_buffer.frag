@@ -1,12 +1,13 @@
 #version 450
 #extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_GOOGLE_include_directive : require
 
 //shader input
 flat layout (location = 0) in uint materialId;
 layout(location = 1) in vec2 texCoord;
 layout(location = 2) in vec4 vertexPosition;
 layout(location = 3) in vec3 vertexNormal;
-layout(location = 4) in vec3 vertexTangent;
+layout(location = 4) in vec4 vertexTangent;
 
 #define MAX_CASCADES 8
 
@@ -20,8 +21,19 @@ struct Material
 	int baseColorTexture;
 	int metallicRoughnessTexture;
 	int normalTexture;
+
+	uint features;
+	float alphaCutoff;
 };
 
+//MaterialFeatures (see Material.h) of the pipeline, every feature set the scene uses is a pipeline of its own
+layout(constant_id = 0) const uint MATERIAL_FEATURES = 0;
+const bool ALPHA_TEST = (MATERIAL_FEATURES & 1u) != 0;
+const bool DOUBLE_SIDED = (MATERIAL_FEATURES & 2u) != 0;
+const bool BASE_COLOR_TEXTURE = (MATERIAL_FEATURES & 4u) != 0;
+const bool METALLIC_ROUGHNESS_TEXTURE = (MATERIAL_FEATURES & 8u) != 0;
+const bool NORMAL_TEXTURE = (MATERIAL_FEATURES & 16u) != 0;
+
 layout(set = 0, binding = 0) uniform Camera
 {
     mat4 view;
@@ -42,7 +54,26 @@ layout(set = 1, binding = 0) readonly buffer materialLayout
 	Material materials[];
 } materialBuffer;
 
-layout(set = 1, binding = 1) uniform sampler2D textures[];
+#define MATERIAL_SET 1
+#include "../material_textures.glsl"
+
+//finest level each texture is sampled at, relative to its resident levels (see TextureStreamer.h)
+layout(set = 1, binding = 2) buffer TextureFeedback
+{
+	int requestedMip[];
+} textureFeedback;
+
+void requestMip(int textureIndex)
+{
+	//packed textures are always fully resident. The index comes from the flat material id, so the whole quad returns together
+	if (textureIndex == -1 || isPackedTexture(textureIndex))
+		return;
+	//the level comes from implicit derivatives, every pixel of the quad has to query it before they branch apart
+	int mip = int(floor(textureQueryLod(textures[nonuniformEXT(textureIndex)], texCoord).x));
+	//one pixel in every 4x4 block is enough to find the finest level
+	if (all(equal(ivec2(gl_FragCoord.xy) & 3, ivec2(0))))
+		atomicMin(textureFeedback.requestedMip[textureIndex], mip);
+}
 
 
 //output write
@@ -53,16 +84,45 @@ layout (location = 2) out vec4 outNormal;
 void main() 
 {
 	Material mat = materialBuffer.materials[materialId];
-	vec4 albedo = mat.baseColorTexture!=-1? texture(textures[mat.baseColorTexture], texCoord): vec4(mat.baseColorFactor);
-	if (albedo.a < 0.5)
+	vec4 albedo = vec4(mat.baseColorFactor);
+	if (BASE_COLOR_TEXTURE)
 	{
-		discard;
+		requestMip(mat.baseColorTexture);
+		albedo = sampleMaterialTexture(mat.baseColorTexture, texCoord);
+	}
+	vec4 matRoughness = vec4(1.0);
+	if (METALLIC_ROUGHNESS_TEXTURE)
+	{
+		requestMip(mat.metallicRoughnessTexture);
+		matRoughness = sampleMaterialTexture(mat.metallicRoughnessTexture, texCoord);
 	}
-	vec4 matRoughness = mat.metallicRoughnessTexture!=-1?texture(textures[mat.metallicRoughnessTexture], texCoord):vec4(1.0);
 	float roughness = matRoughness.g * mat.roughnessFactor;
 	float metallic = matRoughness.b * mat.metallicFactor;
 
+	vec3 normal = normalize(vertexNormal);
+	if (DOUBLE_SIDED && !gl_FrontFacing)
+	{
+		normal = -normal;
+	}
+	if (NORMAL_TEXTURE)
+	{
+		vec3 tangent = normalize(vertexTangent.xyz - normal * dot(normal, vertexTangent.xyz));
+		//mirrored uvs flip the bitangent, not the tangent
+		vec3 bitangent = cross(normal, tangent) * (vertexTangent.w < 0.0 ? -1.0 : 1.0);
+		requestMip(mat.normalTexture);
+		vec3 textureNormal = sampleMaterialTexture(mat.normalTexture, texCoord).rgb * 2.0 - vec3(1.0);
+		textureNormal.z = sqrt(max(1.0 - dot(textureNormal.xy, textureNormal.xy), 0.0));
+		textureNormal *= vec3(mat.normalStrength, mat.normalStrength, 1.0);
+		normal = normalize(mat3(tangent, bitangent, normal) * textureNormal);
+	}
+	//only alpha tested pipelines contain a discard, the others keep early depth testing.
+	//It comes after every fetch, the quad is no longer complete for implicit derivatives once a pixel is discarded
+	if (ALPHA_TEST && albedo.a < mat.alphaCutoff)
+	{
+		discard;
+	}
+
 	outAlbedo = vec4(albedo.rgb,1.0);
 	outMetallicRoughness = vec4(metallic, roughness, 0.0,1.0);
-	outNormal = vec4(vertexNormal,1.0);
+	outNormal = vec4(normal,1.0);
 }
\ No newline at end of file
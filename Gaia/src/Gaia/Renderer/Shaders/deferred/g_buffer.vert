@@ -1,12 +1,22 @@
 
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
+#ifdef COMPACT_VERTEX
+#include "../vertex_compact.glsl"
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 tex_coord;
+layout(location = 2) in vec2 normal_oct;
+layout(location = 3) in vec2 tangent_oct;
+layout(location = 4) in uint packed_ids;
+#else
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec2 tex_coord;
 layout(location = 2) in vec3 normal;
-layout(location = 3) in vec3 tangent;
+layout(location = 3) in vec4 tangent;
 layout(location = 4) in uint material_id;
 layout(location = 5) in uint mesh_index;
+#endif
 
 layout(set = 0, binding = 0) uniform Camera
 {
@@ -25,17 +35,23 @@ flat layout(location = 0) out uint materialId;
 layout(location = 1) out vec2 texCoord;
 layout(location = 2) out vec4 vertexPosition;
 layout(location = 3) out vec3 vertexNormal;
-layout(location = 4) out vec3 vertexTangent;
+layout(location = 4) out vec4 vertexTangent; //w is the handedness of the tangent frame
 
 
 
 void main()
 {
+#ifdef COMPACT_VERTEX
+	vec3 normal = octDecode(normal_oct);
+	vec4 tangent = vec4(octDecode(tangent_oct), unpackTangentSign(packed_ids));
+	uint material_id = unpackMaterialId(packed_ids);
+	uint mesh_index = unpackMeshId(packed_ids);
+#endif
 	//output the position of each vertex
 	materialId = material_id;
 	texCoord = tex_coord;
 	vertexNormal = normalize(transforms.model[mesh_index] * vec4(normal,0.0)).xyz; //in ws
-	vertexTangent = normalize(transforms.model[mesh_index] * vec4(tangent,0.0)).xyz; //in ws
+	vertexTangent = vec4(normalize(transforms.model[mesh_index] * vec4(tangent.xyz,0.0)).xyz, tangent.w); //in ws
 	vertexPosition = transforms.model[mesh_index] * position; //in ws
 	gl_Position = cameraBuffer.projection * cameraBuffer.view * vertexPosition;
 }
\ No newline at end of file
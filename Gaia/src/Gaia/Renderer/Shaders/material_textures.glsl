@@ -0,0 +1,27 @@
+//material textures of the mesh descriptor set, see TexturePacking.h. MATERIAL_SET has to be defined before the include.
+//A packed texture index holds the array in the low 16 bits and the layer above it, every other index is a slot of textures
+#ifndef MATERIAL_TEXTURES_GLSL
+#define MATERIAL_TEXTURES_GLSL
+
+layout(set = MATERIAL_SET, binding = 1) uniform sampler2D textures[];
+layout(set = MATERIAL_SET, binding = 3) uniform sampler2DArray textureArrays[];
+
+const int TEXTURE_ARRAY_BIT = 1 << 30;
+
+bool isPackedTexture(int textureIndex)
+{
+	return textureIndex >= 0 && (textureIndex & TEXTURE_ARRAY_BIT) != 0;
+}
+
+vec4 sampleMaterialTexture(int textureIndex, vec2 uv)
+{
+	if (isPackedTexture(textureIndex))
+	{
+		int array = textureIndex & 0xFFFF;
+		int layer = (textureIndex >> 16) & 0x3FFF;
+		return texture(textureArrays[nonuniformEXT(array)], vec3(uv, float(layer)));
+	}
+	return texture(textures[nonuniformEXT(textureIndex)], uv);
+}
+
+#endif
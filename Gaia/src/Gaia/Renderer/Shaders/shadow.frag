@@ -1,5 +1,6 @@
 #version 450
 #extension GL_EXT_nonuniform_qualifier : enable
+#extension GL_GOOGLE_include_directive : require
 
 flat layout (location = 0) in uint materialId;
 layout(location = 1) in vec2 texCoord;
@@ -14,6 +15,9 @@ struct Material
 	int baseColorTexture;
 	int metallicRoughnessTexture;
 	int normalTexture;
+
+	uint features;
+	float alphaCutoff;
 };
 
 layout(set = 1, binding = 0) readonly buffer materialLayout
@@ -21,14 +25,20 @@ layout(set = 1, binding = 0) readonly buffer materialLayout
 	Material materials[];
 } materialBuffer;
 
-layout(set = 1, binding = 1) uniform sampler2D textures[];
+#define MATERIAL_SET 1
+#include "material_textures.glsl"
 
 void main()
 {
 	Material mat = materialBuffer.materials[materialId];
 
-	vec4 albedo = mat.baseColorTexture!=-1? texture(textures[mat.baseColorTexture], texCoord): vec4(mat.baseColorFactor);
-	if (albedo.a < 0.5)
+	//MaterialFeatures_AlphaTest, opaque materials cast full shadows like they fill the g buffer
+	if ((mat.features & 1u) == 0)
+	{
+		return;
+	}
+	vec4 albedo = mat.baseColorTexture!=-1? sampleMaterialTexture(mat.baseColorTexture, texCoord): vec4(mat.baseColorFactor);
+	if (albedo.a < mat.alphaCutoff)
 	{
 		discard;
 	}
@@ -1,12 +1,22 @@
 
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
+#ifdef COMPACT_VERTEX
+#include "vertex_compact.glsl"
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 tex_coord;
+layout(location = 2) in vec2 normal_oct;
+layout(location = 3) in vec2 tangent_oct;
+layout(location = 4) in uint packed_ids;
+#else
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec2 tex_coord;
 layout(location = 2) in vec3 normal;
-layout(location = 3) in vec3 tangent;
+layout(location = 3) in vec4 tangent;
 layout(location = 4) in uint material_id;
 layout(location = 5) in uint mesh_index;
+#endif
 
 #define MAX_CASCADES 8
 flat layout (location = 0) out uint materialId;
@@ -35,6 +45,10 @@ layout(set = 2, binding = 0) uniform LightData
 
 void main()
 {
+#ifdef COMPACT_VERTEX
+	uint material_id = unpackMaterialId(packed_ids);
+	uint mesh_index = unpackMeshId(packed_ids);
+#endif
 	texCoord = tex_coord;
 	materialId = material_id;
 	//output the position of each vertex
@@ -0,0 +1,36 @@
+//decoding of the compact vertex layout, see VertexFormat.h. Shaders that support it are compiled a second time with
+//-DCOMPACT_VERTEX (and -DCOMPACT_VERTEX_HALF_POSITION when they read the vertex memory themselves)
+#ifndef VERTEX_COMPACT_GLSL
+#define VERTEX_COMPACT_GLSL
+
+const uint MATERIAL_ID_BITS = 12;
+const uint NO_MATERIAL = (1u << MATERIAL_ID_BITS) - 1u;
+const uint TANGENT_SIGN_BIT = 1u << 31;
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+uint unpackMaterialId(uint ids)
+{
+	uint material = ids & NO_MATERIAL;
+	return material == NO_MATERIAL ? 0xFFFFFFFFu : material;
+}
+
+uint unpackMeshId(uint ids)
+{
+	return (ids & ~TANGENT_SIGN_BIT) >> MATERIAL_ID_BITS;
+}
+
+//w of the tangent, -1 where the uvs are mirrored
+float unpackTangentSign(uint ids)
+{
+	return (ids & TANGENT_SIGN_BIT) != 0u ? -1.0 : 1.0;
+}
+
+#endif
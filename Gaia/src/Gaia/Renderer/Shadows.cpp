@@ -42,8 +42,14 @@ namespace Gaia {
 
 		lightDataBuffer_ = context->createBuffer(lightDataBuffeDesc);
 
-		lightDataBuffeDesc.storage_type = StorageType_HostVisible;
-		lightDataBufferStaging_ = context->createBuffer(lightDataBuffeDesc);
+		//every cascade has its own range of indirect commands, at most one per sub mesh, and every frame in flight its own set of ranges
+		maxDrawsPerCascade_ = std::max<size_t>(scene.getMeshes().size(), 1);
+		BufferDesc indirectBufferDesc{
+			.usage_type = BufferUsageBits_Indirect,
+			.storage_type = StorageType_HostVisible,
+			.size = MAX_FRAMES_IN_FLIGHT * shadowDesc_.numCascades * maxDrawsPerCascade_ * sizeof(DrawIndexedIndirectCommand),
+		};
+		cascadeIndirectBuffer_ = context->createBuffer(indirectBufferDesc);
 
 		std::vector<DescriptorSetLayoutDesc> dslDesc = {
 			DescriptorSetLayoutDesc{
@@ -56,7 +62,8 @@ namespace Gaia {
 		};
 		shadowDescSetLayout_ = context->createDescriptorSetLayout(dslDesc);
 
-		ShaderModuleDesc vertexShaderDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/vert_shadow.spv", Stage_Vert);
+		std::string vertexShaderPath = Renderer::getVertexShaderPath("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/vert_shadow.spv");
+		ShaderModuleDesc vertexShaderDesc(vertexShaderPath.c_str(), Stage_Vert);
 		vertexShader_ = context->createShaderModule(vertexShaderDesc);
 
 		ShaderModuleDesc frageShaderDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/frag_shadow.spv", Stage_Frag);
@@ -108,14 +115,14 @@ namespace Gaia {
 
 		for (int k = 0; k < shadowDesc_.numCascades; k++)
 		{
+			//every cascade reuses lightDataBuffer_, the staging batch of the next cascade waits until this one is drawn
+			context->upload(lightDataBuffer_, &lightData_[k], sizeof(LightData));
 			ICommandBuffer& cmdBuffer = context->acquireCommandBuffer();
 			ClearValue clearVal = {
 			 .colorValue = {0.3,0.3,0.3,1.0},
 			 .depthClearValue = 1.0,
 			};
 			cmdBuffer.cmdBindGraphicsPipeline(shadowRenderPipeline_);
-			cmdBuffer.copyBuffer(lightDataBufferStaging_, &lightData_[k], sizeof(LightData));
-			cmdBuffer.cmdCopyBufferToBuffer(lightDataBufferStaging_, lightDataBuffer_);
 
 			cmdBuffer.cmdTransitionImageLayout(shadowCascadeTextures_[k], ImageLayout_DEPTH_ATTACHMENT_OPTIMAL);
 			cmdBuffer.cmdBeginRendering(TextureHandle{}, shadowCascadeTextures_[k], &clearVal);
@@ -131,12 +138,32 @@ namespace Gaia {
 				.height = shadowmapResolutions_[k],
 				});
 			cmdBuffer.cmdBindGraphicsDescriptorSets(0, shadowRenderPipeline_, { renderer_->mvpMatrixDescriptorSetLayout, renderer_->meshDescriptorSet, shadowDescSetLayout_ });
-			//draw the batched mesh
+			cmdBuffer.cmdBindVertexBuffer(0, renderer_->vertexBuffer, 0);
+			cmdBuffer.cmdBindIndexBuffer(renderer_->indexBuffer, IndexFormat_U32, 0);
+			if (GpuCulling* gpuCulling = renderer_->gpuCulling_.get())
 			{
-				cmdBuffer.cmdBindVertexBuffer(0, renderer_->vertexBuffer, 0);
-				cmdBuffer.cmdBindIndexBuffer(renderer_->indexBuffer, IndexFormat_U32, 0);
-
-				cmdBuffer.cmdDrawIndexed(renderer_->numIndicesPerMesh, 1, 0, 0, 0);
+				//the cascade is view k + 1 of the culling dispatch, its commands are grouped by g buffer pipeline
+				for (uint32_t pipeline = 0; pipeline < gpuCulling->getNumPipelines(); pipeline++)
+					gpuCulling->draw(cmdBuffer, k + 1, pipeline);
+			}
+			else
+			{
+				//cpu culling, the sub meshes inside the cascade frustum go out as one indirect draw
+				const Frustum frustum = FrustumCulling::extractFrustum(lightData_[k].lightProjection * lightData_[k].lightView);
+				FrustumCulling::cull(renderer_->subMeshBounds_, frustum, cascadeVisibility_);
+				LodSelection::buildDraws(scene.getMeshes(), scene.getGlobalTransforms(), cascadeVisibility_, lightData_[k].lightView, lightData_[k].lightProjection,
+					(float)shadowmapResolutions_[k], Renderer::lodPixelError, cascadeLods_, cascadeDraws_);
+
+				const size_t commandOffset = (context->getFrameInFlight() * shadowDesc_.numCascades + k) * maxDrawsPerCascade_ * sizeof(DrawIndexedIndirectCommand);
+				DrawIndexedIndirectCommand* commands = reinterpret_cast<DrawIndexedIndirectCommand*>(context->getMappedPtr(cascadeIndirectBuffer_) + commandOffset);
+				for (size_t i = 0; i < cascadeDraws_.size(); i++)
+				{
+					commands[i] = DrawIndexedIndirectCommand{ .indexCount = cascadeDraws_[i].indexCount, .firstIndex = cascadeDraws_[i].firstIndex };
+				}
+				if (!cascadeDraws_.empty())
+					context->flushMappedMemory(cascadeIndirectBuffer_, commandOffset, cascadeDraws_.size() * sizeof(DrawIndexedIndirectCommand));
+
+				cmdBuffer.cmdDrawIndexedIndirect(cascadeIndirectBuffer_, commandOffset, static_cast<uint32_t>(cascadeDraws_.size()));
 			}
 			cmdBuffer.cmdEndRendering();
 			cmdBuffer.cmdTransitionImageLayout(shadowCascadeTextures_[k], ImageLayout_DEPTH_READ_ONLY_OPTIMAL);
@@ -145,6 +172,15 @@ namespace Gaia {
 		}
 	}
 
+	CullingView Shadows::getCullingView(uint32_t cascade) const
+	{
+		return CullingView{
+			.view = lightData_[cascade].lightView,
+			.projection = lightData_[cascade].lightProjection,
+			.viewportHeight = (float)shadowmapResolutions_[cascade],
+		};
+	}
+
 	void Shadows::createShadowMatrices(Scene& scene)
 	{
 		EditorCamera& camera = scene.getMainCamera();
@@ -4,6 +4,7 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "GaiaRenderer.h"
 #include "Renderer.h"
+#include "GpuCulling.h"
 #include "glm/glm.hpp"
 
 #define MAX_SHADOW_CASCADES 8
@@ -46,6 +47,9 @@ public:
 	static std::unique_ptr<Shadows> create(ShadowDescriptor desc, Renderer* renderer, Scene& scene);
 	void update(Scene& scene);
 	void render(Scene& scene);
+	inline uint32_t getNumCascades() const { return shadowDesc_.numCascades; }
+	//light matrices and shadow map size of a cascade for GpuCulling
+	CullingView getCullingView(uint32_t cascade) const;
 
 public:
 	static float lamda;
@@ -60,9 +64,14 @@ private:
 	Holder<ShaderModuleHandle> vertexShader_;
 	Holder<ShaderModuleHandle> fragmentShader_;
 	Holder<DescriptorSetLayoutHandle> shadowDescSetLayout_;
-	Holder<BufferHandle> lightDataBufferStaging_;
 
 	std::vector<uint32_t> shadowmapResolutions_;
+	//sub meshes are culled and levels of detail are selected per cascade with the light matrices, the vectors are reused between cascades
+	std::vector<uint8_t> cascadeLods_;
+	std::vector<DrawRange> cascadeDraws_;
+	std::vector<uint8_t> cascadeVisibility_;
+	Holder<BufferHandle> cascadeIndirectBuffer_; //compacted draws of every cascade and frame in flight, maxDrawsPerCascade_ commands each
+	size_t maxDrawsPerCascade_ = 1;
 private:
 	void createShadowMatrices(Scene& scene);
 };
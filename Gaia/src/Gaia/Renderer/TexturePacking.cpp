@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "TexturePacking.h"
+#include "Gaia/TextureMips.h"
+#include <map>
+
+namespace Gaia
+{
+	namespace TexturePacking
+	{
+		std::vector<Group> group(const std::vector<Candidate>& candidates, uint32_t minLayers)
+		{
+			//the format decides the encoding, so textures with the same key have the same level layout
+			struct Key
+			{
+				Format format;
+				uint32_t width;
+				uint32_t height;
+				uint32_t numMips;
+				auto operator<=>(const Key&) const = default;
+			};
+			std::map<Key, std::vector<uint32_t>> buckets;
+			for (uint32_t i = 0; i < candidates.size(); i++)
+			{
+				const Texture& texture = *candidates[i].texture;
+				if (texture.getTexels().size() != TextureMips::getLevelOffset(texture, texture.numMips))
+					continue;
+				buckets[Key{ candidates[i].format, uint32_t(texture.width), uint32_t(texture.height), texture.numMips }].push_back(i);
+			}
+
+			std::vector<Group> groups;
+			for (const auto& [key, members] : buckets)
+			{
+				for (size_t first = 0; first < members.size() && groups.size() < MAX_ARRAYS; first += MAX_LAYERS)
+				{
+					const size_t numLayers = std::min<size_t>(members.size() - first, MAX_LAYERS);
+					if (numLayers < std::max(minLayers, 1u))
+						break;
+					groups.push_back(Group{
+						.format = key.format,
+						.width = key.width,
+						.height = key.height,
+						.numMips = key.numMips,
+						.layers = std::vector<uint32_t>(members.begin() + first, members.begin() + first + numLayers),
+						});
+				}
+			}
+			return groups;
+		}
+	}
+}
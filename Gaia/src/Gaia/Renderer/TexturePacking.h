@@ -0,0 +1,43 @@
+#pragma once
+#include "GaiaRenderer.h"
+#include "Gaia/Material.h"
+
+namespace Gaia
+{
+	struct TexturePackingDesc
+	{
+		bool enabled = false;
+		uint32_t minLayers = 4; //smaller groups keep their own textures and stay streamable
+	};
+
+	//groups textures with the same size, format and mip count into 2D array textures, so scenes with many small images bind a
+	//few arrays instead of one descriptor per image and draws of neighbouring materials sample the same image.
+	//A packed material texture index holds the array and the layer (see Shaders/material_textures.glsl), an unpacked one
+	//is the slot in the texture list as before. Packed textures are uploaded with every level and are not streamed
+	namespace TexturePacking
+	{
+		constexpr int ARRAY_BIT = 1 << 30;
+		constexpr uint32_t MAX_ARRAYS = 1u << 16;
+		constexpr uint32_t MAX_LAYERS = 2048; //smallest maxImageArrayLayers a vulkan device reports
+
+		inline int encode(uint32_t array, uint32_t layer) { return ARRAY_BIT | int(layer << 16) | int(array); }
+		inline bool isPacked(int textureIndex) { return textureIndex >= 0 && (textureIndex & ARRAY_BIT) != 0; }
+
+		struct Candidate
+		{
+			const Texture* texture = nullptr;
+			Format format = Format_Invalid;
+		};
+		struct Group
+		{
+			Format format = Format_Invalid;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t numMips = 1;
+			std::vector<uint32_t> layers; //candidate index of every layer
+		};
+
+		//groups of at least minLayers candidates, candidates that are in no group keep their own texture
+		std::vector<Group> group(const std::vector<Candidate>& candidates, uint32_t minLayers);
+	}
+}
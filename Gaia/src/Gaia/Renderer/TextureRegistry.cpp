@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "TextureRegistry.h"
+#include "Gaia/Hash.h"
+
+namespace Gaia
+{
+	TextureRegistry::TextureRegistry(bool hashContents)
+		: m_hashContents(hashContents)
+	{
+	}
+
+	void TextureRegistry::beginAsset()
+	{
+		m_sourceSlots.clear();
+	}
+
+	TextureRegistry::Slot TextureRegistry::acquire(const Texture& texture, int sourceIndex, Format format)
+	{
+		m_stats.numRequests++;
+		const uint64_t size = texture.getTexels().size();
+		auto sourceSlot = m_sourceSlots.find({ sourceIndex, format });
+		if (sourceSlot != m_sourceSlots.end())
+		{
+			m_stats.savedBytes += size;
+			return Slot{ .index = sourceSlot->second, .isNew = false };
+		}
+
+		//the description goes into the seed, equal texels with a different size or format are a different texture
+		uint64_t contentHash = 0;
+		if (m_hashContents)
+		{
+			const uint64_t description[] = { uint64_t(texture.width), uint64_t(texture.height), texture.numMips, texture.encoding, format };
+			contentHash = hashBytes(texture.getTexels().data(), size, hashBytes(description, sizeof(description), 0));
+			auto [first, last] = m_contentSlots.equal_range(contentHash);
+			for (auto contentSlot = first; contentSlot != last; ++contentSlot)
+			{
+				const ContentSlot& candidate = contentSlot->second;
+				const std::span<const uint8_t> texels = candidate.texture->getTexels();
+				const bool isSame = candidate.format == format && candidate.texture->width == texture.width && candidate.texture->height == texture.height &&
+					candidate.texture->numMips == texture.numMips && candidate.texture->encoding == texture.encoding &&
+					texels.size() == size && (size == 0 || memcmp(texels.data(), texture.getTexels().data(), size) == 0);
+				if (!isSame)
+					continue;
+				m_sourceSlots[{ sourceIndex, format }] = candidate.index;
+				m_stats.savedBytes += size;
+				return Slot{ .index = candidate.index, .isNew = false };
+			}
+		}
+
+		const uint32_t index = m_stats.numTextures++;
+		m_sourceSlots[{ sourceIndex, format }] = index;
+		if (m_hashContents)
+			m_contentSlots.emplace(contentHash, ContentSlot{ .texture = &texture, .format = format, .index = index });
+		m_stats.uploadedBytes += size;
+		return Slot{ .index = index, .isNew = true };
+	}
+
+	void TextureRegistry::clear()
+	{
+		m_sourceSlots.clear();
+		m_contentSlots.clear();
+		m_stats = {};
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "GaiaRenderer.h"
+#include "Gaia/Material.h"
+#include <map>
+#include <unordered_map>
+
+namespace Gaia
+{
+	//maps every texture a material references to one GPU texture and one bindless slot (an index of Renderer::glTfTextures).
+	//Textures are keyed by their source image index and format, so an image shared by several materials is uploaded once.
+	//With hashContents the texels are hashed as well, which also shares identical images between assets. A matching hash is
+	//confirmed by comparing the texels with the first texture of the slot, so that texture has to stay alive until clear().
+	//The hash runs over every texel on the calling thread, which is why it is off by default
+	class TextureRegistry
+	{
+	public:
+		struct Slot
+		{
+			uint32_t index = 0;
+			bool isNew = false; //the caller creates and uploads the GPU texture of this slot
+		};
+		struct Stats
+		{
+			uint32_t numRequests = 0;
+			uint32_t numTextures = 0;
+			uint64_t uploadedBytes = 0;
+			uint64_t savedBytes = 0; //texels that were not uploaded again because the slot already existed
+		};
+
+		explicit TextureRegistry(bool hashContents = false);
+
+		//source image indices are only unique inside one asset, call this before registering the textures of the next one
+		void beginAsset();
+		Slot acquire(const Texture& texture, int sourceIndex, Format format);
+
+		const Stats& getStats() const { return m_stats; }
+		void clear();
+
+	private:
+		struct ContentSlot
+		{
+			const Texture* texture = nullptr; //the texture the slot was created for
+			Format format = Format_Invalid;
+			uint32_t index = 0;
+		};
+		bool m_hashContents = false;
+		std::map<std::pair<int, Format>, uint32_t> m_sourceSlots;
+		std::unordered_multimap<uint64_t, ContentSlot> m_contentSlots; //different texels can share a hash
+		Stats m_stats = {};
+	};
+}
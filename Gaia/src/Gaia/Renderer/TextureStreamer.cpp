@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "TextureStreamer.h"
+#include "Gaia/TextureMips.h"
+
+namespace Gaia
+{
+	TextureStreamer::TextureStreamer(IContext* context, const TextureStreamingDesc& desc, const std::string& cachePath, std::vector<Holder<TextureHandle>>& textures)
+		: context_(context), desc_(desc), textures_(textures)
+	{
+		if (desc_.enabled && !cachePath.empty() && !cacheFile_.open(cachePath))
+		{
+			GAIA_CORE_WARN("Could not map {}, textures are streamed from memory", cachePath);
+		}
+		loader_ = std::thread(&TextureStreamer::loaderThread, this);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopLoader_ = true;
+		}
+		wakeLoader_.notify_one();
+		loader_.join();
+	}
+
+	Texture TextureStreamer::getLevels(const StreamedTexture& texture, uint32_t firstMip) const
+	{
+		Texture levels;
+		levels.width = TextureMips::getMipSize(texture.width, firstMip);
+		levels.height = TextureMips::getMipSize(texture.height, firstMip);
+		levels.numMips = texture.numMips - firstMip;
+		levels.encoding = texture.encoding;
+		return levels;
+	}
+
+	uint64_t TextureStreamer::getResidentSize(const StreamedTexture& texture, uint32_t firstMip) const
+	{
+		Texture levels = getLevels(texture, firstMip);
+		return TextureMips::getLevelOffset(levels, levels.numMips);
+	}
+
+	bool TextureStreamer::isCooked(const Texture& texture) const
+	{
+		return cacheFile_.isOpen() && texture.cacheOffset != 0 && texture.cacheOffset <= cacheFile_.size() &&
+			texture.getTexels().size() <= cacheFile_.size() - texture.cacheOffset;
+	}
+
+	void TextureStreamer::addTexture(const Texture& texture, Format format)
+	{
+		StreamedTexture streamed{
+			.width = uint32_t(texture.width),
+			.height = uint32_t(texture.height),
+			.numMips = texture.numMips,
+			.encoding = texture.encoding,
+			.format = format,
+			.source = &texture,
+			.cacheOffset = isCooked(texture) ? texture.cacheOffset : 0,
+		};
+
+		//textures whose levels do not match their description are uploaded as they are and never streamed
+		const Texture full = getLevels(streamed, 0);
+		const bool isStreamable = desc_.enabled && (streamed.cacheOffset != 0 || desc_.streamFromMemory) &&
+			texture.getTexels().size() == TextureMips::getLevelOffset(full, full.numMips);
+		uint32_t baseMip = 0;
+		while (isStreamable && baseMip + 1 < streamed.numMips &&
+			std::max(TextureMips::getMipSize(streamed.width, baseMip), TextureMips::getMipSize(streamed.height, baseMip)) > desc_.residentMaxSize)
+		{
+			baseMip++;
+		}
+		const size_t baseOffset = isStreamable ? TextureMips::getLevelOffset(full, baseMip) : 0;
+		const std::span<const uint8_t> texels = texture.getTexels();
+		streamed.baseTexels.assign(texels.begin() + baseOffset, texels.end());
+		streamed.baseMip = baseMip;
+		streamed.residentMip = baseMip;
+
+		const uint32_t slot = uint32_t(streamed_.size());
+		streamed_.push_back(std::move(streamed));
+		textures_.emplace_back();
+		createTexture(slot, baseMip, streamed_[slot].baseTexels.data(), streamed_[slot].baseTexels.size());
+		if (!isStreamable)
+		{
+			//nothing finer than what is resident
+			streamed_[slot].baseTexels.clear();
+			streamed_[slot].baseTexels.shrink_to_fit();
+		}
+	}
+
+	void TextureStreamer::createFeedbackBuffer()
+	{
+		BufferDesc feedbackDesc{
+			.usage_type = BufferUsageBits_Storage,
+			.storage_type = StorageType_HostVisible,
+			.size = std::max<size_t>(streamed_.size(), 1) * sizeof(int32_t),
+		};
+		feedbackBuffer_ = context_->createBuffer(feedbackDesc);
+		std::fill_n(reinterpret_cast<int32_t*>(context_->getMappedPtr(feedbackBuffer_)), feedbackDesc.size / sizeof(int32_t), NOT_REQUESTED);
+		context_->flushMappedMemory(feedbackBuffer_, 0, feedbackDesc.size);
+	}
+
+	void TextureStreamer::createTexture(uint32_t slot, uint32_t firstMip, const uint8_t* texels, size_t size)
+	{
+		StreamedTexture& streamed = streamed_[slot];
+		const Texture levels = getLevels(streamed, firstMip);
+		TextureDesc textureDesc{
+			.type = TextureType_2D,
+			.format = streamed.format,
+			.dimensions = {uint32_t(levels.width), uint32_t(levels.height), 1},
+			.usage = TextureUsageBits_Sampled,
+			.numMipLevels = levels.numMips,
+			.storage = StorageType_Device,
+			.generateMipmaps = false,
+		};
+		Holder<TextureHandle> texture = context_->createTexture(textureDesc);
+		std::vector<uint64_t> levelOffsets(levels.numMips);
+		for (uint32_t level = 0; level < levels.numMips; level++)
+			levelOffsets[level] = TextureMips::getLevelOffset(levels, level);
+		context_->upload(texture, texels, size, levelOffsets);
+
+		if (!TextureHandle(textures_[slot]).isEmpty())
+		{
+			//Holder's move assignment does not release the texture it replaces. The bindless slot still points at it
+			//until update() rewrites the descriptors, so it is released after that (see update())
+			retiredTextures_.push_back(std::move(textures_[slot]));
+			stats_.residentBytes -= getResidentSize(streamed, streamed.residentMip);
+			updatedSlots_.push_back(slot);
+		}
+		textures_[slot] = std::move(texture);
+		streamed.residentMip = firstMip;
+		stats_.residentBytes += getResidentSize(streamed, firstMip);
+	}
+
+	bool TextureStreamer::evict(uint64_t bytesNeeded, uint32_t keepSlot)
+	{
+		//least recently requested first, textures that were just requested are never evicted
+		std::vector<uint32_t> candidates;
+		uint64_t bytesFreed = 0;
+		for (uint32_t slot = 0; slot < streamed_.size(); slot++)
+		{
+			const StreamedTexture& streamed = streamed_[slot];
+			if (slot != keepSlot && streamed.residentMip < streamed.baseMip && frame_ - streamed.lastRequestFrame >= desc_.evictAfterFrames)
+			{
+				candidates.push_back(slot);
+				bytesFreed += getResidentSize(streamed, streamed.residentMip) - getResidentSize(streamed, streamed.baseMip);
+			}
+		}
+		if (bytesFreed < bytesNeeded)
+			return false;
+
+		std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+			return streamed_[a].lastRequestFrame < streamed_[b].lastRequestFrame;
+			});
+		bytesFreed = 0;
+		for (uint32_t slot : candidates)
+		{
+			if (bytesFreed >= bytesNeeded)
+				break;
+			StreamedTexture& streamed = streamed_[slot];
+			bytesFreed += getResidentSize(streamed, streamed.residentMip) - getResidentSize(streamed, streamed.baseMip);
+			createTexture(slot, streamed.baseMip, streamed.baseTexels.data(), streamed.baseTexels.size());
+			stats_.numEvictions++;
+		}
+		return true;
+	}
+
+	void TextureStreamer::update(DescriptorSetLayoutHandle descriptorSet, uint32_t binding)
+	{
+		frame_++;
+		if (!desc_.enabled || streamed_.empty())
+			return;
+
+		//the requests are relative to the levels that were resident while the last frame was rendered. Submits do not wait,
+		//so the frames in flight may still write entries, a late or lost request is only repeated by a later frame
+		const size_t feedbackSize = streamed_.size() * sizeof(int32_t);
+		context_->invalidateMappedMemory(feedbackBuffer_, 0, feedbackSize);
+		int32_t* requests = reinterpret_cast<int32_t*>(context_->getMappedPtr(feedbackBuffer_));
+		for (uint32_t slot = 0; slot < streamed_.size(); slot++)
+		{
+			if (requests[slot] == NOT_REQUESTED)
+				continue;
+			StreamedTexture& streamed = streamed_[slot];
+			streamed.requestedMip = uint32_t(std::clamp(int32_t(streamed.residentMip) + requests[slot], 0, int32_t(streamed.numMips) - 1));
+			streamed.lastRequestFrame = frame_;
+			requests[slot] = NOT_REQUESTED;
+		}
+		context_->flushMappedMemory(feedbackBuffer_, 0, feedbackSize);
+
+		//swap in the finished loads that still fit the budget
+		std::deque<LoadRequest> finished;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			finished.swap(finished_);
+		}
+		for (LoadRequest& load : finished)
+		{
+			StreamedTexture& streamed = streamed_[load.slot];
+			streamed.loadingMip = UINT32_MAX;
+			if (load.firstMip >= streamed.residentMip)
+				continue;
+
+			const uint64_t residentBytes = stats_.residentBytes + getResidentSize(streamed, load.firstMip) - getResidentSize(streamed, streamed.residentMip);
+			if (residentBytes > desc_.vramBudget && !evict(residentBytes - desc_.vramBudget, load.slot))
+				continue;
+			createTexture(load.slot, load.firstMip, load.texels.data(), load.texels.size());
+			stats_.numLoads++;
+		}
+
+		//queue the largest improvements first
+		std::vector<uint32_t> candidates;
+		uint32_t numLoading = 0;
+		for (uint32_t slot = 0; slot < streamed_.size(); slot++)
+		{
+			const StreamedTexture& streamed = streamed_[slot];
+			if (streamed.loadingMip != UINT32_MAX)
+				numLoading++;
+			else if (streamed.requestedMip < streamed.residentMip && streamed.lastRequestFrame == frame_)
+				candidates.push_back(slot);
+		}
+		std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+			return streamed_[a].residentMip - streamed_[a].requestedMip > streamed_[b].residentMip - streamed_[b].requestedMip;
+			});
+		const size_t numNewLoads = std::min<size_t>(candidates.size(), desc_.maxUploadsPerFrame - std::min(numLoading, desc_.maxUploadsPerFrame));
+		if (numNewLoads > 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (size_t i = 0; i < numNewLoads; i++)
+			{
+				StreamedTexture& streamed = streamed_[candidates[i]];
+				const Texture full = getLevels(streamed, 0);
+				const uint8_t* texels = streamed.cacheOffset ? cacheFile_.data() + streamed.cacheOffset : streamed.source->getTexels().data();
+				const size_t offset = TextureMips::getLevelOffset(full, streamed.requestedMip);
+				pending_.push_back(LoadRequest{
+					.slot = candidates[i],
+					.firstMip = streamed.requestedMip,
+					.source = texels + offset,
+					.size = TextureMips::getLevelOffset(full, full.numMips) - offset,
+					});
+				streamed.loadingMip = streamed.requestedMip;
+			}
+		}
+		wakeLoader_.notify_one();
+
+		if (updatedSlots_.empty())
+			return;
+		//the set is not update after bind, the frames still in flight have to be done with it before it is rewritten
+		const SubmitHandle lastFrame = context_->getLastSubmitHandle();
+		context_->wait(lastFrame);
+		for (uint32_t slot : updatedSlots_)
+			context_->updateDescriptorSet(descriptorSet, binding, slot, textures_[slot]);
+		updatedSlots_.clear();
+
+		//the replaced textures were last sampled by the frames submitted up to lastFrame, the descriptors no longer point at them
+		for (Holder<TextureHandle>& texture : retiredTextures_)
+		{
+			auto retired = std::make_shared<Holder<TextureHandle>>(std::move(texture));
+			context_->deferredTask(std::packaged_task<void()>([retired]() mutable { retired.reset(); }), lastFrame);
+		}
+		retiredTextures_.clear();
+	}
+
+	void TextureStreamer::loaderThread()
+	{
+		while (true)
+		{
+			LoadRequest request;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wakeLoader_.wait(lock, [&] { return stopLoader_ || !pending_.empty(); });
+				if (stopLoader_)
+					return;
+				request = std::move(pending_.front());
+				pending_.pop_front();
+			}
+			//for cooked textures this is where the levels are paged in from disk
+			request.texels.assign(request.source, request.source + request.size);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				finished_.push_back(std::move(request));
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "GaiaRenderer.h"
+#include "Gaia/Material.h"
+#include "Gaia/MappedFile.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Gaia
+{
+	struct TextureStreamingDesc
+	{
+		bool enabled = true;
+		uint64_t vramBudget = 1024ull * 1024ull * 1024ull; //bytes all textures may use together, the finer mips are evicted LRU to stay below
+		uint32_t residentMaxSize = 128; //textures start with the first level whose larger side is at most this many texels
+		uint32_t evictAfterFrames = 60; //a texture that was requested more recently than this is not evicted
+		uint32_t maxUploadsPerFrame = 4;
+		bool streamFromMemory = true; //stream textures that are not on disk from Texture::textureData, else they are uploaded with every level
+	};
+
+	//Streams the mip levels of the glTF textures under a VRAM budget. Every texture starts with its small levels resident,
+	//the g buffer pass writes the finest level each texture is sampled at into a feedback buffer (relative to the levels
+	//that are resident) and a loader thread reads the requested levels from the cooked scene file, or from
+	//Texture::textureData if the texture is not cooked. Finished loads replace the gpu texture and its bindless slot.
+	class TextureStreamer
+	{
+	public:
+		static constexpr int32_t NOT_REQUESTED = INT32_MAX;
+
+		struct Stats
+		{
+			uint64_t residentBytes = 0;
+			uint32_t numLoads = 0;
+			uint32_t numEvictions = 0;
+		};
+
+		//textures is the bindless texture array the slots index, cachePath the cooked scene (see SceneCache.h), the spill file (see CpuResidency) or empty
+		TextureStreamer(IContext* context, const TextureStreamingDesc& desc, const std::string& cachePath, std::vector<Holder<TextureHandle>>& textures);
+		~TextureStreamer();
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		//creates the gpu texture of the next slot with the small levels resident. The texture must stay alive while it is
+		//streamed unless it is on disk (Texture::cacheOffset) or streamFromMemory is off, then its textureData may be released afterwards
+		void addTexture(const Texture& texture, Format format);
+		//creates the feedback buffer, call after the last addTexture
+		void createFeedbackBuffer();
+		inline BufferHandle getFeedbackBuffer() const { return feedbackBuffer_; }
+		//true if the texels of the texture can be read back from the cooked scene or spill file
+		bool isCooked(const Texture& texture) const;
+
+		//reads the requests of the last frame, swaps in finished loads, evicts and schedules new loads.
+		//descriptorSet/binding is the texture array the slots are bound to. When a slot changed it waits for the submitted frames
+		//before the array is rewritten, the textures it replaced are released once those frames are done
+		void update(DescriptorSetLayoutHandle descriptorSet, uint32_t binding);
+		inline const Stats& getStats() const { return stats_; }
+
+	private:
+		struct StreamedTexture
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t numMips = 1;
+			TextureEncoding encoding = TextureEncoding_RGBA8;
+			Format format = Format_Invalid;
+			const Texture* source = nullptr;
+			uint64_t cacheOffset = 0;
+			std::vector<uint8_t> baseTexels; //the levels from baseMip on, kept so an evicted texture can fall back to them
+			uint32_t baseMip = 0; //first level that is always resident
+			uint32_t residentMip = 0; //first level of the gpu texture
+			uint32_t requestedMip = UINT32_MAX;
+			uint32_t loadingMip = UINT32_MAX; //first level the loader is working on
+			uint64_t lastRequestFrame = 0;
+		};
+		struct LoadRequest
+		{
+			uint32_t slot = 0;
+			uint32_t firstMip = 0;
+			const uint8_t* source = nullptr; //every level from firstMip on, in the mapped file or Texture::textureData
+			size_t size = 0;
+			std::vector<uint8_t> texels; //filled by the loader
+		};
+
+		Texture getLevels(const StreamedTexture& texture, uint32_t firstMip) const; //description of the levels from firstMip on
+		uint64_t getResidentSize(const StreamedTexture& texture, uint32_t firstMip) const;
+		void createTexture(uint32_t slot, uint32_t firstMip, const uint8_t* texels, size_t size);
+		bool evict(uint64_t bytesNeeded, uint32_t keepSlot);
+		void loaderThread();
+
+	private:
+		IContext* context_ = nullptr;
+		TextureStreamingDesc desc_;
+		MappedFile cacheFile_;
+		std::vector<Holder<TextureHandle>>& textures_;
+		std::vector<StreamedTexture> streamed_;
+		Holder<BufferHandle> feedbackBuffer_;
+		std::vector<uint32_t> updatedSlots_; //slots whose gpu texture changed since the last descriptor update
+		std::vector<Holder<TextureHandle>> retiredTextures_; //replaced textures the descriptors of updatedSlots_ still point at
+		uint64_t frame_ = 0;
+		Stats stats_ = {};
+
+		std::thread loader_;
+		std::mutex mutex_;
+		std::condition_variable wakeLoader_;
+		std::deque<LoadRequest> pending_;
+		std::deque<LoadRequest> finished_;
+		bool stopLoader_ = false;
+	};
+}
@@ -138,6 +138,9 @@ namespace Gaia {
 		features.samplerAnisotropy = VK_TRUE;
 		features.depthClamp = VK_TRUE;
 		features.shaderInt64 = VK_TRUE;
+		features.textureCompressionBC = VK_TRUE;
+		features.fragmentStoresAndAtomics = VK_TRUE; //texture streaming feedback (see TextureStreamer.h)
+		features.multiDrawIndirect = VK_TRUE; //culled draws are submitted as one indirect draw per pipeline (see FrustumCulling.h)
 		
 		VkPhysicalDeviceVulkan13Features features13;
 		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
@@ -171,6 +174,9 @@ namespace Gaia {
 		GAIA_ASSERT(vkb_pd_res,"failed to get physical device error code: {}", vkb_pd_res.error().message());
 		
 		vkb::PhysicalDevice vkb_pd = vkb_pd_res.value();
+		//optional, without it the draws are culled on the cpu (see GpuCulling::create)
+		VkPhysicalDeviceVulkan12Features indirectCountFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .drawIndirectCount = VK_TRUE };
+		vkFeatures12_.drawIndirectCount = vkb_pd.enable_extension_features_if_present(indirectCountFeatures);
 
 		GAIA_CORE_TRACE("Physical device name: {}", vkb_pd.name);
 		vkb::DeviceBuilder device_builder{ vkb_pd };
@@ -210,6 +216,7 @@ namespace Gaia {
 		vmaCreateAllocator(&allocatorCreateInfo, &vmaAllocator_);
 
 		immediateCommands_ = std::make_unique<VulkanImmediateCommands>(vkDevice_, deviceQueues_.graphicsQueueFamilyIndex);
+		stagingDevice_ = std::make_unique<VulkanStagingDevice>(*this);
 		if (window)
 		{
 			glfwGetWindowSize(glfwWindow, &window_width, &window_height);
@@ -218,6 +225,7 @@ namespace Gaia {
 	}
 	VulkanContext::~VulkanContext()
 	{
+		stagingDevice_.reset(nullptr);
 		GAIA_ASSERT(vkDeviceWaitIdle(vkDevice_) == VK_SUCCESS, "");
 		swapchain_.reset(nullptr);
 
@@ -244,13 +252,15 @@ namespace Gaia {
 		vulkanCommandBuffer_ = std::make_unique<VulkanCommandBuffer>(this);
 		return *vulkanCommandBuffer_;
 	}
-	void VulkanContext::submit(ICommandBuffer& cmd, TextureHandle presentTexture)
+	SubmitHandle VulkanContext::submit(ICommandBuffer& cmd, TextureHandle presentTexture)
 	{
 		VulkanCommandBuffer* vulkanCmdBuffer = static_cast<VulkanCommandBuffer*>(&cmd);
 
 		VulkanImage* swapchainImage = texturesPool_.get(presentTexture);
 
-		immediateCommands_->waitSemaphore(swapchain_->acquireSemaphore_);
+		//pending uploads go first so the frame sees them
+		stagingDevice_->flush();
+		immediateCommands_->waitSemaphore(swapchain_->acquireSemaphores_[frameInFlight_]);
 		VkImageSubresourceRange subRange{
 			.aspectMask = swapchainImage->getImageAspectFlags(),
 			.baseMipLevel = 0,
@@ -259,19 +269,58 @@ namespace Gaia {
 			.layerCount = 1,
 		};
 		swapchainImage->transitionLayout(vulkanCmdBuffer->commandBufferWraper_->cmdBuffer_, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, subRange);
-		immediateCommands_->submit(*vulkanCmdBuffer->commandBufferWraper_);
+		SubmitHandle handle = immediateCommands_->submit(*vulkanCmdBuffer->commandBufferWraper_);
 
 		swapchain_->present(immediateCommands_->acquireLastSubmitSemaphore());
-		if (vulkanCmdBuffer->commandBufferWraper_->fence_ != VK_NULL_HANDLE)
-			vkWaitForFences(vkDevice_, 1, &vulkanCmdBuffer->commandBufferWraper_->fence_, VK_TRUE, ONE_SEC_TO_NANOSEC);
+		frameSubmits_[frameInFlight_] = handle;
+		frameInFlight_ = (frameInFlight_ + 1) % MAX_FRAMES_IN_FLIGHT;
+
+		//the next frame reuses the slot, its acquire semaphore and the per frame slices of the frame recorded MAX_FRAMES_IN_FLIGHT
+		//presents ago. Submits finish in order so waiting for that frame's present submit covers all of its work
+		if (!frameSubmits_[frameInFlight_].empty())
+			immediateCommands_->wait(frameSubmits_[frameInFlight_]);
+		processDeferredTasks();
+		return handle;
 	}
-	void VulkanContext::submit(ICommandBuffer& cmd)
+	SubmitHandle VulkanContext::submit(ICommandBuffer& cmd)
 	{
 		VulkanCommandBuffer* vulkanCmdBuffer = static_cast<VulkanCommandBuffer*>(&cmd);
 
-		immediateCommands_->submit(*vulkanCmdBuffer->commandBufferWraper_);
-		if (vulkanCmdBuffer->commandBufferWraper_->fence_ != VK_NULL_HANDLE)
-			vkWaitForFences(vkDevice_, 1, &vulkanCmdBuffer->commandBufferWraper_->fence_, VK_TRUE, UINT64_MAX);
+		stagingDevice_->flush();
+		SubmitHandle handle = immediateCommands_->submit(*vulkanCmdBuffer->commandBufferWraper_);
+		processDeferredTasks();
+		return handle;
+	}
+	void VulkanContext::upload(BufferHandle handle, const void* data, size_t size, size_t offset)
+	{
+		VulkanBuffer* buffer = bufferPool_.get(handle);
+		GAIA_ASSERT(buffer, "");
+		stagingDevice_->bufferSubData(*buffer, offset, size, data);
+	}
+	void VulkanContext::upload(BufferHandle handle, const void* data, const std::vector<BufferRange>& ranges)
+	{
+		VulkanBuffer* buffer = bufferPool_.get(handle);
+		GAIA_ASSERT(buffer, "");
+		stagingDevice_->bufferSubData(*buffer, data, ranges);
+	}
+	void VulkanContext::upload(TextureHandle handle, const void* data, size_t size, const std::vector<uint64_t>& levelOffsets, uint32_t layer)
+	{
+		VulkanImage* image = texturesPool_.get(handle);
+		GAIA_ASSERT(image, "");
+		stagingDevice_->imageData(*image, data, size, levelOffsets, layer);
+	}
+	void VulkanContext::flushUploads()
+	{
+		stagingDevice_->flush();
+	}
+	SubmitHandle VulkanContext::getLastSubmitHandle() const
+	{
+		return immediateCommands_->getLastSubmitHandle();
+	}
+	void VulkanContext::wait(SubmitHandle handle)
+	{
+		immediateCommands_->wait(handle);
+		processDeferredTasks();
 	}
 	std::pair<uint32_t, uint32_t> VulkanContext::getWindowSize()
 	{
@@ -405,6 +454,11 @@ namespace Gaia {
 			vkImageType = VK_IMAGE_TYPE_2D;
 			vkSamples = getVkSampleCountFromSampleCount(desc.numSamples);
 			break;
+		case TextureType_2DArray:
+			vkImageViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+			vkImageType = VK_IMAGE_TYPE_2D;
+			vkSamples = getVkSampleCountFromSampleCount(desc.numSamples);
+			break;
 		case TextureType_3D:
 			vkImageViewType = VK_IMAGE_VIEW_TYPE_3D;
 			vkImageType = VK_IMAGE_TYPE_3D;
@@ -514,7 +568,16 @@ namespace Gaia {
 			};
 		}
 
+		//the caller's constant values do not have to outlive this call
+		if (desc.specInfo.data && desc.specInfo.dataSize > 0)
+		{
+			const uint8_t* specData = static_cast<const uint8_t*>(desc.specInfo.data);
+			renderPipelineState.specConstantData_.assign(specData, specData + desc.specInfo.dataSize);
+		}
+
 		RenderPipelineHandle renderPipelineHandle = renderPipelinePool_.Create(std::move(renderPipelineState));
+		RenderPipelineState* rps = renderPipelinePool_.get(renderPipelineHandle);
+		rps->desc_.specInfo.data = rps->specConstantData_.empty() ? nullptr : rps->specConstantData_.data();
 		getPipeline(renderPipelineHandle);
 		return { this, renderPipelineHandle };
 	}
@@ -895,15 +958,58 @@ namespace Gaia {
 
 		return desc->deviceAddress;
 	}
+	uint8_t* VulkanContext::getMappedPtr(BufferHandle handle)
+	{
+		VulkanBuffer* buf = bufferPool_.get(handle);
+		GAIA_ASSERT(buf, "");
+
+		return buf ? buf->getMappedPtr() : nullptr;
+	}
+	void VulkanContext::flushMappedMemory(BufferHandle handle, size_t offset, size_t size)
+	{
+		VulkanBuffer* buf = bufferPool_.get(handle);
+		GAIA_ASSERT(buf && buf->isMapped(), "");
+
+		if (buf && buf->isMapped() && !buf->isCoherentMemory_)
+		{
+			buf->flushMappedMemory(*this, offset, size);
+		}
+	}
+	void VulkanContext::invalidateMappedMemory(BufferHandle handle, size_t offset, size_t size)
+	{
+		VulkanBuffer* buf = bufferPool_.get(handle);
+		GAIA_ASSERT(buf && buf->isMapped(), "");
+
+		if (buf && buf->isMapped() && !buf->isCoherentMemory_)
+		{
+			buf->invalidateMappedMemory(*this, offset, size);
+		}
+	}
+	void VulkanContext::updateDescriptorSet(DescriptorSetLayoutHandle handle, uint32_t binding, uint32_t arrayElement, TextureHandle texture)
+	{
+		VulkanDescriptorSet* set = descriptorSetPool_.get(handle);
+		VulkanImage* image = texturesPool_.get(texture);
+		GAIA_ASSERT(set && image, "");
+		set->updateTexture(binding, arrayElement, *image);
+	}
 	VulkanDescriptorSet* VulkanContext::getDescriptorSet(DescriptorSetLayoutHandle handle)
 	{
 		VulkanDescriptorSet* set =  descriptorSetPool_.get(handle);
 		return set;
 	}
+	bool VulkanContext::supportsDrawIndirectCount() const
+	{
+		return vkFeatures12_.drawIndirectCount == VK_TRUE;
+	}
+
 	uint32_t VulkanContext::getFrameBufferMSAABitMask() const
 	{
 		return 0;
 	}
+	uint32_t VulkanContext::getFrameInFlight() const
+	{
+		return frameInFlight_;
+	}
 
 	
 	
@@ -1034,26 +1140,46 @@ namespace Gaia {
 		}
 		
 
+		//specialization constants, shared by all stages
+		const SpecializationConstantDesc& specInfo = rps->desc_.specInfo;
+		const uint32_t numSpecConstants = specInfo.getNumSpecializationConstants();
+		VkSpecializationMapEntry specEntries[SpecializationConstantDesc::MAX_SPECIALIZATION_CONSTANTS] = {};
+		for (uint32_t i = 0; i < numSpecConstants; i++)
+		{
+			specEntries[i] = VkSpecializationMapEntry{
+				.constantID = specInfo.entries[i].constantId,
+				.offset = specInfo.entries[i].offset,
+				.size = specInfo.entries[i].size,
+			};
+		}
+		const VkSpecializationInfo vkSpecInfo{
+			.mapEntryCount = numSpecConstants,
+			.pMapEntries = specEntries,
+			.dataSize = specInfo.dataSize,
+			.pData = specInfo.data,
+		};
+		const VkSpecializationInfo* pSpecInfo = numSpecConstants > 0 ? &vkSpecInfo : nullptr;
+
 		//add the shader stages
 		if (smsVertex)
 		{
-			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, smsVertex->sm, rps->desc_.entryPointVert, nullptr));
+			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, smsVertex->sm, rps->desc_.entryPointVert, pSpecInfo));
 		}
 		if (smsFrag)
 		{
-			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, smsFrag->sm, rps->desc_.entryPointFrag, nullptr));
+			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, smsFrag->sm, rps->desc_.entryPointFrag, pSpecInfo));
 		}
 		if (smsTesc)
 		{
-			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, smsTesc->sm, rps->desc_.entryPointTesc, nullptr));
+			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, smsTesc->sm, rps->desc_.entryPointTesc, pSpecInfo));
 		}
 		if (smsTese)
 		{
-			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, smsTese->sm, rps->desc_.entryPointTese, nullptr));
+			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, smsTese->sm, rps->desc_.entryPointTese, pSpecInfo));
 		}
 		if (smsGeo)
 		{
-			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_GEOMETRY_BIT, smsGeo->sm, rps->desc_.entryPointGeom, nullptr));
+			pipelineBuilder->shaderStage(vkutil::getPipelineShaderStageCreateInfo(VK_SHADER_STAGE_GEOMETRY_BIT, smsGeo->sm, rps->desc_.entryPointGeom, pSpecInfo));
 		}
 
 		//build the pipeline
@@ -1616,11 +1742,22 @@ if(shaderModuleState)\
 			GAIA_ASSERT(vkDeviceWaitIdle(vkDevice_) == VK_SUCCESS, ""); //wait for device to finish its tasks
 			task.task_();
 		}
+		deferredTask_.clear();
 	}
 
-	void VulkanContext::deferredTask(std::packaged_task<void()>&& task)
+	void VulkanContext::processDeferredTasks()
 	{
-		deferredTask_.emplace_back(DeferredTask(std::move(task)));
+		//submits finish in order, so the front task is always the next one to become ready
+		while (!deferredTask_.empty() && immediateCommands_->isReady(deferredTask_.front().handle_))
+		{
+			deferredTask_.front().task_();
+			deferredTask_.pop_front();
+		}
+	}
+
+	void VulkanContext::deferredTask(std::packaged_task<void()>&& task, SubmitHandle handle)
+	{
+		deferredTask_.emplace_back(DeferredTask(std::move(task), handle.empty() ? immediateCommands_->getNextSubmitHandle() : handle));
 	}
 	void VulkanBuffer::bufferSubData(const VulkanContext& ctx, size_t offset, size_t size, const void* data)
 	{
@@ -1899,7 +2036,8 @@ if(shaderModuleState)\
 			swapchainTextures_[i] = swapchainTexHandle;
 
 		}
-			acquireSemaphore_ = vkutil::createSemaphore(vkDevice_);
+		for (VkSemaphore& semaphore : acquireSemaphores_)
+			semaphore = vkutil::createSemaphore(vkDevice_);
 	}
 	VulkanSwapchain::~VulkanSwapchain()
 	{
@@ -1909,7 +2047,8 @@ if(shaderModuleState)\
 		}
 		vkDestroySwapchainKHR(vkDevice_, vkSwapchain_, nullptr);
 
-		vkDestroySemaphore(vkDevice_, acquireSemaphore_, nullptr);
+		for (VkSemaphore semaphore : acquireSemaphores_)
+			vkDestroySemaphore(vkDevice_, semaphore, nullptr);
 	}
 	void VulkanSwapchain::present(VkSemaphore waitSemaphore)
 	{
@@ -1942,7 +2081,7 @@ if(shaderModuleState)\
 	}
 	TextureHandle VulkanSwapchain::getCurrentTexture()
 	{
-		VkResult res = vkAcquireNextImageKHR(vkDevice_, vkSwapchain_, ONE_SEC_TO_NANOSEC, acquireSemaphore_, VK_NULL_HANDLE, &currentImageIndex_);
+		VkResult res = vkAcquireNextImageKHR(vkDevice_, vkSwapchain_, ONE_SEC_TO_NANOSEC, acquireSemaphores_[ctx_.getFrameInFlight()], VK_NULL_HANDLE, &currentImageIndex_);
 		GAIA_ASSERT(res == VK_SUCCESS, "Failed to acquire next Image from swapchain: Error code {}", res);
 		TextureHandle swapchainTexture = swapchainTextures_[currentImageIndex_];
 		return swapchainTexture;
@@ -2133,6 +2272,20 @@ if(shaderModuleState)\
 			return VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK;
 		case Format_BC7_SRGB:
 			return VK_FORMAT_BC7_SRGB_BLOCK;
+		case Format_BC7_UN:
+			return VK_FORMAT_BC7_UNORM_BLOCK;
+		case Format_BC1_RGB_UN:
+			return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case Format_BC1_RGB_SRGB:
+			return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+		case Format_BC3_UN:
+			return VK_FORMAT_BC3_UNORM_BLOCK;
+		case Format_BC3_SRGB:
+			return VK_FORMAT_BC3_SRGB_BLOCK;
+		case Format_BC4_UN:
+			return VK_FORMAT_BC4_UNORM_BLOCK;
+		case Format_BC5_UN:
+			return VK_FORMAT_BC5_UNORM_BLOCK;
 
 			//depth formats
 		case Format_Z_UN16:
@@ -2260,13 +2413,19 @@ if(shaderModuleState)\
 		case Format_BGRA_SRGB8:
 			return sizeof(uint8_t) * 4;
 
-			// Compressed formats might be wrong
+			// Compressed formats, size of one 4x4 block
 		case Format_ETC2_RGB8:
-			return sizeof(uint8_t) * 4;
 		case Format_ETC2_SRGB8:
-			return sizeof(uint8_t) * 4;
+		case Format_BC1_RGB_UN:
+		case Format_BC1_RGB_SRGB:
+		case Format_BC4_UN:
+			return 8;
 		case Format_BC7_SRGB:
-			return sizeof(uint8_t) * 4;
+		case Format_BC7_UN:
+		case Format_BC3_UN:
+		case Format_BC3_SRGB:
+		case Format_BC5_UN:
+			return 16;
 
 			//depth formats
 		case Format_Z_UN16:
@@ -2736,7 +2895,7 @@ if(shaderModuleState)\
 			return false;
 		}
 
-		return vkWaitForFences(device_, 1, &buf.fence_, VK_TRUE, 0);
+		return vkWaitForFences(device_, 1, &buf.fence_, VK_TRUE, 0) == VK_SUCCESS;
 	}
 	void VulkanImmediateCommands::wait(SubmitHandle handle)
 	{
@@ -2798,6 +2957,217 @@ if(shaderModuleState)\
 			}
 		}
 	}
+	VulkanStagingDevice::VulkanStagingDevice(VulkanContext& ctx)
+		: ctx_(ctx)
+	{
+		BufferDesc desc{
+			.usage_type = BufferUsageBits_Storage,
+			.storage_type = StorageType_HostVisible,
+			.size = stagingBufferSize,
+		};
+		stagingBuffer_ = ctx_.createBuffer(desc, "staging ring");
+	}
+	VulkanStagingDevice::~VulkanStagingDevice()
+	{
+		flush();
+	}
+	VkCommandBuffer VulkanStagingDevice::getCommandBuffer()
+	{
+		if (!wrapper_)
+		{
+			wrapper_ = &ctx_.immediateCommands_->acquire();
+
+			//submits no longer wait for each other on the host, the copies of a batch must not overwrite buffers and images
+			//the earlier submits are still reading
+			VkMemoryBarrier2 barrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+				.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+				.srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+				.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			};
+			VkDependencyInfo depInfo{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.memoryBarrierCount = 1,
+				.pMemoryBarriers = &barrier,
+			};
+			vkCmdPipelineBarrier2(wrapper_->cmdBuffer_, &depInfo);
+		}
+		return wrapper_->cmdBuffer_;
+	}
+	SubmitHandle VulkanStagingDevice::flush()
+	{
+		if (!wrapper_)
+		{
+			return SubmitHandle{};
+		}
+		SubmitHandle handle = ctx_.immediateCommands_->submit(*wrapper_);
+		wrapper_ = nullptr;
+		return handle;
+	}
+	VulkanStagingDevice::MemoryRegion VulkanStagingDevice::allocate(VkDeviceSize size)
+	{
+		GAIA_ASSERT(size <= stagingBufferSize, "staging allocation is larger than the ring");
+		size = (size + regionAlignment - 1) & ~(regionAlignment - 1);
+		const VkDeviceSize offset = head_ + size <= stagingBufferSize ? head_ : 0;
+		auto overlaps = [&](const MemoryRegion& region) {
+			return offset < region.offset + region.size && region.offset < offset + size;
+			};
+
+		//retire the regions the gpu is done with, wait for the oldest one while the new region still overlaps
+		while (!regions_.empty())
+		{
+			const MemoryRegion& oldest = regions_.front();
+			if (ctx_.immediateCommands_->isReady(oldest.handle))
+			{
+				regions_.pop_front();
+				continue;
+			}
+			if (std::none_of(regions_.begin(), regions_.end(), overlaps))
+			{
+				break;
+			}
+			//the ring is full of copies that were not submitted yet
+			if (wrapper_ && oldest.handle.handle() == wrapper_->handle_.handle())
+			{
+				flush();
+			}
+			ctx_.immediateCommands_->wait(oldest.handle);
+			regions_.pop_front();
+		}
+
+		getCommandBuffer();
+		MemoryRegion region{
+			.offset = offset,
+			.size = size,
+			.handle = wrapper_->handle_,
+		};
+		regions_.push_back(region);
+		head_ = offset + size;
+		return region;
+	}
+	void VulkanStagingDevice::bufferSubData(VulkanBuffer& buffer, size_t dstOffset, size_t size, const void* data)
+	{
+		if (buffer.isMapped())
+		{
+			buffer.bufferSubData(ctx_, dstOffset, size, data);
+			return;
+		}
+
+		VulkanBuffer* staging = ctx_.bufferPool_.get(stagingBuffer_);
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+		while (size > 0)
+		{
+			const VkDeviceSize chunkSize = std::min<VkDeviceSize>(size, stagingBufferSize);
+			MemoryRegion region = allocate(chunkSize);
+			staging->bufferSubData(ctx_, region.offset, chunkSize, src);
+
+			VkBufferCopy bufferCopy{
+				.srcOffset = region.offset,
+				.dstOffset = dstOffset,
+				.size = chunkSize,
+			};
+			vkCmdCopyBuffer(wrapper_->cmdBuffer_, staging->vkBuffer_, buffer.vkBuffer_, 1, &bufferCopy);
+			src += chunkSize;
+			dstOffset += chunkSize;
+			size -= chunkSize;
+		}
+	}
+	void VulkanStagingDevice::bufferSubData(VulkanBuffer& buffer, const void* data, const std::vector<BufferRange>& ranges)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+		size_t totalSize = 0;
+		for (const BufferRange& range : ranges)
+		{
+			GAIA_ASSERT(range.offset + range.size <= buffer.bufferSize_, "the range is outside of the buffer");
+			totalSize += range.size;
+		}
+		if (totalSize == 0)
+		{
+			return;
+		}
+		if (buffer.isMapped() || totalSize > stagingBufferSize)
+		{
+			for (const BufferRange& range : ranges)
+				bufferSubData(buffer, range.offset, range.size, src + range.offset);
+			return;
+		}
+
+		//the ranges are packed back to back in one region
+		VulkanBuffer* staging = ctx_.bufferPool_.get(stagingBuffer_);
+		MemoryRegion region = allocate(totalSize);
+		std::vector<VkBufferCopy> bufferCopies;
+		bufferCopies.reserve(ranges.size());
+		VkDeviceSize srcOffset = region.offset;
+		for (const BufferRange& range : ranges)
+		{
+			if (range.size == 0)
+				continue;
+			staging->bufferSubData(ctx_, srcOffset, range.size, src + range.offset);
+			bufferCopies.push_back(VkBufferCopy{
+				.srcOffset = srcOffset,
+				.dstOffset = range.offset,
+				.size = range.size,
+				});
+			srcOffset += range.size;
+		}
+		vkCmdCopyBuffer(wrapper_->cmdBuffer_, staging->vkBuffer_, buffer.vkBuffer_, static_cast<uint32_t>(bufferCopies.size()), bufferCopies.data());
+	}
+	void VulkanStagingDevice::imageData(VulkanImage& image, const void* data, size_t size, const std::vector<uint64_t>& levelOffsets, uint32_t layer)
+	{
+		GAIA_ASSERT(!levelOffsets.empty() && levelOffsets.size() <= image.numLevels_, "the level offsets do not match the mip levels of the image");
+		GAIA_ASSERT(layer < image.numLayers_, "the layer is outside of the image");
+		GAIA_ASSERT(image.vkType_ == VK_IMAGE_TYPE_2D, "only 2D images are uploaded through the staging ring");
+
+		VulkanBuffer* staging = ctx_.bufferPool_.get(stagingBuffer_);
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+		const VkImageSubresourceRange range{
+			.aspectMask = image.getImageAspectFlags(),
+			.baseMipLevel = 0,
+			.levelCount = image.numLevels_,
+			.baseArrayLayer = 0,
+			.layerCount = image.numLayers_,
+		};
+		image.transitionLayout(getCommandBuffer(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, range);
+
+		//levels that do not fit in the ring are copied in bands of rows (rows of 4x4 blocks for block compressed formats)
+		const bool isBlockCompressed = image.vkImageFormat_ >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && image.vkImageFormat_ <= VK_FORMAT_BC7_SRGB_BLOCK;
+		const uint32_t blockHeight = isBlockCompressed ? 4 : 1;
+		for (uint32_t level = 0; level < levelOffsets.size(); level++)
+		{
+			const uint64_t levelEnd = level + 1 < levelOffsets.size() ? levelOffsets[level + 1] : size;
+			const uint64_t levelSize = levelEnd - levelOffsets[level];
+			const uint32_t width = std::max(image.vkExtent_.width >> level, 1u);
+			const uint32_t height = std::max(image.vkExtent_.height >> level, 1u);
+			const uint32_t numRows = (height + blockHeight - 1) / blockHeight;
+			const uint64_t rowSize = levelSize / numRows;
+			GAIA_ASSERT(rowSize > 0 && rowSize <= stagingBufferSize, "a row of the image is larger than the staging ring");
+			const uint32_t rowsPerCopy = uint32_t(std::min<uint64_t>(stagingBufferSize / rowSize, numRows));
+
+			for (uint32_t row = 0; row < numRows; row += rowsPerCopy)
+			{
+				const uint32_t numCopyRows = std::min(rowsPerCopy, numRows - row);
+				MemoryRegion region = allocate(numCopyRows * rowSize);
+				staging->bufferSubData(ctx_, region.offset, numCopyRows * rowSize, src + levelOffsets[level] + row * rowSize);
+
+				VkBufferImageCopy bufferImageCopy{
+					.bufferOffset = region.offset,
+					.bufferRowLength = 0,
+					.bufferImageHeight = 0,
+					.imageSubresource = VkImageSubresourceLayers{
+						.aspectMask = image.getImageAspectFlags(),
+						.mipLevel = level,
+						.baseArrayLayer = layer,
+						.layerCount = 1,
+					},
+					.imageOffset = {0, int32_t(row * blockHeight), 0},
+					.imageExtent = {width, std::min(numCopyRows * blockHeight, height - row * blockHeight), 1},
+				};
+				vkCmdCopyBufferToImage(wrapper_->cmdBuffer_, staging->vkBuffer_, image.vkImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+			}
+		}
+		image.transitionLayout(getCommandBuffer(), VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, range);
+	}
 	/*VulkanDescriptorSet::VulkanDescriptorSet(VkDevice device,VulkanContext& ctx, VulkanDescriptorSetLayout layout, const char* debugName)
 		: device_(device), ctx_(ctx), debugName_(debugName), layout_(layout)
 	{
@@ -2911,6 +3281,23 @@ if(shaderModuleState)\
 		}
 		vkUpdateDescriptorSets(device_, writes_.size(), writes_.data(), 0, nullptr);
 	}
+	void VulkanDescriptorSet::updateTexture(uint32_t binding, uint32_t arrayElement, const VulkanImage& image)
+	{
+		auto write = std::find_if(writes_.begin(), writes_.end(), [&](const VkWriteDescriptorSet& w) { return w.dstBinding == binding; });
+		GAIA_ASSERT(write != writes_.end() && write->pImageInfo && arrayElement < write->descriptorCount, "the binding has no texture at this element");
+
+		//keep the cached info in sync so a later updateSet() writes the new texture as well
+		VkDescriptorImageInfo& info = imageInfo[(write->pImageInfo - imageInfo.data()) + arrayElement];
+		info.imageView = image.imageView_;
+		info.imageLayout = image.vkImageLayout_;
+
+		VkWriteDescriptorSet elementWrite = *write;
+		elementWrite.dstSet = set_;
+		elementWrite.dstArrayElement = arrayElement;
+		elementWrite.descriptorCount = 1;
+		elementWrite.pImageInfo = &info;
+		vkUpdateDescriptorSets(device_, 1, &elementWrite, 0, nullptr);
+	}
 	void VulkanDescriptorSet::allocatePool()
 	{
 		//create pool
@@ -2993,6 +3380,62 @@ if(shaderModuleState)\
 
 		vkCmdCopyBuffer(commandBufferWraper_->cmdBuffer_, srcBuffer->vkBuffer_, dstBuffer->vkBuffer_, 1, &bufferCopy);
 	}
+	void VulkanCommandBuffer::cmdFillBuffer(BufferHandle bufferHandle, size_t offset, size_t size, uint32_t value)
+	{
+		VulkanBuffer* buffer = ctx_->bufferPool_.get(bufferHandle);
+		GAIA_ASSERT(buffer, "invalid buffer");
+		vkCmdFillBuffer(commandBufferWraper_->cmdBuffer_, buffer->vkBuffer_, offset, size, value);
+
+		VkMemoryBarrier2 barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		};
+		VkDependencyInfo depInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &barrier,
+		};
+		vkCmdPipelineBarrier2(commandBufferWraper_->cmdBuffer_, &depInfo);
+	}
+	void VulkanCommandBuffer::cmdBufferBarrier(BufferHandle bufferHandle, uint8_t srcStages, uint8_t dstStages)
+	{
+		VulkanBuffer* buffer = ctx_->bufferPool_.get(bufferHandle);
+		GAIA_ASSERT(buffer, "invalid buffer");
+		auto getVkStages = [](uint8_t stages) {
+			VkPipelineStageFlags2 flags = VK_PIPELINE_STAGE_2_NONE;
+			if (stages & PipelineStageBits_Transfer)
+				flags |= VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+			if (stages & PipelineStageBits_ComputeShader)
+				flags |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+			if (stages & PipelineStageBits_DrawIndirect)
+				flags |= VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+			if (stages & PipelineStageBits_AllGraphics)
+				flags |= VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+			return flags;
+			};
+
+		VkBufferMemoryBarrier2 barrier{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			.srcStageMask = getVkStages(srcStages),
+			.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+			.dstStageMask = getVkStages(dstStages),
+			.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = buffer->vkBuffer_,
+			.offset = 0,
+			.size = VK_WHOLE_SIZE,
+		};
+		VkDependencyInfo depInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.bufferMemoryBarrierCount = 1,
+			.pBufferMemoryBarriers = &barrier,
+		};
+		vkCmdPipelineBarrier2(commandBufferWraper_->cmdBuffer_, &depInfo);
+	}
 	void VulkanCommandBuffer::cmdTransitionImageLayout(TextureHandle imageHandle, ImageLayout newLayout)
 	{
 		VulkanImage* vkImage = ctx_->texturesPool_.get(imageHandle);
@@ -3196,6 +3639,36 @@ if(shaderModuleState)\
 
 		vkCmdCopyBufferToImage(commandBufferWraper_->cmdBuffer_, buffer->vkBuffer_, image->vkImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
 	}
+	void VulkanCommandBuffer::cmdCopyBufferToImage(BufferHandle bufferHandle, TextureHandle textureHandle, const std::vector<uint64_t>& levelOffsets)
+	{
+		VulkanBuffer* buffer = ctx_->bufferPool_.get(bufferHandle);
+		VulkanImage* image = ctx_->texturesPool_.get(textureHandle);
+		GAIA_ASSERT(levelOffsets.size() <= image->numLevels_, "more mip levels are copied than the image has");
+
+		//one region per mip level, all of them are recorded in a single copy
+		std::vector<VkBufferImageCopy> regions(levelOffsets.size());
+		for (uint32_t level = 0; level < levelOffsets.size(); level++)
+		{
+			regions[level] = VkBufferImageCopy{
+				.bufferOffset = levelOffsets[level],
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = VkImageSubresourceLayers{
+					.aspectMask = image->getImageAspectFlags(),
+					.mipLevel = level,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+				.imageOffset = {0,0,0},
+				.imageExtent = VkExtent3D{
+					.width = std::max(image->vkExtent_.width >> level, 1u),
+					.height = std::max(image->vkExtent_.height >> level, 1u),
+					.depth = std::max(image->vkExtent_.depth >> level, 1u),
+				},
+			};
+		}
+		vkCmdCopyBufferToImage(commandBufferWraper_->cmdBuffer_, buffer->vkBuffer_, image->vkImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+	}
 	void VulkanCommandBuffer::cmdCopyImageToImage(TextureHandle srcImageHandle, TextureHandle dstImageHandle)
 	{
 		VulkanImage* srcImage = ctx_->texturesPool_.get(srcImageHandle);
@@ -3330,7 +3803,25 @@ if(shaderModuleState)\
 	}
 	void VulkanCommandBuffer::cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t firstInstance)
 	{
-		vkCmdDrawIndexed(commandBufferWraper_->cmdBuffer_, indexCount, instanceCount, firstInstance, vertexOffset, firstInstance);
+		vkCmdDrawIndexed(commandBufferWraper_->cmdBuffer_, indexCount, instanceCount, firstIndex, static_cast<int32_t>(vertexOffset), firstInstance);
+	}
+	void VulkanCommandBuffer::cmdDrawIndexedIndirect(BufferHandle indirectBuffer, size_t bufferOffset, uint32_t drawCount, uint32_t stride)
+	{
+		if (drawCount == 0)
+			return;
+		VulkanBuffer* buffer = ctx_->bufferPool_.get(indirectBuffer);
+		GAIA_ASSERT(buffer, "invalid indirect buffer");
+		vkCmdDrawIndexedIndirect(commandBufferWraper_->cmdBuffer_, buffer->vkBuffer_, bufferOffset, drawCount, stride);
+	}
+	void VulkanCommandBuffer::cmdDrawIndexedIndirectCount(BufferHandle indirectBuffer, size_t bufferOffset, BufferHandle countBuffer, size_t countBufferOffset,
+		uint32_t maxDrawCount, uint32_t stride)
+	{
+		if (maxDrawCount == 0)
+			return;
+		VulkanBuffer* buffer = ctx_->bufferPool_.get(indirectBuffer);
+		VulkanBuffer* counts = ctx_->bufferPool_.get(countBuffer);
+		GAIA_ASSERT(buffer && counts, "invalid indirect buffer");
+		vkCmdDrawIndexedIndirectCount(commandBufferWraper_->cmdBuffer_, buffer->vkBuffer_, bufferOffset, counts->vkBuffer_, countBufferOffset, maxDrawCount, stride);
 	}
 	void VulkanCommandBuffer::cmdBindComputePipeline(ComputePipelineHandle handle)
 	{
@@ -115,6 +115,7 @@ namespace Gaia {
 		uint32_t numAttributes_ = 0;
 		VkVertexInputAttributeDescription vkAttributes_[VertexInput::MAX_NUM_VERTEX_ATTRIBUTES] = {};
 		VkVertexInputBindingDescription vkBindings_[VertexInput::MAX_NUM_VERTEX_BINDINGS] = {};
+		std::vector<uint8_t> specConstantData_; //desc_.specInfo.data points here
 
 		VkPipeline pipeline_ = VK_NULL_HANDLE;
 		VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
@@ -230,7 +231,7 @@ namespace Gaia {
 		VkSwapchainKHR vkSwapchain_ = VK_NULL_HANDLE;
 		VkSurfaceFormatKHR surfaceFormat_ = { .format = VK_FORMAT_UNDEFINED };
 		TextureHandle swapchainTextures_[MAX_SWAPCHAIN_IMAGES] = {};
-		VkSemaphore acquireSemaphore_ = VK_NULL_HANDLE;
+		VkSemaphore acquireSemaphores_[MAX_FRAMES_IN_FLIGHT] = {}; //one per frame in flight, the present submit of the slot waits on it
 
 		uint32_t width_ = 0;
 		uint32_t height_ = 0;
@@ -239,24 +240,12 @@ namespace Gaia {
 		uint64_t currentFrameIndex_ = 0; // [0...+inf)
 	};
 
+	//runs once the command buffers recorded up to handle_ are done with the resource
 	struct DeferredTask final {
-		DeferredTask(std::packaged_task<void()>&& task) : task_(std::move(task))
+		DeferredTask(std::packaged_task<void()>&& task, SubmitHandle handle) : task_(std::move(task)), handle_(handle)
 		{}
 		std::packaged_task<void()> task_;
-	};
-
-	struct SubmitHandle final
-	{
-		uint32_t bufferIndex_ = 0;
-		uint32_t submitId_ = 0;
-		SubmitHandle() = default;
-		explicit SubmitHandle(uint32_t handle) : bufferIndex_(uint32_t(handle & 0xffffffff)), submitId_(uint32_t(handle >> 32)) {}
-		bool empty() const {
-			return submitId_ == 0;
-		}
-		uint64_t handle() const {
-			return ((uint64_t)submitId_ << 32) + bufferIndex_;
-		}
+		SubmitHandle handle_;
 	};
 	//simple command buffer setup inspired from lightweightVK
 	/*
@@ -324,6 +313,46 @@ namespace Gaia {
 		uint32_t submitCounter_ = 1;
 	};
 
+	//persistent host visible ring buffer that buffer and image uploads go through (like the staging device of lightweightVK).
+	//Copies are recorded into one open command buffer that is submitted without waiting, a region of the ring is
+	//reused once the fence of the submit that read it has signaled
+	class VulkanStagingDevice final
+	{
+	public:
+		static constexpr VkDeviceSize stagingBufferSize = 128ull * 1024ull * 1024ull;
+		static constexpr VkDeviceSize regionAlignment = 16;
+
+		explicit VulkanStagingDevice(VulkanContext& ctx);
+		~VulkanStagingDevice();
+		VulkanStagingDevice(const VulkanStagingDevice&) = delete;
+		VulkanStagingDevice& operator=(const VulkanStagingDevice&) = delete;
+
+		void bufferSubData(VulkanBuffer& buffer, size_t dstOffset, size_t size, const void* data);
+		//copies ranges of data to the same offsets in buffer, ranges that fit the ring together share one region and one vkCmdCopyBuffer
+		void bufferSubData(VulkanBuffer& buffer, const void* data, const std::vector<BufferRange>& ranges);
+		//levelOffsets[i] is where mip level i starts in data, the image is left in VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL
+		void imageData(VulkanImage& image, const void* data, size_t size, const std::vector<uint64_t>& levelOffsets, uint32_t layer = 0);
+		//submits the recorded copies without waiting for them, returns an empty handle if nothing was recorded
+		SubmitHandle flush();
+
+	private:
+		struct MemoryRegion
+		{
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			SubmitHandle handle = {};
+		};
+		MemoryRegion allocate(VkDeviceSize size);
+		VkCommandBuffer getCommandBuffer();
+
+	private:
+		VulkanContext& ctx_;
+		Holder<BufferHandle> stagingBuffer_;
+		VkDeviceSize head_ = 0;
+		std::deque<MemoryRegion> regions_; //regions still read by the gpu, oldest first
+		const VulkanImmediateCommands::CommandBufferWrapper* wrapper_ = nullptr; //open batch, nullptr if nothing is recorded
+	};
+
 	struct VulkanDescriptorSetLayout final
 	{
 		VkDescriptorSetLayout descSetLayout;
@@ -339,6 +368,7 @@ namespace Gaia {
 		
 		void write(DescriptorSetLayoutDesc& desc, VulkanContext& ctx_);
 		void updateSet();
+		void updateTexture(uint32_t binding, uint32_t arrayElement, const VulkanImage& image);
 		void allocatePool();
 		VkDescriptorPool getPool() { return pool_; }
 		VkDescriptorSet getSet() { return set_; }
@@ -387,7 +417,10 @@ namespace Gaia {
 		void cmdEndRendering() override;
 
 		void cmdCopyBufferToBuffer(BufferHandle srcBufferHandle, BufferHandle dstBufferHandle, uint32_t offset = 0) override;
+		void cmdFillBuffer(BufferHandle buffer, size_t offset, size_t size, uint32_t value) override;
+		void cmdBufferBarrier(BufferHandle buffer, uint8_t srcStages, uint8_t dstStages) override;
 		void cmdCopyBufferToImage(BufferHandle buffer, TextureHandle texture) override;
+		void cmdCopyBufferToImage(BufferHandle buffer, TextureHandle texture, const std::vector<uint64_t>& levelOffsets) override;
 		void cmdCopyImageToImage(TextureHandle srcImageHandle, TextureHandle dstImageHandle) override;
 
 		void cmdSetViewport(Viewport viewport) override;
@@ -405,6 +438,9 @@ namespace Gaia {
 
 		void cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) override;
 		void cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t firstInstance) override;
+		void cmdDrawIndexedIndirect(BufferHandle indirectBuffer, size_t bufferOffset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) override;
+		void cmdDrawIndexedIndirectCount(BufferHandle indirectBuffer, size_t bufferOffset, BufferHandle countBuffer, size_t countBufferOffset,
+			uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) override;
 
 		void cmdBindComputePipeline(ComputePipelineHandle handle) override;
 		void cmdDispatch(uint32_t workGroupSizeX, uint32_t workGroupSizeY, uint32_t workGroupSizeZ) override;
@@ -437,8 +473,17 @@ namespace Gaia {
 		~VulkanContext();
 
 		ICommandBuffer& acquireCommandBuffer() override;
-		void submit(ICommandBuffer& cmd, TextureHandle presentTexture) override;
-		void submit(ICommandBuffer& cmd) override;
+		SubmitHandle submit(ICommandBuffer& cmd, TextureHandle presentTexture) override;
+		SubmitHandle submit(ICommandBuffer& cmd) override;
+
+		void upload(BufferHandle handle, const void* data, size_t size, size_t offset = 0) override;
+		void upload(BufferHandle handle, const void* data, const std::vector<BufferRange>& ranges) override;
+		void upload(TextureHandle handle, const void* data, size_t size, const std::vector<uint64_t>& levelOffsets, uint32_t layer = 0) override;
+		void flushUploads() override;
+
+		SubmitHandle getLastSubmitHandle() const override;
+		void wait(SubmitHandle handle) override;
+		void deferredTask(std::packaged_task<void()>&& task, SubmitHandle handle = SubmitHandle()) override;
 
 		std::pair<uint32_t, uint32_t> getWindowSize() override;
 
@@ -473,8 +518,15 @@ namespace Gaia {
 		uint64_t gpuAddress(BufferHandle handle, size_t offset = 0) override;
 		uint64_t gpuAddress(AccelStructHandle handle)override;
 
+		uint8_t* getMappedPtr(BufferHandle handle) override;
+		void flushMappedMemory(BufferHandle handle, size_t offset, size_t size) override;
+		void invalidateMappedMemory(BufferHandle handle, size_t offset, size_t size) override;
+		void updateDescriptorSet(DescriptorSetLayoutHandle handle, uint32_t binding, uint32_t arrayElement, TextureHandle texture) override;
+
 		VulkanDescriptorSet* getDescriptorSet(DescriptorSetLayoutHandle handle);
 		uint32_t getFrameBufferMSAABitMask() const override;
+		uint32_t getFrameInFlight() const override;
+		bool supportsDrawIndirectCount() const override;
 
 		VkInstance getInstance()
 		{
@@ -511,6 +563,8 @@ namespace Gaia {
 
 	private:
 		int window_width = 0, window_height = 0;
+		uint32_t frameInFlight_ = 0;
+		SubmitHandle frameSubmits_[MAX_FRAMES_IN_FLIGHT] = {}; //present submit of the last frame recorded in each slot
 		VkInstance vkInstance_ = VK_NULL_HANDLE;
 		VkSurfaceKHR vkSurface_ = VK_NULL_HANDLE;
 		VkPhysicalDevice vkPhysicsalDevice_ = VK_NULL_HANDLE;
@@ -529,7 +583,7 @@ namespace Gaia {
 
 		std::deque<DeferredTask> deferredTask_;
 		void waitForDeferredTasks();
-		void deferredTask(std::packaged_task<void()>&& task);
+		void processDeferredTasks();
 		inline uint32_t getAlignedSize(uint32_t value, uint32_t alignment)
 		{
 			return (value + alignment - 1) & ~(alignment - 1);
@@ -538,6 +592,7 @@ namespace Gaia {
 		DeviceQueues deviceQueues_;
 		std::unique_ptr<VulkanSwapchain> swapchain_;
 		std::unique_ptr<VulkanImmediateCommands> immediateCommands_;
+		std::unique_ptr<VulkanStagingDevice> stagingDevice_;
 		VkSemaphore renderingSemaphore_ = VK_NULL_HANDLE;
 
 		Pool<Texture, VulkanImage> texturesPool_;
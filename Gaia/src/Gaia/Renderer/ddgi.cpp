@@ -306,7 +306,8 @@ namespace Gaia
 		rayGenSM.pushConstantSize = sizeof(PushConstant);
 		ShaderModuleDesc missSM = ShaderModuleDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/gi_rayMiss.rmiss.spv", Stage_Miss);
 		ShaderModuleDesc missShadowSM = ShaderModuleDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/gi_rayMissShadow.rmiss.spv", Stage_Miss);
-		ShaderModuleDesc closestHitSM = ShaderModuleDesc("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/gi_closestHit.rchit.spv", Stage_ClosestHit);
+		std::string closestHitPath = Renderer::getVertexShaderPath("E:/Gaia/Gaia/src/Gaia/Renderer/Shaders/gi_closestHit.rchit.spv", true);
+		ShaderModuleDesc closestHitSM = ShaderModuleDesc(closestHitPath.c_str(), Stage_ClosestHit);
 		closestHitSM.pushConstantSize = sizeof(PushConstant);
 
 		rayGenShader = context->createShaderModule(rayGenSM);
@@ -1,12 +1,103 @@
 #include "pch.h"
 #include "Scene.h"
+#include <emmintrin.h>
 
 namespace Gaia {
+	namespace
+	{
+		//levels with fewer nodes are cheaper to update on the calling thread
+		constexpr uint32_t MIN_PARALLEL_LEVEL_SIZE = 2048;
+		//updated ranges closer than this many nodes are uploaded as one, the few clean transforms in between cost less than another copy
+		constexpr uint32_t TRANSFORM_RANGE_GAP = 8;
+
+		//column major parent * local with SSE, every column of the result is a sum of the parent columns
+		inline void multiplyTransforms(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result)
+		{
+			const float* a = &parent[0][0];
+			const float* b = &local[0][0];
+			float* out = &result[0][0];
+			const __m128 a0 = _mm_loadu_ps(a);
+			const __m128 a1 = _mm_loadu_ps(a + 4);
+			const __m128 a2 = _mm_loadu_ps(a + 8);
+			const __m128 a3 = _mm_loadu_ps(a + 12);
+			for (int column = 0; column < 4; column++)
+			{
+				const float* bc = b + column * 4;
+				__m128 sum = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+				sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+				sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+				sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+				_mm_storeu_ps(out + column * 4, sum);
+			}
+		}
+
+		//Arvo's method, the world box is centered on the transformed center and the extent goes through the absolute 3x3 part
+		inline SceneBounds transformBounds(const glm::mat4& transform, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+		{
+			const glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+			const glm::vec3 extent = 0.5f * (boundsMax - boundsMin);
+			const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+			const glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x
+				+ glm::abs(glm::vec3(transform[1])) * extent.y
+				+ glm::abs(glm::vec3(transform[2])) * extent.z;
+			return SceneBounds{ .min = worldCenter - worldExtent, .max = worldCenter + worldExtent };
+		}
+
+		inline void growBounds(SceneBounds& bounds, const SceneBounds& other)
+		{
+			bounds.min = glm::min(bounds.min, other.min);
+			bounds.max = glm::max(bounds.max, other.max);
+		}
+	}
+
 	Scene::Scene(const SceneDescriptor& desc) : sceneDesc_(desc)
 	{
 		mainCamera_ = std::make_unique<EditorCamera>(desc.windowWidth, desc.windowHeight);
-		mesh_ = std::make_unique<LoadMesh>(desc.meshPath);
+		mesh_ = std::make_unique<LoadMesh>(desc.meshPath, desc.meshLoadOptions);
+		buildTransformLevels();
+		buildBoundsHierarchy();
+	}
+
+	void Scene::buildTransformLevels()
+	{
+		//the loader sorts the nodes by level, so every level is one range
+		const std::vector<Hierarchy>& hierarchy = mesh_->m_hierarchy;
+		levelOffsets_.clear();
+		for (uint32_t node = 0; node < hierarchy.size(); node++)
+		{
+			GAIA_ASSERT(node == 0 || hierarchy[node].level >= hierarchy[node - 1].level, "the scene hierarchy is not sorted by level");
+			while (levelOffsets_.size() <= static_cast<size_t>(hierarchy[node].level))
+				levelOffsets_.push_back(node);
+		}
+		levelOffsets_.push_back(static_cast<uint32_t>(hierarchy.size()));
+		dirtyNodes_.assign(hierarchy.size(), 0);
+	}
+
+	void Scene::buildBoundsHierarchy()
+	{
+		//sub meshes grouped by the node whose transform they use, the local boxes were computed at import
+		const std::vector<SubMesh>& subMeshes = mesh_->m_subMeshes;
+		const size_t numNodes = mesh_->m_hierarchy.size();
+		subMeshOffsets_.assign(numNodes + 1, 0);
+		for (const SubMesh& subMesh : subMeshes)
+		{
+			GAIA_ASSERT(subMesh.meshIndex >= 0 && static_cast<size_t>(subMesh.meshIndex) < numNodes, "sub mesh without a hierarchy node");
+			subMeshOffsets_[subMesh.meshIndex + 1]++;
+		}
+		for (size_t node = 0; node < numNodes; node++)
+			subMeshOffsets_[node + 1] += subMeshOffsets_[node];
+		nodeSubMeshes_.resize(subMeshes.size());
+		std::vector<uint32_t> next(subMeshOffsets_.begin(), subMeshOffsets_.end() - 1);
+		for (uint32_t i = 0; i < subMeshes.size(); i++)
+			nodeSubMeshes_[next[subMeshes[i].meshIndex]++] = i;
+
+		//the first refit fits every node
+		nodeBounds_.assign(numNodes, SceneBounds{});
+		dirtyBounds_.assign(numNodes, 1);
+		hasDirtyBounds_ = numNodes > 0;
+		updateSceneBounds();
 	}
+
 	Scene::~Scene()
 	{
 	}
@@ -24,33 +115,135 @@ namespace Gaia {
 	{
 		isTransformUpdated_ = true;
 		mesh_->localTransforms[nodeHierarchyIndex] = newTransform;
-		updateTransform(nodeHierarchyIndex);
+		dirtyNodes_[nodeHierarchyIndex] = 1;
+		firstDirtyLevel_ = std::min(firstDirtyLevel_, static_cast<uint32_t>(mesh_->m_hierarchy[nodeHierarchyIndex].level));
 	}
 
 	glm::mat4 Scene::getGlobalTransform(int nodeHierarchyIndex)
 	{
+		updateTransforms();
 		return mesh_->globalTransforms[nodeHierarchyIndex];
 	}
 
-	void Scene::updateTransform(int nodeIndex)
+	void Scene::updateTransforms()
+	{
+		if (firstDirtyLevel_ == NO_DIRTY_LEVEL)
+			return;
+		const std::vector<Hierarchy>& hierarchy = mesh_->m_hierarchy;
+		const std::vector<glm::mat4>& localTransforms = mesh_->localTransforms;
+		std::vector<glm::mat4>& globalTransforms = mesh_->globalTransforms;
+
+		//a node is dirty if it was edited or its parent was recomputed, parents are one level up and already final
+		auto updateNode = [&](uint32_t node) {
+			const int parent = hierarchy[node].parent;
+			if (parent != -1 && dirtyNodes_[parent])
+				dirtyNodes_[node] = 1;
+			if (!dirtyNodes_[node])
+				return;
+			if (parent != -1)
+				multiplyTransforms(globalTransforms[parent], localTransforms[node], globalTransforms[node]);
+			else
+				globalTransforms[node] = localTransforms[node];
+			};
+		for (size_t level = firstDirtyLevel_; level + 1 < levelOffsets_.size(); level++)
+		{
+			auto iter = std::views::iota(levelOffsets_[level], levelOffsets_[level + 1]);
+			if (levelOffsets_[level + 1] - levelOffsets_[level] >= MIN_PARALLEL_LEVEL_SIZE)
+				std::for_each(std::execution::par, iter.begin(), iter.end(), updateNode);
+			else
+				std::for_each(iter.begin(), iter.end(), updateNode);
+		}
+
+		//the recomputed nodes of a subtree are runs inside every level, since the nodes of a level keep their import order
+		for (uint32_t node = levelOffsets_[firstDirtyLevel_]; node < dirtyNodes_.size(); node++)
+		{
+			if (!dirtyNodes_[node])
+				continue;
+			if (!updatedTransforms_.empty() && updatedTransforms_.back().first + updatedTransforms_.back().count == node)
+				updatedTransforms_.back().count++;
+			else
+				updatedTransforms_.push_back(TransformRange{ .first = node, .count = 1 });
+			dirtyNodes_[node] = 0;
+
+			//the walk stops at the first marked ancestor, so every node is marked once
+			for (int ancestor = static_cast<int>(node); ancestor != -1 && !dirtyBounds_[ancestor]; ancestor = hierarchy[ancestor].parent)
+				dirtyBounds_[ancestor] = 1;
+			hasDirtyBounds_ = true;
+		}
+		firstDirtyLevel_ = NO_DIRTY_LEVEL;
+	}
+
+	std::vector<TransformRange> Scene::takeUpdatedTransforms()
 	{
-		if (nodeIndex == -1)
+		updateTransforms();
+		std::vector<TransformRange> ranges = std::move(updatedTransforms_);
+		updatedTransforms_.clear();
+		std::sort(ranges.begin(), ranges.end(), [](const TransformRange& a, const TransformRange& b) { return a.first < b.first; });
+
+		size_t numMerged = 0;
+		for (const TransformRange& range : ranges)
 		{
+			if (numMerged > 0 && range.first <= ranges[numMerged - 1].first + ranges[numMerged - 1].count + TRANSFORM_RANGE_GAP)
+			{
+				TransformRange& merged = ranges[numMerged - 1];
+				merged.count = std::max(merged.first + merged.count, range.first + range.count) - merged.first;
+			}
+			else
+			{
+				ranges[numMerged++] = range;
+			}
+		}
+		ranges.resize(numMerged);
+		return ranges;
+	}
+
+	void Scene::updateSceneBounds()
+	{
+		updateTransforms();
+		if (!hasDirtyBounds_)
 			return;
+		const std::vector<Hierarchy>& hierarchy = mesh_->m_hierarchy;
+		const std::vector<SubMesh>& subMeshes = mesh_->m_subMeshes;
+		const std::vector<glm::mat4>& globalTransforms = mesh_->globalTransforms;
+
+		//children are one level down, so going from the deepest level up every child box is final before its parent is refitted
+		auto refitNode = [&](uint32_t node) {
+			if (!dirtyBounds_[node])
+				return;
+			SceneBounds bounds = {};
+			for (uint32_t i = subMeshOffsets_[node]; i < subMeshOffsets_[node + 1]; i++)
+			{
+				const SubMesh& subMesh = subMeshes[nodeSubMeshes_[i]];
+				if (glm::all(glm::lessThanEqual(subMesh.boundsMin, subMesh.boundsMax)))
+					growBounds(bounds, transformBounds(globalTransforms[node], subMesh.boundsMin, subMesh.boundsMax));
+			}
+			for (int child = hierarchy[node].firstChild; child != -1; child = hierarchy[child].nextSibling)
+				growBounds(bounds, nodeBounds_[child]);
+			nodeBounds_[node] = bounds;
+			dirtyBounds_[node] = 0;
+			};
+		for (size_t level = levelOffsets_.size() - 1; level-- > 0;)
+		{
+			auto iter = std::views::iota(levelOffsets_[level], levelOffsets_[level + 1]);
+			if (levelOffsets_[level + 1] - levelOffsets_[level] >= MIN_PARALLEL_LEVEL_SIZE)
+				std::for_each(std::execution::par, iter.begin(), iter.end(), refitNode);
+			else
+				std::for_each(iter.begin(), iter.end(), refitNode);
 		}
-		Hierarchy& current_hierarchy = mesh_->m_hierarchy[nodeIndex];
-		if (current_hierarchy.parent != -1)
-			mesh_->globalTransforms[nodeIndex] = mesh_->globalTransforms[current_hierarchy.parent] * mesh_->localTransforms[nodeIndex];
-		else
-			mesh_->globalTransforms[nodeIndex] = mesh_->localTransforms[nodeIndex];
 
-		updateTransform(current_hierarchy.firstChild);
-		updateTransform(current_hierarchy.nextSibling);
+		mesh_->sceneBounds_ = {};
+		if (levelOffsets_.size() > 1)
+		{
+			for (uint32_t root = levelOffsets_[0]; root < levelOffsets_[1]; root++)
+				growBounds(mesh_->sceneBounds_, nodeBounds_[root]);
+		}
+		hasDirtyBounds_ = false;
 	}
 
 	void Scene::update(TimeStep ts)
 	{
 		mainCamera_->OnUpdate(ts);
+		updateTransforms();
 	}
 	void Scene::onEvent(Event& event)
 	{
@@ -1,6 +1,7 @@
 #pragma once
 #include "Gaia/Renderer/Cameras/EditorCamera.h"
 #include "Gaia/LoadMesh.h"
+#include "Gaia/VertexFormat.h"
 #include "Gaia/TimeSteps.h"
 #include "Gaia/Events/Event.h"
 
@@ -12,7 +13,13 @@ namespace Gaia
 		std::string meshPath = "";
 		uint32_t windowWidth = 0;
 		uint32_t windowHeight = 0;
-
+		MeshLoadOptions meshLoadOptions = {};
+		VertexFormat vertexFormat = VertexFormat_Full; //layout the renderer uploads the vertices in
+	};
+	//nodes [first, first + count) whose global transforms changed, see Scene::takeUpdatedTransforms
+	struct TransformRange {
+		uint32_t first = 0;
+		uint32_t count = 0;
 	};
 	struct LightParameters {
 		glm::vec3 color = glm::vec4(1.0);
@@ -29,22 +36,44 @@ namespace Gaia
 		{
 			mainCamera_.reset(other.mainCamera_.get());
 			mesh_.reset(other.mesh_.get());
+			levelOffsets_ = std::move(other.levelOffsets_);
+			dirtyNodes_ = std::move(other.dirtyNodes_);
+			firstDirtyLevel_ = other.firstDirtyLevel_;
+			updatedTransforms_ = std::move(other.updatedTransforms_);
+			nodeBounds_ = std::move(other.nodeBounds_);
+			subMeshOffsets_ = std::move(other.subMeshOffsets_);
+			nodeSubMeshes_ = std::move(other.nodeSubMeshes_);
+			dirtyBounds_ = std::move(other.dirtyBounds_);
+			hasDirtyBounds_ = other.hasDirtyBounds_;
 
-			other.mainCamera_.reset();
-			other.mesh_.reset();
+			other.mainCamera_.release();
+			other.mesh_.release();
 			other.sceneDesc_ = {};
+			other.firstDirtyLevel_ = NO_DIRTY_LEVEL;
+			other.hasDirtyBounds_ = false;
 		}
 		Scene& operator=(Scene&) = delete;
 		Scene& operator=(Scene&& other)
 		{
 			mainCamera_.reset(other.mainCamera_.get());
 			mesh_.reset(other.mesh_.get());
+			levelOffsets_ = std::move(other.levelOffsets_);
+			dirtyNodes_ = std::move(other.dirtyNodes_);
+			firstDirtyLevel_ = other.firstDirtyLevel_;
+			updatedTransforms_ = std::move(other.updatedTransforms_);
+			nodeBounds_ = std::move(other.nodeBounds_);
+			subMeshOffsets_ = std::move(other.subMeshOffsets_);
+			nodeSubMeshes_ = std::move(other.nodeSubMeshes_);
+			dirtyBounds_ = std::move(other.dirtyBounds_);
+			hasDirtyBounds_ = other.hasDirtyBounds_;
 
 			sceneDesc_ = other.sceneDesc_;
 
-			other.mainCamera_.reset();
-			other.mesh_.reset();
+			other.mainCamera_.release();
+			other.mesh_.release();
 			other.sceneDesc_ = {};
+			other.firstDirtyLevel_ = NO_DIRTY_LEVEL;
+			other.hasDirtyBounds_ = false;
 			return *this;
 		}
 		Scene(const SceneDescriptor& desc);
@@ -52,22 +81,39 @@ namespace Gaia
 		static std::shared_ptr<Scene> create(const SceneDescriptor& desc);
 		inline EditorCamera& getMainCamera() const { return *mainCamera_; }
 		inline std::vector<Hierarchy>& getHirarchy() { return mesh_->m_hierarchy; }
-		inline std::vector<glm::mat4>& getGlobalTransforms() { return mesh_->globalTransforms; }
+		inline std::vector<glm::mat4>& getGlobalTransforms() { updateTransforms(); return mesh_->globalTransforms; }
 		inline std::vector<glm::mat4>& getLocalTransforms() { return mesh_->localTransforms; }
 		inline std::vector<std::string>& getNodeNames() { return mesh_->m_nodeNames; }
-		inline std::unordered_map<int,SubMesh>& getMeshes() { return mesh_->m_subMeshes; }
+		inline std::vector<SubMesh>& getMeshes() { return mesh_->m_subMeshes; }
+		inline std::span<LoadMesh::VertexAttributes> getVertices() { return mesh_->getVertices(); }
+		inline std::span<uint32_t> getIndices() { return mesh_->getIndices(); }
+		inline std::vector<Meshlet>& getMeshlets() { return mesh_->m_meshlets; }
+		inline std::vector<uint32_t>& getMeshletVertices() { return mesh_->m_meshletVertices; }
+		inline std::vector<uint8_t>& getMeshletTriangles() { return mesh_->m_meshletTriangles; }
+		inline VertexFormat getVertexFormat() const { return sceneDesc_.vertexFormat; }
 		inline std::vector<Material>& getMaterials() { return mesh_->pbrMaterials; }
 		inline std::vector<Texture>& getTextures() { return mesh_->gltfTextures; }
+		inline const std::string& getTextureCachePath() const { return mesh_->m_cachePath; }
+		inline CpuResidency getCpuResidency() const { return mesh_->m_options.residency; }
+		inline void releaseCpuData() { mesh_->releaseCpuData(); }
+		inline CpuMemoryStats getCpuMemoryStats() const { return mesh_->getCpuMemoryStats(); }
 
 		glm::mat4 getLocalTransform(int nodeHierarchyIndex);
+		//marks the node dirty, its subtree is updated by the next updateTransforms
 		void setTransform(int nodeHierarchyIndex, glm::mat4& newTransform);
 
 		glm::mat4 getGlobalTransform(int nodeHierarchyIndex);
-		void updateTransform(int nodeIndex);
+		//recomputes the global transforms of the dirty nodes and their subtrees. The nodes are sorted by level (see LoadMesh),
+		//so every level is one contiguous range whose parents are all final, it is updated in memory order and in parallel.
+		//The getters of the global transforms call it, so they never return stale transforms
+		void updateTransforms();
+		//global transforms recomputed since the last call, sorted and merged across small gaps so they can be uploaded as a few copies
+		std::vector<TransformRange> takeUpdatedTransforms();
 
 		void update(TimeStep ts);
 		void onEvent(Event& event);
 		inline bool isTransformUpdated() {
+			updateTransforms();
 			if (isTransformUpdated_)
 			{
 				isTransformUpdated_ = false;
@@ -75,7 +121,9 @@ namespace Gaia
 			}
 			return isTransformUpdated_;
 		}
-		inline void updateSceneBounds() { mesh_->calculateSceneBounds(); }
+		//refits the world space bounds of the nodes whose transforms changed and of their ancestors, the rest of the tree keeps
+		//its boxes. The scene bounds are the union of the root boxes
+		void updateSceneBounds();
 		inline SceneBounds getSceneBounds() { return mesh_->sceneBounds_; }
 	public:
 		LightParameters lightParameter{};
@@ -85,6 +133,21 @@ namespace Gaia
 		std::unique_ptr<LoadMesh> mesh_;
 		SceneDescriptor sceneDesc_;
 		bool isTransformUpdated_ = false;
+
+		static constexpr uint32_t NO_DIRTY_LEVEL = UINT32_MAX;
+		std::vector<uint32_t> levelOffsets_; //first node of every level followed by the node count
+		std::vector<uint8_t> dirtyNodes_; //bytes instead of bits, the nodes of a level are marked from several threads
+		uint32_t firstDirtyLevel_ = NO_DIRTY_LEVEL;
+		std::vector<TransformRange> updatedTransforms_; //runs of recomputed nodes, in the order they were found
+
+		std::vector<SceneBounds> nodeBounds_; //world space bounds of the sub meshes in the subtree of every node
+		std::vector<uint32_t> subMeshOffsets_; //the sub meshes of node i are nodeSubMeshes_[subMeshOffsets_[i], subMeshOffsets_[i + 1])
+		std::vector<uint32_t> nodeSubMeshes_;
+		std::vector<uint8_t> dirtyBounds_; //recomputed nodes and their ancestors, refitted by updateSceneBounds
+		bool hasDirtyBounds_ = false;
+	private:
+		void buildTransformLevels();
+		void buildBoundsHierarchy();
 	};
 
 }
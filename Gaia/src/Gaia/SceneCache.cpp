@@ -0,0 +1,463 @@
+#include "pch.h"
+#include "SceneCache.h"
+#include "LoadMesh.h"
+#include "MappedFile.h"
+#include "Hash.h"
+#include "Log.h"
+#include "Gaia/GltfLoader/json.hpp"
+#include <bit>
+
+namespace fs = std::filesystem;
+
+namespace Gaia
+{
+	namespace SceneCache
+	{
+		static uint64_t hashFile(const std::string& path, uint64_t seed)
+		{
+			MappedFile file(path);
+			if (!file.isOpen())
+				return hashBytes(path.data(), path.size(), ~seed); //missing dependency still changes the hash
+			return hashBytes(file.data(), file.size(), seed);
+		}
+
+		static inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		std::string getCachePath(const std::string& sourcePath)
+		{
+			fs::path path = sourcePath;
+			path.replace_extension(".gaiascene");
+			return path.string();
+		}
+
+		uint32_t getImportSettings(const MeshLoadOptions& options)
+		{
+			struct
+			{
+				uint32_t flags = 0;
+				uint32_t lodLevels = 1;
+				float lodReduction = 0.0f;
+				float lodMaxError = 0.0f;
+			} settings;
+			if (options.optimizeMeshes)
+				settings.flags |= ImportFlag_OptimizeMeshes;
+			if (options.buildMeshlets)
+				settings.flags |= ImportFlag_BuildMeshlets;
+			if (options.generateTangents)
+				settings.flags |= ImportFlag_GenerateTangents;
+			if (options.compressTextures)
+				settings.flags |= ImportFlag_CompressTextures;
+			if (options.generateMips)
+				settings.flags |= ImportFlag_GenerateMips;
+			if (options.lodLevels > 1)
+			{
+				settings.lodLevels = std::min(options.lodLevels, SubMesh::MAX_LODS);
+				settings.lodReduction = options.lodReduction;
+				settings.lodMaxError = options.lodMaxError;
+			}
+			return static_cast<uint32_t>(hashBytes(&settings, sizeof(settings), VERSION));
+		}
+
+		uint64_t computeSourceHash(const std::string& sourcePath)
+		{
+			MappedFile source(sourcePath);
+			if (!source.isOpen())
+				return 0;
+
+			uint64_t hash = hashBytes(source.data(), source.size(), VERSION);
+
+			//external buffers and images are only referenced by uri, hash them as well so edited textures invalidate the cache
+			std::span<const uint8_t> json(source.data(), source.size());
+			std::span<const uint8_t> bin;
+			if (fs::path(sourcePath).extension() == ".glb" && !parseGlbChunks(source.data(), source.size(), json, bin))
+				return hash;
+			nlohmann::json document = nlohmann::json::parse(json.begin(), json.end(), nullptr, false);
+			if (document.is_discarded() || !document.is_object())
+				return hash;
+
+			fs::path parentPath = fs::path(sourcePath).parent_path();
+			for (const char* key : { "buffers", "images" })
+			{
+				auto it = document.find(key);
+				if (it == document.end() || !it->is_array())
+					continue;
+				for (const auto& entry : *it)
+				{
+					auto uri = entry.find("uri");
+					if (uri == entry.end() || !uri->is_string())
+						continue;
+					const std::string& uriString = uri->get_ref<const std::string&>();
+					if (tinygltf::IsDataURI(uriString))
+						continue; //embedded data is already part of the source hash
+
+					std::string decodedUri;
+					tinygltf::URIDecode(uriString, &decodedUri, nullptr);
+					hash = hashBytes(decodedUri.data(), decodedUri.size(), hash);
+					hash = hashFile((parentPath / decodedUri).string(), hash);
+				}
+			}
+			return hash;
+		}
+
+		bool read(const std::string& cachePath, uint64_t sourceHash, LoadMesh& mesh)
+		{
+			MappedFile file(cachePath);
+			if (!file.isOpen() || file.size() < sizeof(Header))
+				return false;
+
+			Header header;
+			memcpy(&header, file.data(), sizeof(Header));
+			if (header.magic != MAGIC || header.version != VERSION || header.sourceHash != sourceHash ||
+				header.importSettings != getImportSettings(mesh.m_options) ||
+				header.hierarchyStride != sizeof(Hierarchy) ||
+				header.subMeshStride != sizeof(SubMesh) ||
+				header.vertexStride != sizeof(LoadMesh::VertexAttributes) ||
+				header.materialStride != sizeof(Material) ||
+				header.meshletStride != sizeof(Meshlet))
+			{
+				GAIA_CORE_INFO("Scene cache {} is stale, re-importing", cachePath);
+				return false;
+			}
+
+			for (const SectionRange& section : header.sections)
+			{
+				if (section.offset > file.size() || section.size > file.size() - section.offset)
+				{
+					GAIA_CORE_ERROR("Scene cache {} is truncated", cachePath);
+					return false;
+				}
+			}
+
+			auto sectionData = [&](Section section) { return file.data() + header.sections[section].offset; };
+			auto sectionCount = [&](Section section, size_t stride) { return static_cast<size_t>(header.sections[section].size / stride); };
+
+			const uint32_t numNodes = header.numNodes;
+			if (sectionCount(Section_Hierarchy, sizeof(Hierarchy)) != numNodes ||
+				sectionCount(Section_LocalTransforms, sizeof(glm::mat4)) != numNodes ||
+				sectionCount(Section_GlobalTransforms, sizeof(glm::mat4)) != numNodes ||
+				header.sections[Section_NodeNames].size < (numNodes + 1) * sizeof(uint32_t))
+			{
+				GAIA_CORE_ERROR("Scene cache {} has inconsistent node counts", cachePath);
+				return false;
+			}
+
+			const SubMesh* subMeshes = reinterpret_cast<const SubMesh*>(sectionData(Section_SubMeshes));
+			const size_t numSubMeshes = sectionCount(Section_SubMeshes, sizeof(SubMesh));
+			const size_t numVertices = sectionCount(Section_Vertices, sizeof(LoadMesh::VertexAttributes));
+			const size_t numIndices = sectionCount(Section_Indices, sizeof(uint32_t));
+			const MeshOptimizationStats* optimizationStats = reinterpret_cast<const MeshOptimizationStats*>(sectionData(Section_MeshOptimizationStats));
+			const size_t numOptimizationStats = sectionCount(Section_MeshOptimizationStats, sizeof(MeshOptimizationStats));
+			const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(sectionData(Section_Meshlets));
+			const size_t numMeshlets = sectionCount(Section_Meshlets, sizeof(Meshlet));
+			const uint32_t* meshletVertices = reinterpret_cast<const uint32_t*>(sectionData(Section_MeshletVertices));
+			const size_t numMeshletVertices = sectionCount(Section_MeshletVertices, sizeof(uint32_t));
+			const uint8_t* meshletTriangles = sectionData(Section_MeshletTriangles);
+			const size_t numMeshletTriangleBytes = header.sections[Section_MeshletTriangles].size;
+
+			const CookedTexture* textures = reinterpret_cast<const CookedTexture*>(sectionData(Section_Textures));
+			const uint8_t* texels = sectionData(Section_Texels);
+			const uint64_t texelSectionSize = header.sections[Section_Texels].size;
+			const size_t numTextures = sectionCount(Section_Textures, sizeof(CookedTexture));
+
+			//validate every range before touching the mesh so a corrupt file leaves it empty for the glTF fallback
+			const uint32_t* nameOffsets = reinterpret_cast<const uint32_t*>(sectionData(Section_NodeNames));
+			const uint64_t nameCharsSize = header.sections[Section_NodeNames].size - (numNodes + 1) * sizeof(uint32_t);
+			for (uint32_t i = 0; i < numNodes; i++)
+			{
+				if (nameOffsets[i] > nameOffsets[i + 1] || nameOffsets[i + 1] > nameCharsSize)
+				{
+					GAIA_CORE_ERROR("Scene cache {} has an out of range node name", cachePath);
+					return false;
+				}
+			}
+			//the transform update relies on the nodes being sorted by level (see Scene::updateTransforms)
+			const Hierarchy* cachedHierarchy = reinterpret_cast<const Hierarchy*>(sectionData(Section_Hierarchy));
+			for (uint32_t i = 0; i < numNodes; i++)
+			{
+				const Hierarchy& node = cachedHierarchy[i];
+				const bool isRoot = node.parent == -1 && node.level == 0;
+				const bool isChild = node.parent >= 0 && uint32_t(node.parent) < i && node.level == cachedHierarchy[node.parent].level + 1;
+				if ((!isRoot && !isChild) || (i > 0 && node.level < cachedHierarchy[i - 1].level))
+				{
+					GAIA_CORE_ERROR("Scene cache {} has a node hierarchy that is not sorted by level", cachePath);
+					return false;
+				}
+			}
+			for (size_t i = 0; i < numSubMeshes; i++)
+			{
+				const SubMesh& subMesh = subMeshes[i];
+				if (uint64_t(subMesh.vertexOffset) + subMesh.vertexCount > numVertices ||
+					uint64_t(subMesh.indexOffset) + subMesh.indexCount > numIndices ||
+					subMesh.nodeIndex < 0 || uint32_t(subMesh.nodeIndex) >= numNodes ||
+					subMesh.meshIndex < 0 || uint32_t(subMesh.meshIndex) >= numNodes ||
+					subMesh.numLods == 0 || subMesh.numLods > SubMesh::MAX_LODS ||
+					uint64_t(subMesh.meshletOffset) + subMesh.meshletCount > numMeshlets)
+				{
+					GAIA_CORE_ERROR("Scene cache {} has an out of range sub mesh", cachePath);
+					return false;
+				}
+				for (uint32_t level = 1; level < subMesh.numLods; level++)
+				{
+					if (uint64_t(subMesh.lods[level - 1].indexOffset) + subMesh.lods[level - 1].indexCount > numIndices)
+					{
+						GAIA_CORE_ERROR("Scene cache {} has an out of range level of detail", cachePath);
+						return false;
+					}
+				}
+			}
+			if (numOptimizationStats != 0 && numOptimizationStats != numSubMeshes)
+			{
+				GAIA_CORE_ERROR("Scene cache {} has inconsistent optimization statistics", cachePath);
+				return false;
+			}
+			for (size_t i = 0; i < numMeshlets; i++)
+			{
+				const Meshlet& meshlet = meshlets[i];
+				if (uint64_t(meshlet.vertexOffset) + meshlet.vertexCount > numMeshletVertices ||
+					uint64_t(meshlet.triangleOffset) + uint64_t(meshlet.triangleCount) * 3 > numMeshletTriangleBytes)
+				{
+					GAIA_CORE_ERROR("Scene cache {} has an out of range meshlet", cachePath);
+					return false;
+				}
+			}
+			if (std::any_of(meshletVertices, meshletVertices + numMeshletVertices, [&](uint32_t vertex) { return vertex >= numVertices; }))
+			{
+				GAIA_CORE_ERROR("Scene cache {} has an out of range meshlet vertex", cachePath);
+				return false;
+			}
+			for (size_t i = 0; i < numTextures; i++)
+			{
+				if (textures[i].texelOffset > texelSectionSize || textures[i].texelSize > texelSectionSize - textures[i].texelOffset ||
+					textures[i].encoding > TextureEncoding_BC7 || textures[i].numMips < 1 || textures[i].numMips > 32)
+				{
+					GAIA_CORE_ERROR("Scene cache {} has an out of range texture", cachePath);
+					return false;
+				}
+			}
+
+			const Hierarchy* hierarchy = reinterpret_cast<const Hierarchy*>(sectionData(Section_Hierarchy));
+			const glm::mat4* localTransforms = reinterpret_cast<const glm::mat4*>(sectionData(Section_LocalTransforms));
+			const glm::mat4* globalTransforms = reinterpret_cast<const glm::mat4*>(sectionData(Section_GlobalTransforms));
+			mesh.m_hierarchy.assign(hierarchy, hierarchy + numNodes);
+			mesh.localTransforms.assign(localTransforms, localTransforms + numNodes);
+			mesh.globalTransforms.assign(globalTransforms, globalTransforms + numNodes);
+
+			//names are stored as numNodes+1 offsets followed by the characters
+			const char* nameChars = reinterpret_cast<const char*>(nameOffsets + numNodes + 1);
+			mesh.m_nodeNames.resize(numNodes);
+			for (uint32_t i = 0; i < numNodes; i++)
+			{
+				mesh.m_nodeNames[i].assign(nameChars + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+			}
+
+			const Material* materials = reinterpret_cast<const Material*>(sectionData(Section_Materials));
+			mesh.pbrMaterials.assign(materials, materials + sectionCount(Section_Materials, sizeof(Material)));
+
+			mesh.m_subMeshes.assign(subMeshes, subMeshes + numSubMeshes);
+			mesh.m_optimizationStats.assign(optimizationStats, optimizationStats + numOptimizationStats);
+			mesh.m_meshlets.assign(meshlets, meshlets + numMeshlets);
+			mesh.m_meshletVertices.assign(meshletVertices, meshletVertices + numMeshletVertices);
+			mesh.m_meshletTriangles.assign(meshletTriangles, meshletTriangles + numMeshletTriangleBytes);
+
+			//geometry is already interleaved in its final layout, the mesh reads it straight out of the mapping
+			const LoadMesh::VertexAttributes* vertices = reinterpret_cast<const LoadMesh::VertexAttributes*>(sectionData(Section_Vertices));
+			const uint32_t* indices = reinterpret_cast<const uint32_t*>(sectionData(Section_Indices));
+			mesh.mapGeometry(vertices, numVertices, indices, numIndices);
+
+			//the texels stay in the mapping as well, they are only touched when the renderer uploads or streams them
+			mesh.gltfTextures.resize(numTextures);
+			for (size_t textureIndex = 0; textureIndex < numTextures; textureIndex++)
+			{
+				const CookedTexture& cooked = textures[textureIndex];
+				Texture& texture = mesh.gltfTextures[textureIndex];
+				texture.width = cooked.width;
+				texture.height = cooked.height;
+				texture.num_channels = cooked.numChannels;
+				texture.encoding = TextureEncoding(cooked.encoding);
+				texture.numMips = cooked.numMips;
+				texture.cacheOffset = header.sections[Section_Texels].offset + cooked.texelOffset;
+				texture.textureData.clear();
+				texture.mappedData = std::span<const uint8_t>(texels + cooked.texelOffset, cooked.texelSize);
+			}
+
+			mesh.sceneBounds_.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+			mesh.sceneBounds_.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+			//moving the mapping keeps its address, the geometry and the texels stay valid as long as the mesh
+			mesh.m_cacheFile = std::move(file);
+			return true;
+		}
+
+		bool write(const std::string& cachePath, uint64_t sourceHash, const LoadMesh& mesh)
+		{
+			const uint32_t numNodes = static_cast<uint32_t>(mesh.m_hierarchy.size());
+
+			std::span<const LoadMesh::VertexAttributes> vertices = mesh.getVertices();
+			std::span<const uint32_t> indices = mesh.getIndices();
+
+			std::vector<uint32_t> nameOffsets(numNodes + 1, 0);
+			std::string nameChars;
+			for (uint32_t i = 0; i < numNodes; i++)
+			{
+				nameOffsets[i] = static_cast<uint32_t>(nameChars.size());
+				nameChars += mesh.m_nodeNames[i];
+			}
+			nameOffsets[numNodes] = static_cast<uint32_t>(nameChars.size());
+
+			std::vector<CookedTexture> cookedTextures(mesh.gltfTextures.size());
+			uint64_t texelSize = 0;
+			for (size_t i = 0; i < mesh.gltfTextures.size(); i++)
+			{
+				const Texture& texture = mesh.gltfTextures[i];
+				texelSize = alignUp(texelSize, SECTION_ALIGNMENT);
+				cookedTextures[i] = CookedTexture{
+					.width = texture.width,
+					.height = texture.height,
+					.numChannels = texture.num_channels,
+					.encoding = texture.encoding,
+					.numMips = texture.numMips,
+					.texelOffset = texelSize,
+					.texelSize = texture.textureData.size(),
+				};
+				texelSize += texture.textureData.size();
+			}
+
+			Header header;
+			header.sourceHash = sourceHash;
+			header.hierarchyStride = sizeof(Hierarchy);
+			header.subMeshStride = sizeof(SubMesh);
+			header.vertexStride = sizeof(LoadMesh::VertexAttributes);
+			header.materialStride = sizeof(Material);
+			header.meshletStride = sizeof(Meshlet);
+			header.numNodes = numNodes;
+			header.importSettings = getImportSettings(mesh.m_options);
+			memcpy(header.boundsMin, &mesh.sceneBounds_.min, sizeof(header.boundsMin));
+			memcpy(header.boundsMax, &mesh.sceneBounds_.max, sizeof(header.boundsMax));
+
+			const uint64_t sectionSizes[Section_Count] = {
+				numNodes * sizeof(Hierarchy),
+				numNodes * sizeof(glm::mat4),
+				numNodes * sizeof(glm::mat4),
+				nameOffsets.size() * sizeof(uint32_t) + nameChars.size(),
+				mesh.m_subMeshes.size() * sizeof(SubMesh),
+				vertices.size() * sizeof(LoadMesh::VertexAttributes),
+				indices.size() * sizeof(uint32_t),
+				mesh.pbrMaterials.size() * sizeof(Material),
+				cookedTextures.size() * sizeof(CookedTexture),
+				texelSize,
+				mesh.m_optimizationStats.size() * sizeof(MeshOptimizationStats),
+				mesh.m_meshlets.size() * sizeof(Meshlet),
+				mesh.m_meshletVertices.size() * sizeof(uint32_t),
+				mesh.m_meshletTriangles.size(),
+			};
+			uint64_t offset = alignUp(sizeof(Header), SECTION_ALIGNMENT);
+			for (uint32_t i = 0; i < Section_Count; i++)
+			{
+				header.sections[i] = { .offset = offset, .size = sectionSizes[i] };
+				offset = alignUp(offset + sectionSizes[i], SECTION_ALIGNMENT);
+			}
+
+			//write into a temporary file first so a crash never leaves a half written cache with a valid header
+			const std::string tempPath = cachePath + ".tmp";
+			{
+				std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+				if (!out)
+				{
+					GAIA_CORE_WARN("Could not create scene cache {}", cachePath);
+					return false;
+				}
+
+				uint64_t written = 0;
+				auto writeBytes = [&](const void* data, uint64_t size) {
+					out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+					written += size;
+					};
+				auto padTo = [&](uint64_t target) {
+					static const char zeros[SECTION_ALIGNMENT] = {};
+					while (written < target)
+						writeBytes(zeros, std::min<uint64_t>(SECTION_ALIGNMENT, target - written));
+					};
+				auto writeSection = [&](Section section, const void* data, uint64_t size) {
+					padTo(header.sections[section].offset);
+					writeBytes(data, size);
+					};
+
+				writeBytes(&header, sizeof(Header));
+				writeSection(Section_Hierarchy, mesh.m_hierarchy.data(), sectionSizes[Section_Hierarchy]);
+				writeSection(Section_LocalTransforms, mesh.localTransforms.data(), sectionSizes[Section_LocalTransforms]);
+				writeSection(Section_GlobalTransforms, mesh.globalTransforms.data(), sectionSizes[Section_GlobalTransforms]);
+				writeSection(Section_NodeNames, nameOffsets.data(), nameOffsets.size() * sizeof(uint32_t));
+				writeBytes(nameChars.data(), nameChars.size());
+				writeSection(Section_SubMeshes, mesh.m_subMeshes.data(), sectionSizes[Section_SubMeshes]);
+				writeSection(Section_Vertices, vertices.data(), sectionSizes[Section_Vertices]);
+				writeSection(Section_Indices, indices.data(), sectionSizes[Section_Indices]);
+				writeSection(Section_Materials, mesh.pbrMaterials.data(), sectionSizes[Section_Materials]);
+				writeSection(Section_Textures, cookedTextures.data(), sectionSizes[Section_Textures]);
+				for (size_t i = 0; i < mesh.gltfTextures.size(); i++)
+				{
+					padTo(header.sections[Section_Texels].offset + cookedTextures[i].texelOffset);
+					writeBytes(mesh.gltfTextures[i].textureData.data(), cookedTextures[i].texelSize);
+				}
+				writeSection(Section_MeshOptimizationStats, mesh.m_optimizationStats.data(), sectionSizes[Section_MeshOptimizationStats]);
+				writeSection(Section_Meshlets, mesh.m_meshlets.data(), sectionSizes[Section_Meshlets]);
+				writeSection(Section_MeshletVertices, mesh.m_meshletVertices.data(), sectionSizes[Section_MeshletVertices]);
+				writeSection(Section_MeshletTriangles, mesh.m_meshletTriangles.data(), sectionSizes[Section_MeshletTriangles]);
+
+				if (!out)
+				{
+					GAIA_CORE_WARN("Failed writing scene cache {}", cachePath);
+					out.close();
+					std::error_code ec;
+					fs::remove(tempPath, ec);
+					return false;
+				}
+			}
+
+			std::error_code ec;
+			fs::rename(tempPath, cachePath, ec);
+			if (ec)
+			{
+				GAIA_CORE_WARN("Could not move scene cache into place {}: {}", cachePath, ec.message());
+				fs::remove(tempPath, ec);
+				return false;
+			}
+			return true;
+		}
+
+		bool locateTexels(const std::string& cachePath, LoadMesh& mesh)
+		{
+			MappedFile file(cachePath);
+			if (!file.isOpen() || file.size() < sizeof(Header))
+				return false;
+
+			Header header;
+			memcpy(&header, file.data(), sizeof(Header));
+			const SectionRange& textureSection = header.sections[Section_Textures];
+			const SectionRange& texelSection = header.sections[Section_Texels];
+			if (header.magic != MAGIC || header.version != VERSION ||
+				textureSection.offset > file.size() || textureSection.size > file.size() - textureSection.offset ||
+				texelSection.offset > file.size() || texelSection.size > file.size() - texelSection.offset ||
+				textureSection.size != mesh.gltfTextures.size() * sizeof(CookedTexture))
+			{
+				return false;
+			}
+
+			const CookedTexture* textures = reinterpret_cast<const CookedTexture*>(file.data() + textureSection.offset);
+			for (size_t i = 0; i < mesh.gltfTextures.size(); i++)
+			{
+				if (textures[i].texelSize != mesh.gltfTextures[i].textureData.size() || textures[i].texelOffset > texelSection.size ||
+					textures[i].texelSize > texelSection.size - textures[i].texelOffset)
+				{
+					return false;
+				}
+			}
+			for (size_t i = 0; i < mesh.gltfTextures.size(); i++)
+			{
+				mesh.gltfTextures[i].cacheOffset = texelSection.offset + textures[i].texelOffset;
+			}
+			return true;
+		}
+	}
+}
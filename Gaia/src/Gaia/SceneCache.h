@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace Gaia
+{
+	class LoadMesh;
+	struct MeshLoadOptions;
+
+	//Cooked scene format: a versioned binary snapshot of everything LoadMesh builds from a glTF file
+	//(hierarchy, transforms, node names, interleaved vertices, indices, materials and decoded texels).
+	//Every section is a flat array aligned to SceneCache::SECTION_ALIGNMENT so it can be read straight out of a file mapping.
+	namespace SceneCache
+	{
+		constexpr uint32_t MAGIC = 0x4E435347; // "GSCN"
+		constexpr uint32_t VERSION = 8;
+		constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+		enum Section : uint32_t
+		{
+			Section_Hierarchy = 0,
+			Section_LocalTransforms,
+			Section_GlobalTransforms,
+			Section_NodeNames,
+			Section_SubMeshes,
+			Section_Vertices,
+			Section_Indices,
+			Section_Materials,
+			Section_Textures,
+			Section_Texels,
+			Section_MeshOptimizationStats,
+			Section_Meshlets,
+			Section_MeshletVertices,
+			Section_MeshletTriangles,
+			Section_Count,
+		};
+
+		//import options that change the cooked geometry, a cache written with different settings is re-imported
+		enum ImportFlags : uint32_t
+		{
+			ImportFlag_OptimizeMeshes = 1 << 0,
+			ImportFlag_BuildMeshlets = 1 << 1,
+			ImportFlag_GenerateTangents = 1 << 2,
+			ImportFlag_CompressTextures = 1 << 3,
+			ImportFlag_GenerateMips = 1 << 4,
+		};
+
+		struct SectionRange
+		{
+			uint64_t offset = 0;
+			uint64_t size = 0;
+		};
+
+		struct Header
+		{
+			uint32_t magic = MAGIC;
+			uint32_t version = VERSION;
+			uint64_t sourceHash = 0;
+			//layout of the structs that are written as raw memory, a mismatch invalidates the cache
+			uint32_t hierarchyStride = 0;
+			uint32_t subMeshStride = 0;
+			uint32_t vertexStride = 0;
+			uint32_t materialStride = 0;
+			uint32_t meshletStride = 0;
+			uint32_t numNodes = 0;
+			uint32_t importSettings = 0; //see getImportSettings
+			uint32_t _pad = 0;
+			float boundsMin[3] = {};
+			float boundsMax[3] = {};
+			SectionRange sections[Section_Count] = {};
+		};
+
+		struct CookedTexture
+		{
+			int32_t width = 0;
+			int32_t height = 0;
+			int32_t numChannels = 0;
+			uint32_t encoding = 0; //TextureEncoding
+			uint32_t numMips = 1; //the levels follow each other in the texels
+			uint32_t _pad = 0;
+			uint64_t texelOffset = 0; //relative to the start of Section_Texels
+			uint64_t texelSize = 0;
+		};
+
+		//path of the cooked file that belongs to a glTF source file
+		std::string getCachePath(const std::string& sourcePath);
+
+		//hash of the import flags and every other option that changes the cooked geometry
+		uint32_t getImportSettings(const MeshLoadOptions& options);
+
+		//hash of the glTF file and every external buffer/image it references
+		uint64_t computeSourceHash(const std::string& sourcePath);
+
+		//fills the mesh from the cooked file, returns false if the file is missing, stale or corrupt.
+		//The file stays mapped in the mesh, the texels and the geometry are read from it in place
+		bool read(const std::string& cachePath, uint64_t sourceHash, LoadMesh& mesh);
+
+		bool write(const std::string& cachePath, uint64_t sourceHash, const LoadMesh& mesh);
+
+		//sets Texture::cacheOffset of every texture of the mesh, returns false if the file does not hold the same textures
+		bool locateTexels(const std::string& cachePath, LoadMesh& mesh);
+	}
+}
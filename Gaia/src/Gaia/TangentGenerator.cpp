@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "TangentGenerator.h"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace Gaia
+{
+	namespace TangentGenerator
+	{
+		//triangles whose UV area is below this have no usable derivatives and only receive tangents from their neighbours
+		static constexpr float MIN_UV_AREA = 1e-12f;
+
+		//removes the component along n, returns a zero vector if nothing is left
+		static glm::vec3 projectToPlane(const glm::vec3& v, const glm::vec3& n)
+		{
+			glm::vec3 projected = v - n * glm::dot(n, v);
+			float length = glm::length(projected);
+			return length > 1e-20f ? projected / length : glm::vec3(0.0f);
+		}
+
+		//any unit vector perpendicular to n, used when a vertex has no triangle with valid UVs
+		static glm::vec3 anyPerpendicular(const glm::vec3& n)
+		{
+			glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			return projectToPlane(axis, n);
+		}
+
+		void generate(std::span<const uint32_t> indices, const float* positions, const float* normals, const float* texCoords,
+			uint32_t vertexCount, glm::vec4* tangents)
+		{
+			std::vector<glm::vec3> tangentSums(vertexCount, glm::vec3(0.0f));
+			std::vector<glm::vec3> bitangentSums(vertexCount, glm::vec3(0.0f));
+			auto normal = [&](uint32_t v) {
+				glm::vec3 n = glm::make_vec3(&normals[v * 3]);
+				float length = glm::length(n);
+				return length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+			};
+
+			for (size_t i = 0; i + 3 <= indices.size(); i += 3)
+			{
+				const uint32_t triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+				if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+					continue;
+
+				glm::vec3 p[3];
+				glm::vec2 uv[3];
+				for (int k = 0; k < 3; k++)
+				{
+					p[k] = glm::make_vec3(&positions[triangle[k] * 3]);
+					uv[k] = glm::make_vec2(&texCoords[triangle[k] * 2]);
+				}
+				glm::vec3 edge1 = p[1] - p[0], edge2 = p[2] - p[0];
+				glm::vec2 deltaUv1 = uv[1] - uv[0], deltaUv2 = uv[2] - uv[0];
+				float uvArea = deltaUv1.x * deltaUv2.y - deltaUv2.x * deltaUv1.y;
+				if (std::abs(uvArea) < MIN_UV_AREA)
+					continue;
+
+				//like MikkTSpace only the directions matter, the magnitudes of the derivatives would bias large UV islands
+				glm::vec3 faceTangent = (edge1 * deltaUv2.y - edge2 * deltaUv1.y) * (uvArea > 0.0f ? 1.0f : -1.0f);
+				glm::vec3 faceBitangent = (edge2 * deltaUv1.x - edge1 * deltaUv2.x) * (uvArea > 0.0f ? 1.0f : -1.0f);
+
+				for (int k = 0; k < 3; k++)
+				{
+					glm::vec3 n = normal(triangle[k]);
+					glm::vec3 toNext = projectToPlane(p[(k + 1) % 3] - p[k], n);
+					glm::vec3 toPrevious = projectToPlane(p[(k + 2) % 3] - p[k], n);
+					float angle = std::acos(glm::clamp(glm::dot(toNext, toPrevious), -1.0f, 1.0f));
+
+					tangentSums[triangle[k]] += projectToPlane(faceTangent, n) * angle;
+					bitangentSums[triangle[k]] += projectToPlane(faceBitangent, n) * angle;
+				}
+			}
+
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				glm::vec3 n = normal(v);
+				glm::vec3 tangent = projectToPlane(tangentSums[v], n);
+				if (tangent == glm::vec3(0.0f))
+					tangent = anyPerpendicular(n);
+				float sign = glm::dot(glm::cross(n, tangent), bitangentSums[v]) < 0.0f ? -1.0f : 1.0f;
+				tangents[v] = glm::vec4(tangent, sign);
+			}
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <span>
+
+namespace Gaia
+{
+	//Per vertex tangent frames for primitives that come without a TANGENT attribute, following MikkTSpace (Mikkelsen 2008):
+	//the UV derivatives of every triangle are projected into the tangent plane of each corner's normal, accumulated with the
+	//corner angle as weight and orthogonalized against the vertex normal. Vertices are never split, so a vertex shared by
+	//triangles with mirrored UVs gets the handedness of the larger angle sum.
+	namespace TangentGenerator
+	{
+		//writes vertexCount tangents in the glTF convention: xyz is the unit tangent and w the sign with
+		//bitangent = cross(normal, tangent.xyz) * w. positions and normals are packed vec3s, texCoords packed vec2s,
+		//indices are a triangle list relative to the first vertex
+		void generate(std::span<const uint32_t> indices, const float* positions, const float* normals, const float* texCoords,
+			uint32_t vertexCount, glm::vec4* tangents);
+	}
+}
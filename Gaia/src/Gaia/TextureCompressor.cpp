@@ -0,0 +1,427 @@
+#include "pch.h"
+#include "TextureCompressor.h"
+#include "TextureMips.h"
+#include "Log.h"
+#include "Core.h"
+#include "glm/glm.hpp"
+
+namespace Gaia
+{
+	namespace TextureCompressor
+	{
+		static constexpr uint32_t BLOCK_TEXELS = 16;
+		static constexpr int POWER_ITERATIONS = 8;
+
+		//interpolation weights of the BC1 palette in index order, the color block of BC3 uses the same 4 color mode
+		static constexpr float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		//4 bit index weights of BC7 in 1/64
+		static constexpr uint32_t BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		using Block = uint8_t[BLOCK_TEXELS][4];
+
+		//packs fields least significant bit first, the layout of BC7 blocks
+		struct BitWriter
+		{
+			uint8_t* data;
+			uint32_t position = 0;
+
+			void write(uint32_t value, uint32_t numBits)
+			{
+				for (uint32_t bit = 0; bit < numBits; bit++, position++)
+				{
+					if (value & (1u << bit))
+						data[position >> 3] |= uint8_t(1u << (position & 7));
+				}
+			}
+		};
+
+		static void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				uint32_t row = std::min(blockY * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					uint32_t column = std::min(blockX * 4 + x, width - 1);
+					memcpy(block[y * 4 + x], rgba + (size_t(row) * width + column) * 4, 4);
+				}
+			}
+		}
+
+		//principal axis of the block colors, zero if every texel has the same color
+		template <int N>
+		static glm::vec<N, float> principalAxis(const glm::vec<N, float>* texels, const glm::vec<N, float>& mean)
+		{
+			float covariance[N][N] = {};
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				glm::vec<N, float> d = texels[i] - mean;
+				for (int r = 0; r < N; r++)
+					for (int c = 0; c < N; c++)
+						covariance[r][c] += d[r] * d[c];
+			}
+			//power iteration, starting from the channel with the largest variance converges in a few steps
+			glm::vec<N, float> axis(0.0f);
+			int largest = 0;
+			for (int c = 1; c < N; c++)
+				largest = covariance[c][c] > covariance[largest][largest] ? c : largest;
+			axis[largest] = 1.0f;
+			for (int iteration = 0; iteration < POWER_ITERATIONS; iteration++)
+			{
+				glm::vec<N, float> next(0.0f);
+				for (int r = 0; r < N; r++)
+					for (int c = 0; c < N; c++)
+						next[r] += covariance[r][c] * axis[c];
+				float length = glm::length(next);
+				if (length < 1e-6f)
+					return glm::vec<N, float>(0.0f);
+				axis = next / length;
+			}
+			return axis;
+		}
+
+		//endpoints that span the projection of the texels onto the principal axis
+		template <int N>
+		static void fitEndpoints(const glm::vec<N, float>* texels, glm::vec<N, float>& e0, glm::vec<N, float>& e1)
+		{
+			glm::vec<N, float> mean(0.0f);
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				mean += texels[i];
+			mean /= float(BLOCK_TEXELS);
+			glm::vec<N, float> axis = principalAxis<N>(texels, mean);
+			float minT = 0.0f, maxT = 0.0f;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				float t = glm::dot(texels[i] - mean, axis);
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			e0 = glm::clamp(mean + axis * maxT, 0.0f, 255.0f);
+			e1 = glm::clamp(mean + axis * minT, 0.0f, 255.0f);
+		}
+
+		//least squares endpoints for fixed indices, returns false if the system is singular (all texels use one weight)
+		template <int N>
+		static bool refineEndpoints(const glm::vec<N, float>* texels, const float* weights, const uint8_t* indices,
+			glm::vec<N, float>& e0, glm::vec<N, float>& e1)
+		{
+			float a = 0.0f, b = 0.0f, c = 0.0f;
+			glm::vec<N, float> r0(0.0f), r1(0.0f);
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				float t = weights[indices[i]];
+				a += (1.0f - t) * (1.0f - t);
+				b += t * (1.0f - t);
+				c += t * t;
+				r0 += (1.0f - t) * texels[i];
+				r1 += t * texels[i];
+			}
+			float determinant = a * c - b * b;
+			if (std::abs(determinant) < 1e-6f)
+				return false;
+			e0 = glm::clamp((c * r0 - b * r1) / determinant, 0.0f, 255.0f);
+			e1 = glm::clamp((a * r1 - b * r0) / determinant, 0.0f, 255.0f);
+			return true;
+		}
+
+		//nearest palette entry of every texel, returns the summed squared error
+		template <int N>
+		static float selectIndices(const glm::vec<N, float>* texels, const glm::vec<N, float>* palette, uint32_t paletteSize, uint8_t* indices)
+		{
+			float error = 0.0f;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				float best = std::numeric_limits<float>::max();
+				for (uint32_t p = 0; p < paletteSize; p++)
+				{
+					glm::vec<N, float> d = texels[i] - palette[p];
+					float distance = glm::dot(d, d);
+					if (distance < best)
+					{
+						best = distance;
+						indices[i] = uint8_t(p);
+					}
+				}
+				error += best;
+			}
+			return error;
+		}
+
+		static uint16_t packRgb565(const glm::vec3& color)
+		{
+			uint32_t r = uint32_t(color.r * 31.0f / 255.0f + 0.5f);
+			uint32_t g = uint32_t(color.g * 63.0f / 255.0f + 0.5f);
+			uint32_t b = uint32_t(color.b * 31.0f / 255.0f + 0.5f);
+			return uint16_t((r << 11) | (g << 5) | b);
+		}
+
+		static glm::vec3 unpackRgb565(uint16_t color)
+		{
+			uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+			return glm::vec3(float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)));
+		}
+
+		static float evaluateBc1(const glm::vec3* texels, uint16_t c0, uint16_t c1, uint8_t* indices)
+		{
+			glm::vec3 e0 = unpackRgb565(c0), e1 = unpackRgb565(c1);
+			glm::vec3 palette[4];
+			for (int p = 0; p < 4; p++)
+				palette[p] = glm::mix(e0, e1, BC1_WEIGHTS[p]);
+			return selectIndices<3>(texels, palette, 4, indices);
+		}
+
+		static void encodeBc1(const Block& block, uint8_t* out)
+		{
+			glm::vec3 texels[BLOCK_TEXELS];
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				texels[i] = glm::vec3(block[i][0], block[i][1], block[i][2]);
+
+			glm::vec3 e0, e1;
+			fitEndpoints<3>(texels, e0, e1);
+			uint16_t c0 = packRgb565(e0), c1 = packRgb565(e1);
+			uint8_t indices[BLOCK_TEXELS];
+			float error = evaluateBc1(texels, c0, c1, indices);
+
+			uint8_t refinedIndices[BLOCK_TEXELS];
+			if (refineEndpoints<3>(texels, BC1_WEIGHTS, indices, e0, e1))
+			{
+				uint16_t r0 = packRgb565(e0), r1 = packRgb565(e1);
+				float refinedError = evaluateBc1(texels, r0, r1, refinedIndices);
+				if (refinedError < error)
+				{
+					c0 = r0;
+					c1 = r1;
+					memcpy(indices, refinedIndices, sizeof(indices));
+				}
+			}
+
+			//the 4 color palette needs c0 > c1, equal endpoints fall into the 3 color mode where index 0 is still c0
+			if (c0 < c1)
+			{
+				std::swap(c0, c1);
+				for (uint8_t& index : indices)
+					index ^= 1;
+			}
+			else if (c0 == c1)
+			{
+				memset(indices, 0, sizeof(indices));
+			}
+
+			uint32_t packedIndices = 0;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				packedIndices |= uint32_t(indices[i]) << (i * 2);
+			memcpy(out, &c0, 2);
+			memcpy(out + 2, &c1, 2);
+			memcpy(out + 4, &packedIndices, 4);
+		}
+
+		//single channel block, the 8 value mode between the channel's min and max
+		static void encodeBc4(const Block& block, uint32_t channel, uint8_t* out)
+		{
+			uint8_t v0 = 0, v1 = 255;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				v0 = std::max(v0, block[i][channel]);
+				v1 = std::min(v1, block[i][channel]);
+			}
+			uint64_t packedIndices = 0;
+			if (v0 > v1)
+			{
+				//palette order of the 8 value mode: v0, v1, then 6 values from v0 towards v1
+				static constexpr uint8_t ORDER[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+				const float range = float(v0 - v1);
+				for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				{
+					int step = int((block[i][channel] - v1) / range * 7.0f + 0.5f);
+					packedIndices |= uint64_t(ORDER[step]) << (i * 3);
+				}
+			}
+			out[0] = v0;
+			out[1] = v1;
+			for (int byte = 0; byte < 6; byte++)
+				out[2 + byte] = uint8_t(packedIndices >> (byte * 8));
+		}
+
+		//mode 6 endpoints are 7 bits per channel plus a shared lowest bit (p bit), picks the p bit that lands closer to the endpoint
+		static glm::vec4 quantizeBc7Endpoint(const glm::vec4& endpoint, uint32_t quantized[4], uint32_t& pBit)
+		{
+			glm::vec4 best(0.0f);
+			float bestError = std::numeric_limits<float>::max();
+			for (uint32_t p = 0; p < 2; p++)
+			{
+				uint32_t q[4];
+				glm::vec4 value;
+				for (int c = 0; c < 4; c++)
+				{
+					q[c] = uint32_t(glm::clamp((endpoint[c] - float(p)) * 0.5f + 0.5f, 0.0f, 127.0f));
+					value[c] = float((q[c] << 1) | p);
+				}
+				glm::vec4 d = value - endpoint;
+				float error = glm::dot(d, d);
+				if (error < bestError)
+				{
+					bestError = error;
+					best = value;
+					pBit = p;
+					memcpy(quantized, q, sizeof(q));
+				}
+			}
+			return best;
+		}
+
+		struct Bc7Candidate
+		{
+			uint32_t q0[4], q1[4];
+			uint32_t p0 = 0, p1 = 0;
+			uint8_t indices[BLOCK_TEXELS];
+			float error = std::numeric_limits<float>::max();
+		};
+
+		static void evaluateBc7(const glm::vec4* texels, const glm::vec4& e0, const glm::vec4& e1, Bc7Candidate& candidate)
+		{
+			glm::vec4 v0 = quantizeBc7Endpoint(e0, candidate.q0, candidate.p0);
+			glm::vec4 v1 = quantizeBc7Endpoint(e1, candidate.q1, candidate.p1);
+			glm::vec4 palette[16];
+			for (int p = 0; p < 16; p++)
+			{
+				//the decoder's integer interpolation
+				for (int c = 0; c < 4; c++)
+					palette[p][c] = float(((64 - BC7_WEIGHTS[p]) * uint32_t(v0[c]) + BC7_WEIGHTS[p] * uint32_t(v1[c]) + 32) >> 6);
+			}
+			candidate.error = selectIndices<4>(texels, palette, 16, candidate.indices);
+		}
+
+		static void encodeBc7(const Block& block, uint8_t* out)
+		{
+			static const float weights[16] = {
+				0.0f / 64, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64, 30.0f / 64,
+				34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64, 60.0f / 64, 64.0f / 64,
+			};
+			glm::vec4 texels[BLOCK_TEXELS];
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				texels[i] = glm::vec4(block[i][0], block[i][1], block[i][2], block[i][3]);
+
+			glm::vec4 e0, e1;
+			fitEndpoints<4>(texels, e0, e1);
+			Bc7Candidate best;
+			evaluateBc7(texels, e0, e1, best);
+			if (refineEndpoints<4>(texels, weights, best.indices, e0, e1))
+			{
+				Bc7Candidate refined;
+				evaluateBc7(texels, e0, e1, refined);
+				if (refined.error < best.error)
+					best = refined;
+			}
+
+			//the first index is stored with 3 bits, its highest bit has to be 0
+			if (best.indices[0] & 8)
+			{
+				std::swap(best.q0, best.q1);
+				std::swap(best.p0, best.p1);
+				for (uint8_t& index : best.indices)
+					index = uint8_t(15 - index);
+			}
+
+			memset(out, 0, 16);
+			BitWriter writer{ .data = out };
+			writer.write(1u << 6, 7);
+			for (int c = 0; c < 4; c++)
+			{
+				writer.write(best.q0[c], 7);
+				writer.write(best.q1[c], 7);
+			}
+			writer.write(best.p0, 1);
+			writer.write(best.p1, 1);
+			writer.write(best.indices[0], 3);
+			for (uint32_t i = 1; i < BLOCK_TEXELS; i++)
+				writer.write(best.indices[i], 4);
+		}
+
+		uint32_t getBlockSize(TextureEncoding encoding)
+		{
+			switch (encoding)
+			{
+			case TextureEncoding_BC1:
+			case TextureEncoding_BC4:
+				return 8;
+			case TextureEncoding_BC3:
+			case TextureEncoding_BC5:
+			case TextureEncoding_BC7:
+				return 16;
+			default:
+				return 0;
+			}
+		}
+
+		size_t getEncodedSize(TextureEncoding encoding, uint32_t width, uint32_t height)
+		{
+			if (encoding == TextureEncoding_RGBA8)
+				return size_t(width) * height * 4;
+			return size_t((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(encoding);
+		}
+
+		void compress(const uint8_t* rgba, uint32_t width, uint32_t height, TextureEncoding encoding, uint8_t* destination)
+		{
+			const uint32_t blocksX = (width + 3) / 4;
+			const uint32_t blocksY = (height + 3) / 4;
+			const uint32_t blockSize = getBlockSize(encoding);
+			GAIA_ASSERT(blockSize != 0, "the encoding is not block compressed");
+			if (blockSize == 0)
+				return;
+
+			auto rows = std::views::iota(uint32_t(0), blocksY);
+			std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t blockY) {
+				Block block;
+				for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+				{
+					loadBlock(rgba, width, height, blockX, blockY, block);
+					uint8_t* out = destination + (size_t(blockY) * blocksX + blockX) * blockSize;
+					switch (encoding)
+					{
+					case TextureEncoding_BC1:
+						encodeBc1(block, out);
+						break;
+					case TextureEncoding_BC3:
+						encodeBc4(block, 3, out);
+						encodeBc1(block, out + 8);
+						break;
+					case TextureEncoding_BC4:
+						encodeBc4(block, 0, out);
+						break;
+					case TextureEncoding_BC5:
+						encodeBc4(block, 0, out);
+						encodeBc4(block, 1, out + 8);
+						break;
+					case TextureEncoding_BC7:
+						encodeBc7(block, out);
+						break;
+					default:
+						break;
+					}
+				}
+			});
+		}
+
+		bool compress(Texture& texture, TextureEncoding encoding)
+		{
+			if (texture.encoding != TextureEncoding_RGBA8 || getBlockSize(encoding) == 0 || texture.width <= 0 || texture.height <= 0 ||
+				texture.textureData.size() != TextureMips::getLevelOffset(texture, texture.numMips))
+			{
+				return false;
+			}
+			//every mip level is compressed on its own
+			const std::vector<uint8_t> rgba = std::move(texture.textureData);
+			texture.encoding = encoding;
+			texture.textureData.resize(TextureMips::getLevelOffset(texture, texture.numMips));
+			size_t sourceOffset = 0;
+			for (uint32_t level = 0; level < texture.numMips; level++)
+			{
+				const uint32_t width = TextureMips::getMipSize(texture.width, level);
+				const uint32_t height = TextureMips::getMipSize(texture.height, level);
+				compress(rgba.data() + sourceOffset, width, height, encoding, texture.textureData.data() + TextureMips::getLevelOffset(texture, level));
+				sourceOffset += getEncodedSize(TextureEncoding_RGBA8, width, height);
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "Gaia/Material.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace Gaia
+{
+	//CPU block compression of RGBA8 images into the BCn formats the GPU samples directly, every 4x4 texel block is encoded on its own
+	//so the blocks are spread over all cores. Endpoints come from the principal axis of the block colors and are refined once with
+	//least squares against the chosen indices. BC7 only uses mode 6 (one subset, RGBA endpoints), which covers albedo with alpha well
+	namespace TextureCompressor
+	{
+		//bytes of one 4x4 block, 0 for uncompressed encodings
+		uint32_t getBlockSize(TextureEncoding encoding);
+		//bytes of a whole width x height image in the encoding
+		size_t getEncodedSize(TextureEncoding encoding, uint32_t width, uint32_t height);
+
+		//encodes getEncodedSize() bytes into destination, blocks reaching over the right or bottom edge repeat the last column / row.
+		//BC4 reads the red channel, BC5 red and green
+		void compress(const uint8_t* rgba, uint32_t width, uint32_t height, TextureEncoding encoding, uint8_t* destination);
+
+		//replaces the RGBA8 texels of every mip level with their compressed blocks, returns false if the texture can not be compressed
+		bool compress(Texture& texture, TextureEncoding encoding);
+	}
+}
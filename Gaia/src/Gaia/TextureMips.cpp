@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "TextureMips.h"
+#include "TextureCompressor.h"
+#include "glm/glm.hpp"
+#include <bit>
+
+namespace Gaia
+{
+	namespace TextureMips
+	{
+		struct SrgbTables
+		{
+			float toLinear[256];
+			//linear values halfway between two consecutive sRGB codes, used to round back to the closest code
+			float midpoints[255];
+
+			SrgbTables()
+			{
+				for (int code = 0; code < 256; code++)
+				{
+					float c = code / 255.0f;
+					toLinear[code] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				for (int code = 0; code < 255; code++)
+					midpoints[code] = 0.5f * (toLinear[code] + toLinear[code + 1]);
+			}
+			uint8_t toSrgb(float linear) const
+			{
+				return uint8_t(std::upper_bound(midpoints, midpoints + 255, linear) - midpoints);
+			}
+		};
+
+		static uint8_t toUnorm8(float value)
+		{
+			return uint8_t(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+
+		//the 4 source texels of a destination texel, odd sizes repeat the last row / column
+		static void gatherQuad(const uint8_t* source, uint32_t width, uint32_t height, uint32_t x, uint32_t y, const uint8_t* texels[4])
+		{
+			uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+			texels[0] = source + (size_t(y0) * width + x0) * 4;
+			texels[1] = source + (size_t(y0) * width + x1) * 4;
+			texels[2] = source + (size_t(y1) * width + x0) * 4;
+			texels[3] = source + (size_t(y1) * width + x1) * 4;
+		}
+
+		static void downsample(const uint8_t* source, uint32_t width, uint32_t height, uint8_t* destination, MipFilter filter)
+		{
+			static const SrgbTables srgb;
+			const uint32_t dstWidth = std::max(width / 2, 1u);
+			const uint32_t dstHeight = std::max(height / 2, 1u);
+
+			auto rows = std::views::iota(uint32_t(0), dstHeight);
+			std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t y) {
+				const uint8_t* texels[4];
+				for (uint32_t x = 0; x < dstWidth; x++)
+				{
+					gatherQuad(source, width, height, x, y, texels);
+					uint8_t* out = destination + (size_t(y) * dstWidth + x) * 4;
+					const uint32_t alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+					out[3] = uint8_t((alpha + 2) / 4);
+					switch (filter)
+					{
+					case MipFilter_SRGB:
+						for (int c = 0; c < 3; c++)
+						{
+							float sum = srgb.toLinear[texels[0][c]] + srgb.toLinear[texels[1][c]] + srgb.toLinear[texels[2][c]] + srgb.toLinear[texels[3][c]];
+							out[c] = srgb.toSrgb(sum * 0.25f);
+						}
+						break;
+					case MipFilter_NormalMap:
+					{
+						glm::vec3 normal(0.0f);
+						for (int t = 0; t < 4; t++)
+							normal += glm::vec3(texels[t][0], texels[t][1], texels[t][2]) * (2.0f / 255.0f) - 1.0f;
+						float length = glm::length(normal);
+						normal = length > 1e-6f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+						for (int c = 0; c < 3; c++)
+							out[c] = toUnorm8(normal[c] * 0.5f + 0.5f);
+						break;
+					}
+					default:
+						for (int c = 0; c < 3; c++)
+							out[c] = uint8_t((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+						break;
+					}
+				}
+			});
+		}
+
+		uint32_t getNumMips(uint32_t width, uint32_t height)
+		{
+			return std::bit_width(std::max({ width, height, 1u }));
+		}
+
+		size_t getLevelOffset(const Texture& texture, uint32_t level)
+		{
+			size_t offset = 0;
+			for (uint32_t l = 0; l < level; l++)
+				offset += getLevelSize(texture, l);
+			return offset;
+		}
+
+		size_t getLevelSize(const Texture& texture, uint32_t level)
+		{
+			return TextureCompressor::getEncodedSize(texture.encoding, getMipSize(texture.width, level), getMipSize(texture.height, level));
+		}
+
+		bool generate(Texture& texture, MipFilter filter)
+		{
+			if (texture.encoding != TextureEncoding_RGBA8 || texture.numMips != 1 || texture.width <= 0 || texture.height <= 0 ||
+				texture.textureData.size() != size_t(texture.width) * size_t(texture.height) * 4)
+			{
+				return false;
+			}
+			const uint32_t numMips = getNumMips(texture.width, texture.height);
+			if (numMips == 1)
+				return true;
+
+			//level 0 stays where it is, the smaller levels are appended
+			texture.numMips = numMips;
+			texture.textureData.resize(getLevelOffset(texture, numMips));
+			for (uint32_t level = 1; level < numMips; level++)
+			{
+				const uint8_t* source = texture.textureData.data() + getLevelOffset(texture, level - 1);
+				uint8_t* destination = texture.textureData.data() + getLevelOffset(texture, level);
+				downsample(source, getMipSize(texture.width, level - 1), getMipSize(texture.height, level - 1), destination, filter);
+			}
+			return true;
+		}
+	}
+}
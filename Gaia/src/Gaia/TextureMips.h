@@ -0,0 +1,30 @@
+#pragma once
+#include "Gaia/Material.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace Gaia
+{
+	//CPU mip chain generation for RGBA8 textures. Every level is a 2x2 box filter of the previous one, computed in linear space
+	//for sRGB color textures and on unit vectors for normal maps. The levels are stored back to back in Texture::textureData
+	namespace TextureMips
+	{
+		enum MipFilter : uint32_t
+		{
+			MipFilter_Linear = 0, //data textures like metallic roughness
+			MipFilter_SRGB, //rgb is decoded to linear before averaging, alpha is linear
+			MipFilter_NormalMap, //xyz is averaged as a vector and renormalized
+		};
+
+		//levels down to 1x1
+		uint32_t getNumMips(uint32_t width, uint32_t height);
+		inline uint32_t getMipSize(uint32_t size, uint32_t level) { return std::max(size >> level, 1u); }
+
+		//byte range of a level in Texture::textureData, works for every encoding
+		size_t getLevelOffset(const Texture& texture, uint32_t level);
+		size_t getLevelSize(const Texture& texture, uint32_t level);
+
+		//replaces the single RGBA8 level of the texture with the full mip chain, returns false if the texture is not RGBA8 or already has mips
+		bool generate(Texture& texture, MipFilter filter);
+	}
+}
@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "Trace.h"
+#include "Log.h"
+
+namespace Gaia
+{
+	namespace Trace
+	{
+		namespace
+		{
+			std::mutex mutex;
+			std::vector<Event> events;
+			std::atomic<bool> recording = false;
+			std::chrono::steady_clock::time_point origin;
+			std::atomic<uint32_t> nextThread = 0;
+
+			int64_t now()
+			{
+				return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+			}
+			//small ids keep the rows of the timeline in the order the threads first recorded something
+			uint32_t getThreadId()
+			{
+				thread_local uint32_t id = nextThread++;
+				return id;
+			}
+		}
+
+		void start()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			events.clear();
+			origin = std::chrono::steady_clock::now();
+			recording = true;
+		}
+
+		std::vector<Event> stop()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			recording = false;
+			std::vector<Event> recorded;
+			recorded.swap(events);
+			return recorded;
+		}
+
+		bool stop(const std::string& path)
+		{
+			const std::vector<Event> recorded = stop();
+			std::ofstream file(path, std::ios::trunc);
+			if (!file)
+			{
+				GAIA_CORE_ERROR("Could not write the trace {}", path);
+				return false;
+			}
+			file << "{\"traceEvents\":[\n";
+			for (size_t i = 0; i < recorded.size(); i++)
+			{
+				const Event& event = recorded[i];
+				file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+					<< ",\"ts\":" << event.begin << ",\"dur\":" << event.duration << "}" << (i + 1 < recorded.size() ? ",\n" : "\n");
+			}
+			file << "]}\n";
+			GAIA_CORE_INFO("Wrote {} trace events to {}", recorded.size(), path);
+			return bool(file);
+		}
+
+		bool isRecording()
+		{
+			return recording;
+		}
+
+		Scope::Scope(const char* name) : name_(name)
+		{
+			if (recording)
+				begin_ = now();
+		}
+
+		Scope::~Scope()
+		{
+			if (begin_ < 0 || !recording)
+				return;
+			const Event event{ .name = name_, .thread = getThreadId(), .begin = begin_, .duration = now() - begin_ };
+			std::lock_guard<std::mutex> lock(mutex);
+			events.push_back(event);
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Gaia
+{
+	//records timed stages into a timeline that chrome://tracing and ui.perfetto.dev can open, every thread gets its own row,
+	//so stages that overlap can be seen side by side. Nothing is recorded until start is called
+	namespace Trace
+	{
+		struct Event
+		{
+			const char* name = nullptr;
+			uint32_t thread = 0; //row of the timeline
+			int64_t begin = 0; //microseconds since start
+			int64_t duration = 0;
+		};
+
+		void start();
+		//writes the stages recorded since start as json and stops recording
+		bool stop(const std::string& path);
+		//stops recording and returns the stages recorded since start
+		std::vector<Event> stop();
+		bool isRecording();
+
+		class Scope
+		{
+		public:
+			Scope(const char* name);
+			~Scope();
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		private:
+			const char* name_ = nullptr;
+			int64_t begin_ = -1; //microseconds since start, -1 if nothing is recorded
+		};
+	}
+}
+
+#define GAIA_TRACE_CONCAT_(a, b) a##b
+#define GAIA_TRACE_CONCAT(a, b) GAIA_TRACE_CONCAT_(a, b)
+//times the rest of the enclosing block, name has to be a string literal
+#define GAIA_TRACE_SCOPE(name) ::Gaia::Trace::Scope GAIA_TRACE_CONCAT(traceScope_, __LINE__)(name)
@@ -0,0 +1,211 @@
+#include "pch.h"
+#include "VertexFormat.h"
+#include <emmintrin.h>
+#include "glm/gtc/packing.hpp"
+
+namespace Gaia
+{
+	namespace VertexEncoding
+	{
+		static constexpr size_t ENCODE_CHUNK_SIZE = 16 * 1024; //vertices per parallel task
+
+		uint32_t getVertexStride(VertexFormat format)
+		{
+			switch (format)
+			{
+			case VertexFormat_Compact:
+				return sizeof(CompactVertex);
+			case VertexFormat_CompactHalfPosition:
+				return sizeof(CompactVertexHalf);
+			default:
+				return sizeof(VertexAttributes);
+			}
+		}
+
+		bool supportsCompactIds(std::span<const SubMesh> subMeshes)
+		{
+			for (const SubMesh& subMesh : subMeshes)
+			{
+				bool validMaterial = subMesh.materialId == UINT32_MAX || subMesh.materialId < NO_MATERIAL;
+				if (!validMaterial || static_cast<uint32_t>(subMesh.meshIndex) >= (1u << MESH_ID_BITS))
+					return false;
+			}
+			return true;
+		}
+
+		static uint32_t packSnorm16(float x, float y)
+		{
+			//same rounding as cvtps2dq so the scalar and the SIMD path produce identical bits
+			int32_t ix = static_cast<int32_t>(std::nearbyint(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+			int32_t iy = static_cast<int32_t>(std::nearbyint(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+			return (static_cast<uint32_t>(ix) & 0xFFFF) | (static_cast<uint32_t>(iy) << 16);
+		}
+
+		uint32_t octEncode(const glm::vec3& direction)
+		{
+			float sum = std::max(std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z), 1e-30f);
+			glm::vec3 n = direction / sum;
+			if (n.z < 0.0f)
+			{
+				float x = (1.0f - std::abs(n.y)) * (std::signbit(n.x) ? -1.0f : 1.0f);
+				float y = (1.0f - std::abs(n.x)) * (std::signbit(n.y) ? -1.0f : 1.0f);
+				n.x = x;
+				n.y = y;
+			}
+			return packSnorm16(n.x, n.y);
+		}
+
+		glm::vec3 octDecode(uint32_t encoded)
+		{
+			glm::vec2 e = glm::unpackSnorm2x16(encoded);
+			glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+			float t = std::max(-n.z, 0.0f);
+			n.x += n.x >= 0.0f ? -t : t;
+			n.y += n.y >= 0.0f ? -t : t;
+			return glm::normalize(n);
+		}
+
+		uint32_t packIds(uint32_t materialId, uint32_t meshId, float tangentSign)
+		{
+			uint32_t material = materialId == UINT32_MAX ? NO_MATERIAL : materialId;
+			return (tangentSign < 0.0f ? TANGENT_SIGN_BIT : 0u) | ((meshId << MATERIAL_ID_BITS) & ~TANGENT_SIGN_BIT) | (material & NO_MATERIAL);
+		}
+
+		//octahedral encoding of 4 directions given as x, y, z lanes
+		static __m128i octEncode4(__m128 x, __m128 y, __m128 z)
+		{
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 minusOne = _mm_set1_ps(-1.0f);
+
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z));
+			sum = _mm_max_ps(sum, _mm_set1_ps(1e-30f));
+			x = _mm_div_ps(x, sum);
+			y = _mm_div_ps(y, sum);
+			z = _mm_div_ps(z, sum);
+
+			//fold the lower hemisphere
+			__m128 lowerHemisphere = _mm_cmplt_ps(z, _mm_setzero_ps());
+			__m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, y)), _mm_or_ps(_mm_and_ps(x, signMask), one));
+			__m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, x)), _mm_or_ps(_mm_and_ps(y, signMask), one));
+			x = _mm_or_ps(_mm_and_ps(lowerHemisphere, foldedX), _mm_andnot_ps(lowerHemisphere, x));
+			y = _mm_or_ps(_mm_and_ps(lowerHemisphere, foldedY), _mm_andnot_ps(lowerHemisphere, y));
+
+			const __m128 scale = _mm_set1_ps(32767.0f);
+			__m128i ix = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, minusOne), one), scale));
+			__m128i iy = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(y, minusOne), one), scale));
+			return _mm_or_si128(_mm_and_si128(ix, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(iy, 16));
+		}
+
+		template <typename Vertex>
+		static void encodeRange(const VertexAttributes* src, size_t count, Vertex* dst)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const VertexAttributes* v = src + i;
+				alignas(16) uint32_t normals[4];
+				alignas(16) uint32_t tangents[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(normals), octEncode4(
+					_mm_setr_ps(v[0].Normal.x, v[1].Normal.x, v[2].Normal.x, v[3].Normal.x),
+					_mm_setr_ps(v[0].Normal.y, v[1].Normal.y, v[2].Normal.y, v[3].Normal.y),
+					_mm_setr_ps(v[0].Normal.z, v[1].Normal.z, v[2].Normal.z, v[3].Normal.z)));
+				_mm_store_si128(reinterpret_cast<__m128i*>(tangents), octEncode4(
+					_mm_setr_ps(v[0].Tangent.x, v[1].Tangent.x, v[2].Tangent.x, v[3].Tangent.x),
+					_mm_setr_ps(v[0].Tangent.y, v[1].Tangent.y, v[2].Tangent.y, v[3].Tangent.y),
+					_mm_setr_ps(v[0].Tangent.z, v[1].Tangent.z, v[2].Tangent.z, v[3].Tangent.z)));
+
+				for (int lane = 0; lane < 4; lane++)
+				{
+					Vertex out;
+					if constexpr (std::is_same_v<Vertex, CompactVertexHalf>)
+					{
+						uint32_t xy = glm::packHalf2x16(glm::vec2(v[lane].Position));
+						uint32_t zw = glm::packHalf2x16(glm::vec2(v[lane].Position.z, 1.0f));
+						memcpy(out.Position, &xy, sizeof(xy));
+						memcpy(out.Position + 2, &zw, sizeof(zw));
+					}
+					else
+					{
+						out.Position = glm::vec3(v[lane].Position);
+					}
+					out.Normal = normals[lane];
+					out.Tangent = tangents[lane];
+					out.TextureCoordinate = glm::packHalf2x16(v[lane].TextureCoordinate);
+					out.Ids = packIds(v[lane].materialId, v[lane].meshId, v[lane].Tangent.w);
+					dst[i + lane] = out;
+				}
+			}
+			for (; i < count; i++)
+			{
+				const VertexAttributes& v = src[i];
+				Vertex out;
+				if constexpr (std::is_same_v<Vertex, CompactVertexHalf>)
+				{
+					uint32_t xy = glm::packHalf2x16(glm::vec2(v.Position));
+					uint32_t zw = glm::packHalf2x16(glm::vec2(v.Position.z, 1.0f));
+					memcpy(out.Position, &xy, sizeof(xy));
+					memcpy(out.Position + 2, &zw, sizeof(zw));
+				}
+				else
+				{
+					out.Position = glm::vec3(v.Position);
+				}
+				out.Normal = octEncode(v.Normal);
+				out.Tangent = octEncode(glm::vec3(v.Tangent));
+				out.TextureCoordinate = glm::packHalf2x16(v.TextureCoordinate);
+				out.Ids = packIds(v.materialId, v.meshId, v.Tangent.w);
+				dst[i] = out;
+			}
+		}
+
+		void encodeVertices(VertexFormat format, std::span<const VertexAttributes> vertices, void* dst)
+		{
+			if (format == VertexFormat_Full)
+			{
+				memcpy(dst, vertices.data(), vertices.size_bytes());
+				return;
+			}
+
+			size_t numChunks = (vertices.size() + ENCODE_CHUNK_SIZE - 1) / ENCODE_CHUNK_SIZE;
+			auto iter = std::views::iota(size_t(0), numChunks);
+			std::for_each(std::execution::par, iter.begin(), iter.end(), [&](size_t chunk) {
+				size_t first = chunk * ENCODE_CHUNK_SIZE;
+				size_t count = std::min(ENCODE_CHUNK_SIZE, vertices.size() - first);
+				if (format == VertexFormat_Compact)
+					encodeRange(vertices.data() + first, count, static_cast<CompactVertex*>(dst) + first);
+				else
+					encodeRange(vertices.data() + first, count, static_cast<CompactVertexHalf*>(dst) + first);
+			});
+		}
+
+		VertexAttributes decodeVertex(VertexFormat format, const void* src, size_t index)
+		{
+			auto decode = [](const auto& v, const glm::vec4& position) {
+				uint32_t material = v.Ids & NO_MATERIAL;
+				const glm::vec4 tangent(octDecode(v.Tangent), (v.Ids & TANGENT_SIGN_BIT) ? -1.0f : 1.0f);
+				return VertexAttributes(position, glm::unpackHalf2x16(v.TextureCoordinate), octDecode(v.Normal), tangent,
+					material == NO_MATERIAL ? UINT32_MAX : material, (v.Ids & ~TANGENT_SIGN_BIT) >> MATERIAL_ID_BITS);
+			};
+
+			switch (format)
+			{
+			case VertexFormat_Compact:
+			{
+				const CompactVertex& v = static_cast<const CompactVertex*>(src)[index];
+				return decode(v, glm::vec4(v.Position, 1.0f));
+			}
+			case VertexFormat_CompactHalfPosition:
+			{
+				const CompactVertexHalf& v = static_cast<const CompactVertexHalf*>(src)[index];
+				uint32_t xy, zw;
+				memcpy(&xy, v.Position, sizeof(xy));
+				memcpy(&zw, v.Position + 2, sizeof(zw));
+				return decode(v, glm::vec4(glm::unpackHalf2x16(xy), glm::unpackHalf2x16(zw)));
+			}
+			default:
+				return static_cast<const VertexAttributes*>(src)[index];
+			}
+		}
+	}
+}
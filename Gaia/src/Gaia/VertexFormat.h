@@ -0,0 +1,55 @@
+#pragma once
+#include "Gaia/LoadMesh.h"
+#include <span>
+
+namespace Gaia
+{
+	//GPU side vertex layouts. LoadMesh always decodes to VertexAttributes, the renderer encodes into the selected layout while uploading
+	enum VertexFormat : uint8_t
+	{
+		VertexFormat_Full = 0, //VertexAttributes as is, 60 bytes
+		VertexFormat_Compact, //CompactVertex, float3 position, 28 bytes
+		VertexFormat_CompactHalfPosition, //CompactVertexHalf, half4 position, 24 bytes
+	};
+
+	//normal and tangent are octahedral encoded as 2 x snorm16, the uv is 2 x half. Both ids and the sign of the tangent w share one word
+	struct CompactVertex
+	{
+		glm::vec3 Position;
+		uint32_t Normal;
+		uint32_t Tangent;
+		uint32_t TextureCoordinate;
+		uint32_t Ids;
+	};
+	struct CompactVertexHalf
+	{
+		uint16_t Position[4]; //w is always 1
+		uint32_t Normal;
+		uint32_t Tangent;
+		uint32_t TextureCoordinate;
+		uint32_t Ids;
+	};
+
+	namespace VertexEncoding
+	{
+		//ids word layout, the material id uses the low bits so the all ones value still means "no material".
+		//The top bit is set when the tangent w is negative, i.e. the uvs are mirrored
+		constexpr uint32_t MATERIAL_ID_BITS = 12;
+		constexpr uint32_t MESH_ID_BITS = 31 - MATERIAL_ID_BITS;
+		constexpr uint32_t NO_MATERIAL = (1u << MATERIAL_ID_BITS) - 1;
+		constexpr uint32_t TANGENT_SIGN_BIT = 1u << 31;
+
+		uint32_t getVertexStride(VertexFormat format);
+
+		//false if a material or mesh id of the sub meshes does not fit into the packed ids word
+		bool supportsCompactIds(std::span<const SubMesh> subMeshes);
+
+		uint32_t octEncode(const glm::vec3& direction);
+		glm::vec3 octDecode(uint32_t encoded);
+		uint32_t packIds(uint32_t materialId, uint32_t meshId, float tangentSign);
+
+		//writes vertices.size() vertices of the given layout to dst, dst may be write combined memory
+		void encodeVertices(VertexFormat format, std::span<const VertexAttributes> vertices, void* dst);
+		VertexAttributes decodeVertex(VertexFormat format, const void* src, size_t index);
+	}
+}
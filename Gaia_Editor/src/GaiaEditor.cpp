@@ -69,6 +69,7 @@ void GaiaEditor::OnImGuiRender()
 	ImGui::ShowDemoWindow(&showDemo);*/
 	DrawHierarchy();
 	DrawNodeProperties();
+	DrawMemoryStats();
 }
 
 void GaiaEditor::OnEvent(Event& e)
@@ -187,6 +188,23 @@ bool DrawVec3Control(const std::string& label, glm::vec3& values, float resetVal
 	return res || res1 || res2 || res3;
 }
 
+void GaiaEditor::DrawMemoryStats()
+{
+	//CPU copies of the scene data that are still resident after the upload (see CpuResidency)
+	const CpuMemoryStats stats = scene_->getCpuMemoryStats();
+	const char* residency[] = { "Drop", "Keep", "Spill" };
+	auto toMB = [](uint64_t bytes) { return bytes / (1024.0 * 1024.0); };
+
+	ImGui::Begin("Memory");
+	ImGui::Text("CPU residency: %s", residency[scene_->getCpuResidency()]);
+	ImGui::Text("Textures: %.1f MB", toMB(stats.textureBytes));
+	ImGui::Text("Vertices: %.1f MB", toMB(stats.vertexBytes));
+	ImGui::Text("Indices: %.1f MB", toMB(stats.indexBytes));
+	ImGui::Text("Meshlets: %.1f MB", toMB(stats.meshletBytes));
+	ImGui::Text("Spilled to disk: %.1f MB", toMB(stats.spilledBytes));
+	ImGui::End();
+}
+
 void GaiaEditor::DrawNodeProperties()
 {
 	const char* nodeName = currentSelectedNode != -1 ? scene_->getNodeNames()[currentSelectedNode].c_str() : "";
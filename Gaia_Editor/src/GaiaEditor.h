@@ -27,4 +27,5 @@ private:
 	void traverseHierarchy(int index, std::vector<Hierarchy>& sceneHierarchy, std::vector<std::string>& nodeNames);
 	void DrawHierarchy();
 	void DrawNodeProperties();
+	void DrawMemoryStats();
 };
\ No newline at end of file
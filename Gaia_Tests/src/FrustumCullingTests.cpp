@@ -0,0 +1,67 @@
+#include "Tests.h"
+#include "Gaia/Renderer/FrustumCulling.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace Gaia;
+
+namespace
+{
+	//the plane test of the SIMD kernels one box at a time, the sums run in the same order so the results are bit exact
+	bool isVisible(const SubMeshBounds& bounds, const Frustum& frustum, size_t i)
+	{
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			float distance = plane.w;
+			distance += bounds.centerX[i] * plane.x;
+			distance += bounds.centerY[i] * plane.y;
+			distance += bounds.centerZ[i] * plane.z;
+			distance += bounds.extentX[i] * std::abs(plane.x);
+			distance += bounds.extentY[i] * std::abs(plane.y);
+			distance += bounds.extentZ[i] * std::abs(plane.z);
+			if (distance < 0.0f)
+				return false;
+		}
+		return true;
+	}
+}
+
+//the AVX2 or SSE kernel picked for this cpu against the scalar test, for box counts around the 8 wide blocks and the chunks
+GAIA_TEST(cullMatchesScalarTest)
+{
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	const glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 2.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const Frustum frustum = FrustumCulling::extractFrustum(projection * view);
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.0f, 4.0f);
+	for (size_t count : { size_t(0), size_t(1), size_t(7), size_t(8), size_t(9), size_t(1023), size_t(1024), size_t(2500) })
+	{
+		SubMeshBounds bounds;
+		const size_t paddedCount = (count + 7) / 8 * 8;
+		for (std::vector<float>* component : { &bounds.centerX, &bounds.centerY, &bounds.centerZ })
+		{
+			for (size_t i = 0; i < paddedCount; i++)
+				component->push_back(position(random));
+		}
+		for (std::vector<float>* component : { &bounds.extentX, &bounds.extentY, &bounds.extentZ })
+		{
+			for (size_t i = 0; i < paddedCount; i++)
+				component->push_back(size(random));
+		}
+		bounds.count = count;
+
+		std::vector<uint8_t> visible;
+		FrustumCulling::cull(bounds, frustum, visible);
+		GAIA_CHECK(visible.size() == count);
+		bool same = true;
+		size_t numVisible = 0;
+		for (size_t i = 0; i < std::min(count, visible.size()); i++)
+		{
+			same &= visible[i] == uint8_t(isVisible(bounds, frustum, i));
+			numVisible += visible[i];
+		}
+		GAIA_CHECK(same);
+		GAIA_CHECK(count < 1000 || (numVisible > 0 && numVisible < count));
+	}
+}
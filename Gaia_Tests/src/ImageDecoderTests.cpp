@@ -0,0 +1,52 @@
+#include "Tests.h"
+#include "Gaia/LoadMesh.h"
+#include "Gaia/Trace.h"
+
+using namespace Gaia;
+
+//the stage timeline of an import (see Trace.h): with MeshLoadOptions::deferImageDecoding the first texture is processed
+//and block compressed while the ImageDecoder workers are still decoding. Twice as many images as cores keep the workers busy,
+//the geometry is not processed so the textures are reached while the decode is still going
+GAIA_TEST(imageDecodingOverlapsTextureProcessing)
+{
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Gaia_Tests_ImageDecoder";
+	std::filesystem::create_directories(directory, ec);
+	const uint32_t numImages = std::max(std::thread::hardware_concurrency(), 8u) * 2;
+	const std::string path = GaiaTests::writeTexturedScene(directory, numImages, 512, true);
+
+	const MeshLoadOptions options{
+		.useSceneCache = false,
+		.optimizeMeshes = false,
+		.lodLevels = 1,
+		.buildMeshlets = false,
+		.generateTangents = false,
+		.deferImageDecoding = true,
+		.compressTextures = true,
+	};
+	Trace::start();
+	{
+		const LoadMesh scene(path, options);
+		GAIA_CHECK(scene.gltfTextures.size() == numImages);
+	}
+	const std::vector<Trace::Event> events = Trace::stop();
+
+	uint32_t numDecoded = 0, numProcessed = 0;
+	int64_t lastDecodeEnd = 0, firstProcessBegin = std::numeric_limits<int64_t>::max();
+	for (const Trace::Event& event : events)
+	{
+		if (std::string_view(event.name) == "decode image")
+		{
+			numDecoded++;
+			lastDecodeEnd = std::max(lastDecodeEnd, event.begin + event.duration);
+		}
+		else if (std::string_view(event.name) == "process texture")
+		{
+			numProcessed++;
+			firstProcessBegin = std::min(firstProcessBegin, event.begin);
+		}
+	}
+	GAIA_CHECK(numDecoded == numImages && numProcessed == numImages);
+	GAIA_CHECK(firstProcessBegin < lastDecodeEnd);
+	std::filesystem::remove_all(directory, ec);
+}
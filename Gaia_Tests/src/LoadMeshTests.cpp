@@ -0,0 +1,93 @@
+#include "Tests.h"
+#include "Gaia/LoadMesh.h"
+
+using namespace Gaia;
+
+namespace
+{
+	std::string getFixturePath(const char* name)
+	{
+		return (std::filesystem::path(GaiaTests::getFixtureDirectory()) / name).string();
+	}
+
+	//everything the loader builds from the glTF, byte for byte
+	void checkSameScene(const LoadMesh& a, const LoadMesh& b)
+	{
+		GAIA_CHECK(!a.getVertices().empty() && !a.getIndices().empty() && !a.m_subMeshes.empty());
+		GAIA_CHECK(GaiaTests::equalBytes(a.getVertices(), b.getVertices()));
+		GAIA_CHECK(GaiaTests::equalBytes(a.getIndices(), b.getIndices()));
+		GAIA_CHECK(GaiaTests::equalBytes<SubMesh>(a.m_subMeshes, b.m_subMeshes));
+		GAIA_CHECK(GaiaTests::equalBytes<Hierarchy>(a.m_hierarchy, b.m_hierarchy));
+		GAIA_CHECK(GaiaTests::equalBytes<glm::mat4>(a.localTransforms, b.localTransforms));
+		GAIA_CHECK(GaiaTests::equalBytes<glm::mat4>(a.globalTransforms, b.globalTransforms));
+		GAIA_CHECK(GaiaTests::equalBytes<Meshlet>(a.m_meshlets, b.m_meshlets));
+		GAIA_CHECK(a.m_nodeNames == b.m_nodeNames);
+		GAIA_CHECK(a.gltfTextures.size() == b.gltfTextures.size());
+		for (size_t i = 0; i < std::min(a.gltfTextures.size(), b.gltfTextures.size()); i++)
+			GAIA_CHECK(GaiaTests::equalBytes(a.gltfTextures[i].getTexels(), b.gltfTextures[i].getTexels()));
+	}
+}
+
+//MeshLoadOptions::parallelDecode gives every primitive a disjoint range, so it must build the same scene as the serial decode
+GAIA_TEST(parallelDecodeMatchesSerialDecode)
+{
+	MeshLoadOptions decodeOnly{
+		.useSceneCache = false,
+		.optimizeMeshes = false,
+		.lodLevels = 1,
+		.buildMeshlets = false,
+		.generateTangents = false,
+		.compressTextures = false,
+		.generateMips = false,
+		.residency = CpuResidency_Keep,
+	};
+	MeshLoadOptions fullImport{
+		.useSceneCache = false,
+		.residency = CpuResidency_Keep,
+	};
+	for (MeshLoadOptions options : { decodeOnly, fullImport })
+	{
+		options.parallelDecode = false;
+		const LoadMesh serial(getFixturePath("scene.gltf"), options);
+		options.parallelDecode = true;
+		const LoadMesh parallel(getFixturePath("scene.gltf"), options);
+		checkSameScene(serial, parallel);
+	}
+}
+
+//the cooked scene is read in place from its mapping (see SceneCache::read) and has to hold exactly what the import built
+GAIA_TEST(sceneCacheMatchesImport)
+{
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Gaia_Tests";
+	std::filesystem::create_directories(directory, ec);
+	const std::filesystem::path path = directory / "scene.gltf";
+	std::filesystem::copy_file(getFixturePath("scene.gltf"), path, std::filesystem::copy_options::overwrite_existing, ec);
+	std::filesystem::remove(std::filesystem::path(path).replace_extension(".gaiascene"), ec);
+	GAIA_CHECK(!ec);
+
+	const MeshLoadOptions options{ .residency = CpuResidency_Keep };
+	const LoadMesh imported(path.string(), options);
+	const LoadMesh cooked(path.string(), options);
+	GAIA_CHECK(!imported.m_cachePath.empty() && !cooked.m_cachePath.empty());
+	GAIA_CHECK(!cooked.ownsGeometry());
+	checkSameScene(imported, cooked);
+	std::filesystem::remove_all(directory, ec);
+}
+
+//the nodes are renumbered level by level before the geometry is decoded, the vertices carry the node of their sub mesh
+GAIA_TEST(verticesCarrySortedMeshIds)
+{
+	const MeshLoadOptions options{ .useSceneCache = false, .residency = CpuResidency_Keep };
+	const LoadMesh mesh(getFixturePath("scene.gltf"), options);
+	GAIA_CHECK(!mesh.m_subMeshes.empty());
+	for (size_t node = 1; node < mesh.m_hierarchy.size(); node++)
+		GAIA_CHECK(mesh.m_hierarchy[node - 1].level <= mesh.m_hierarchy[node].level);
+
+	std::span<const LoadMesh::VertexAttributes> vertices = mesh.getVertices();
+	for (const SubMesh& subMesh : mesh.m_subMeshes)
+	{
+		for (uint32_t i = subMesh.vertexOffset; i < subMesh.vertexOffset + subMesh.vertexCount; i++)
+			GAIA_CHECK(vertices[i].meshId == static_cast<uint32_t>(subMesh.meshIndex));
+	}
+}
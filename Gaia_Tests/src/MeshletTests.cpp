@@ -0,0 +1,122 @@
+#include "Tests.h"
+#include "Gaia/MeshletBuilder.h"
+#include "Gaia/MeshOptimizer.h"
+#include "glm/gtc/constants.hpp"
+#include <array>
+#include <set>
+
+using namespace Gaia;
+
+namespace
+{
+	//uv sphere with a seam, rows x columns quads with outward facing triangles
+	void buildSphere(uint32_t rows, uint32_t columns, std::vector<VertexAttributes>& vertices, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t r = 0; r <= rows; r++)
+		{
+			for (uint32_t c = 0; c <= columns; c++)
+			{
+				const float theta = glm::pi<float>() * r / rows;
+				const float phi = 2.0f * glm::pi<float>() * c / columns;
+				const glm::vec3 position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				vertices.push_back(VertexAttributes(glm::vec4(position, 1.0f), glm::vec2(float(c) / columns, float(r) / rows), position));
+			}
+		}
+		for (uint32_t r = 0; r < rows; r++)
+		{
+			for (uint32_t c = 0; c < columns; c++)
+			{
+				const uint32_t a = r * (columns + 1) + c, b = a + 1, d = a + columns + 1, e = d + 1;
+				indices.insert(indices.end(), { a, b, d, b, e, d });
+			}
+		}
+	}
+}
+
+//every triangle of the sub mesh ends up in exactly one meshlet, with the same vertices and winding, and no meshlet exceeds the limits
+GAIA_TEST(meshletsCoverTheTriangleSet)
+{
+	std::vector<VertexAttributes> vertices;
+	std::vector<uint32_t> indices;
+	buildSphere(64, 128, vertices, indices);
+	uint32_t numVertices = uint32_t(vertices.size());
+	uint32_t numIndices = uint32_t(indices.size());
+	MeshOptimizer::optimize(vertices.data(), numVertices, indices.data(), numIndices);
+	vertices.resize(numVertices);
+	indices.resize(numIndices);
+
+	constexpr uint32_t BASE_VERTEX = 1000;
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	MeshletBuilder::build(indices, vertices, BASE_VERTEX, meshlets, meshletVertices, meshletTriangles);
+	GAIA_CHECK(!meshlets.empty());
+
+	//triangles are compared as rotations starting at their smallest index, which keeps the winding
+	auto canonical = [](uint32_t a, uint32_t b, uint32_t c) {
+		if (b < a && b < c)
+			return std::array<uint32_t, 3>{ b, c, a };
+		if (c < a && c < b)
+			return std::array<uint32_t, 3>{ c, a, b };
+		return std::array<uint32_t, 3>{ a, b, c };
+		};
+	std::multiset<std::array<uint32_t, 3>> original;
+	for (size_t i = 0; i < indices.size(); i += 3)
+		original.insert(canonical(indices[i] + BASE_VERTEX, indices[i + 1] + BASE_VERTEX, indices[i + 2] + BASE_VERTEX));
+
+	std::multiset<std::array<uint32_t, 3>> clustered;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		GAIA_CHECK(meshlet.vertexCount <= MeshletBuilder::MAX_VERTICES && meshlet.triangleCount <= MeshletBuilder::MAX_TRIANGLES);
+		GAIA_CHECK(meshlet.vertexOffset + meshlet.vertexCount <= meshletVertices.size());
+		GAIA_CHECK(meshlet.triangleOffset + meshlet.triangleCount * 3 <= meshletTriangles.size());
+		GAIA_CHECK(meshlet.triangleOffset % 4 == 0);
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			uint32_t triangle[3];
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				const uint8_t local = meshletTriangles[meshlet.triangleOffset + t * 3 + k];
+				GAIA_CHECK(local < meshlet.vertexCount);
+				triangle[k] = meshletVertices[meshlet.vertexOffset + local];
+				//the bounding sphere holds every vertex
+				const glm::vec3 position = glm::vec3(vertices[triangle[k] - BASE_VERTEX].Position);
+				GAIA_CHECK(glm::length(position - meshlet.center) <= meshlet.radius * 1.0001f);
+			}
+			clustered.insert(canonical(triangle[0], triangle[1], triangle[2]));
+		}
+	}
+	GAIA_CHECK(original == clustered);
+}
+
+//a meshlet the normal cone culls must not hold a single triangle that faces the camera
+GAIA_TEST(meshletConeCullingIsConservative)
+{
+	std::vector<VertexAttributes> vertices;
+	std::vector<uint32_t> indices;
+	buildSphere(32, 64, vertices, indices);
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	MeshletBuilder::build(indices, vertices, 0, meshlets, meshletVertices, meshletTriangles);
+
+	uint32_t numCulled = 0;
+	for (const glm::vec3 camera : { glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(3.0f, 2.0f, -1.0f), glm::vec3(0.0f, -1.5f, 0.0f) })
+	{
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (glm::dot(glm::normalize(meshlet.coneApex - camera), meshlet.coneAxis) < meshlet.coneCutoff)
+				continue;
+			numCulled++;
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				glm::vec3 p[3];
+				for (uint32_t k = 0; k < 3; k++)
+					p[k] = glm::vec3(vertices[meshletVertices[meshlet.vertexOffset + meshletTriangles[meshlet.triangleOffset + t * 3 + k]]].Position);
+				const glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+				GAIA_CHECK(glm::dot(normal, p[0] - camera) >= -1e-5f * glm::length(normal) * glm::length(p[0] - camera));
+			}
+		}
+	}
+	GAIA_CHECK(numCulled > 0);
+}
@@ -0,0 +1,110 @@
+#include "Tests.h"
+#include "Gaia/Scene/Scene.h"
+#include <random>
+
+using namespace Gaia;
+
+namespace
+{
+	//10 root nodes with 10 children each, 5 levels deep: 111110 nodes below the scene root
+	constexpr uint32_t BRANCHING = 10;
+	constexpr uint32_t DEPTH = 5;
+
+	//writes directory/hierarchy.gltf, a scene of empty nodes that only carry a translation and a rotation.
+	//The nodes are numbered level by level so the children of a node are one contiguous range
+	std::string writeHierarchyScene(const std::filesystem::path& directory)
+	{
+		std::vector<uint32_t> levelOffsets{ 0 };
+		for (uint32_t level = 0, count = BRANCHING; level < DEPTH; level++, count *= BRANCHING)
+			levelOffsets.push_back(levelOffsets.back() + count);
+
+		std::string nodes;
+		for (uint32_t level = 0; level < DEPTH; level++)
+		{
+			for (uint32_t node = levelOffsets[level]; node < levelOffsets[level + 1]; node++)
+			{
+				nodes += nodes.empty() ? "{" : ",{";
+				if (level + 1 < DEPTH)
+				{
+					const uint32_t firstChild = levelOffsets[level + 1] + (node - levelOffsets[level]) * BRANCHING;
+					nodes += "\"children\":[";
+					for (uint32_t child = firstChild; child < firstChild + BRANCHING; child++)
+						nodes += (child == firstChild ? "" : ",") + std::to_string(child);
+					nodes += "],";
+				}
+				nodes += "\"translation\":[1.5,0.25,-0.5],\"rotation\":[0,0.2588190,0,0.9659258]}";
+			}
+		}
+		std::string roots;
+		for (uint32_t node = 0; node < BRANCHING; node++)
+			roots += (node == 0 ? "" : ",") + std::to_string(node);
+
+		const std::string path = (directory / "hierarchy.gltf").string();
+		std::ofstream gltf(path);
+		gltf << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" << roots << "]}],\"nodes\":[" << nodes << "]}";
+		return path;
+	}
+
+	//best time of a few updateTransforms calls, the subset is marked dirty again before every call and is not timed
+	double measurePropagation(Scene& scene, const std::vector<int>& dirtyNodes)
+	{
+		std::vector<glm::mat4>& localTransforms = scene.getLocalTransforms();
+		double best = std::numeric_limits<double>::max();
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			for (int node : dirtyNodes)
+				scene.setTransform(node, localTransforms[node]);
+			best = std::min(best, GaiaTests::measureMilliseconds(1, [&]() { scene.updateTransforms(); }));
+			scene.takeUpdatedTransforms();
+		}
+		return best;
+	}
+}
+
+//Scene::updateTransforms on a 100k node hierarchy with the subsets a frame usually dirties: one node in a hundred scattered
+//over the tree as an animation would, one of the root subtrees as when an object is dragged and the whole scene
+GAIA_BENCHMARK(hierarchyTransformPropagation)
+{
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Gaia_Tests_Hierarchy";
+	std::filesystem::create_directories(directory, ec);
+	const std::string path = writeHierarchyScene(directory);
+
+	const SceneDescriptor desc{
+		.meshPath = path,
+		.windowWidth = 1280,
+		.windowHeight = 720,
+		.meshLoadOptions = {.useSceneCache = false },
+	};
+	Scene scene(desc);
+	const std::vector<Hierarchy>& hierarchy = scene.getHirarchy();
+	const int numNodes = static_cast<int>(hierarchy.size());
+
+	std::vector<int> scattered;
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> pickNode(1, numNodes - 1);
+	for (int i = 0; i < numNodes / 100; i++)
+		scattered.push_back(pickNode(random));
+	const std::vector<int> subtree{ 1 }; //the first node below the scene root, a tenth of the scene
+	const std::vector<int> everything{ 0 };
+
+	const double scatteredTime = measurePropagation(scene, scattered);
+	const double subtreeTime = measurePropagation(scene, subtree);
+	const double everythingTime = measurePropagation(scene, everything);
+
+	//every global transform is its parent's times the local one after the full update
+	const std::vector<glm::mat4>& localTransforms = scene.getLocalTransforms();
+	const std::vector<glm::mat4>& globalTransforms = scene.getGlobalTransforms();
+	float maxError = 0.0f;
+	for (int node = 1; node < numNodes; node++)
+	{
+		const glm::mat4 expected = globalTransforms[hierarchy[node].parent] * localTransforms[node];
+		for (int column = 0; column < 4; column++)
+			maxError = std::max(maxError, glm::length(expected[column] - globalTransforms[node][column]));
+	}
+	GAIA_CHECK(maxError < 1e-3f);
+
+	GAIA_INFO("{} nodes, {} levels: {} scattered nodes {:.3f} ms, one root subtree {:.3f} ms, all nodes {:.3f} ms",
+		numNodes, hierarchy.back().level + 1, scattered.size(), scatteredTime, subtreeTime, everythingTime);
+	std::filesystem::remove_all(directory, ec);
+}
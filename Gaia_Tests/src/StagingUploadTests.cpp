@@ -0,0 +1,103 @@
+#include "Tests.h"
+#include "Gaia/LoadMesh.h"
+#include "Gaia/TextureMips.h"
+#include "Gaia/Renderer/Vulkan/VulkanClasses.h"
+
+using namespace Gaia;
+
+namespace
+{
+	constexpr uint32_t NUM_TEXTURES = 256;
+	constexpr int TEXTURE_SIZE = 512;
+
+	std::vector<uint64_t> getLevelOffsets(const Texture& texture)
+	{
+		std::vector<uint64_t> levelOffsets(texture.numMips);
+		for (uint32_t level = 0; level < texture.numMips; level++)
+			levelOffsets[level] = TextureMips::getLevelOffset(texture, level);
+		return levelOffsets;
+	}
+
+	Holder<TextureHandle> createSceneTexture(IContext& context, const Texture& texture)
+	{
+		TextureDesc desc{
+			.type = TextureType_2D,
+			.format = Format_RGBA_SRGB8,
+			.dimensions = {uint32_t(texture.width), uint32_t(texture.height), 1},
+			.usage = TextureUsageBits_Sampled,
+			.numMipLevels = texture.numMips,
+			.storage = StorageType_Device,
+		};
+		return context.createTexture(desc);
+	}
+
+	//waits for every upload, submit() flushes the staging ring first and submits finish in order
+	void waitForUploads(IContext& context)
+	{
+		ICommandBuffer& cmdBuffer = context.acquireCommandBuffer();
+		context.wait(context.submit(cmdBuffer));
+	}
+}
+
+//time to load a scene with 256 textures and get them onto the gpu, once with a staging buffer and a blocking submit per texture
+//as createGpuMeshTexturesAndBuffers did before the staging ring and once through IContext::upload.
+//Made to run on a software driver, e.g. set VK_ICD_FILENAMES to the lavapipe (Mesa 24.2 or newer, for the ray tracing extensions
+//VulkanContext requires) or SwiftShader icd json. The context is headless, the validation layers have to be installed
+GAIA_BENCHMARK(stagingRingSceneLoad)
+{
+	std::error_code ec;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "Gaia_Tests_Staging";
+	std::filesystem::create_directories(directory, ec);
+	const std::string path = GaiaTests::writeTexturedScene(directory, NUM_TEXTURES, TEXTURE_SIZE, false);
+
+	//the texels are uploaded as RGBA8 with their mips, block compression would only hide the upload behind the encoder
+	const MeshLoadOptions options{
+		.useSceneCache = false,
+		.compressTextures = false,
+		.residency = CpuResidency_Keep,
+	};
+	std::unique_ptr<LoadMesh> scene;
+	const double import = GaiaTests::measureMilliseconds(1, [&]() {
+		scene = std::make_unique<LoadMesh>(path, options);
+		});
+	GAIA_CHECK(scene->gltfTextures.size() == NUM_TEXTURES);
+	size_t numBytes = 0;
+	for (const Texture& texture : scene->gltfTextures)
+		numBytes += texture.getTexels().size();
+
+	VulkanContext context(nullptr);
+	const double before = GaiaTests::measureMilliseconds(3, [&]() {
+		std::vector<Holder<TextureHandle>> textures;
+		for (const Texture& texture : scene->gltfTextures)
+		{
+			textures.push_back(createSceneTexture(context, texture));
+			BufferDesc stagingBufferDesc{
+				.usage_type = BufferUsageBits_Storage,
+				.storage_type = StorageType_HostVisible,
+				.size = texture.getTexels().size(),
+			};
+			Holder<BufferHandle> stagingBufferHandle = context.createBuffer(stagingBufferDesc);
+			ICommandBuffer& cmdBuffer = context.acquireCommandBuffer();
+			cmdBuffer.copyBuffer(stagingBufferHandle, const_cast<uint8_t*>(texture.getTexels().data()), texture.getTexels().size());
+			cmdBuffer.cmdTransitionImageLayout(textures.back(), ImageLayout_TRANSFER_DST_OPTIMAL);
+			cmdBuffer.cmdCopyBufferToImage(stagingBufferHandle, textures.back(), getLevelOffsets(texture));
+			cmdBuffer.cmdTransitionImageLayout(textures.back(), ImageLayout_READ_ONLY_OPTIMAL);
+			context.wait(context.submit(cmdBuffer));
+		}
+		});
+	const double after = GaiaTests::measureMilliseconds(3, [&]() {
+		std::vector<Holder<TextureHandle>> textures;
+		for (const Texture& texture : scene->gltfTextures)
+		{
+			textures.push_back(createSceneTexture(context, texture));
+			context.upload(textures.back(), texture.getTexels().data(), texture.getTexels().size(), getLevelOffsets(texture));
+		}
+		context.flushUploads();
+		waitForUploads(context);
+		});
+
+	GAIA_INFO("{} textures, {:.0f} MB with mips: import {:.0f} ms, upload per texture {:.0f} ms (load {:.0f} ms), staging ring {:.0f} ms (load {:.0f} ms)",
+		NUM_TEXTURES, numBytes / (1024.0 * 1024.0), import, before, import + before, after, import + after);
+	scene.reset();
+	std::filesystem::remove_all(directory, ec);
+}
@@ -0,0 +1,132 @@
+#include "Tests.h"
+#include "Gaia/TangentGenerator.h"
+#include "Gaia/LoadMesh.h"
+#include "Gaia/VertexFormat.h"
+#include "glm/gtc/constants.hpp"
+
+using namespace Gaia;
+
+namespace
+{
+	//uv sphere whose rows stop short of the poles, u runs along the longitude so the exact tangent is d position / d phi
+	struct ReferenceMesh
+	{
+		std::vector<float> positions;
+		std::vector<float> normals;
+		std::vector<float> texCoords;
+		std::vector<uint32_t> indices;
+		uint32_t vertexCount = 0;
+	};
+
+	ReferenceMesh buildSphere(uint32_t rows, uint32_t columns)
+	{
+		ReferenceMesh mesh;
+		for (uint32_t r = 0; r <= rows; r++)
+		{
+			for (uint32_t c = 0; c <= columns; c++)
+			{
+				const float theta = glm::pi<float>() * (r + 0.5f) / (rows + 1);
+				const float phi = 2.0f * glm::pi<float>() * c / columns;
+				const glm::vec3 position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				mesh.positions.insert(mesh.positions.end(), { position.x, position.y, position.z });
+				mesh.normals.insert(mesh.normals.end(), { position.x, position.y, position.z });
+				mesh.texCoords.insert(mesh.texCoords.end(), { float(c) / columns, float(r) / rows });
+			}
+		}
+		for (uint32_t r = 0; r < rows; r++)
+		{
+			for (uint32_t c = 0; c < columns; c++)
+			{
+				const uint32_t a = r * (columns + 1) + c, b = a + 1, d = a + columns + 1, e = d + 1;
+				mesh.indices.insert(mesh.indices.end(), { a, d, b, b, d, e });
+			}
+		}
+		mesh.vertexCount = (rows + 1) * (columns + 1);
+		return mesh;
+	}
+}
+
+//the tangents follow the analytic ones of the sphere and mirrored uvs flip the handedness
+GAIA_TEST(tangentsMatchTheAnalyticFrame)
+{
+	constexpr uint32_t ROWS = 64, COLUMNS = 128;
+	ReferenceMesh mesh = buildSphere(ROWS, COLUMNS);
+	std::vector<glm::vec4> tangents(mesh.vertexCount);
+	TangentGenerator::generate(mesh.indices, mesh.positions.data(), mesh.normals.data(), mesh.texCoords.data(), mesh.vertexCount, tangents.data());
+
+	float maxError = 0.0f;
+	for (uint32_t r = 0; r <= ROWS; r++)
+	{
+		for (uint32_t c = 0; c <= COLUMNS; c++)
+		{
+			const float phi = 2.0f * glm::pi<float>() * c / COLUMNS;
+			const glm::vec3 expected = glm::vec3(-std::sin(phi), 0.0f, std::cos(phi));
+			maxError = std::max(maxError, glm::length(glm::vec3(tangents[r * (COLUMNS + 1) + c]) - expected));
+		}
+	}
+	//the seam vertices only see the triangles on one side, their tangent is off by half a column
+	GAIA_CHECK(maxError < 1.01f * glm::pi<float>() / COLUMNS);
+
+	for (size_t i = 0; i < mesh.texCoords.size(); i += 2)
+		mesh.texCoords[i] = 1.0f - mesh.texCoords[i];
+	std::vector<glm::vec4> mirrored(mesh.vertexCount);
+	TangentGenerator::generate(mesh.indices, mesh.positions.data(), mesh.normals.data(), mesh.texCoords.data(), mesh.vertexCount, mirrored.data());
+	for (uint32_t v = 0; v < mesh.vertexCount; v++)
+	{
+		GAIA_CHECK(glm::length(glm::vec3(mirrored[v]) + glm::vec3(tangents[v])) < 0.01f);
+		GAIA_CHECK(mirrored[v].w == -tangents[v].w);
+	}
+}
+
+//the same quad twice, the second with u mirrored (see fixtures/mirrored_uvs.gltf). The frame the g buffer shader builds from a
+//vertex, tangent xyz and bitangent cross(normal, tangent) * w, has to follow the uvs for every vertex layout
+GAIA_TEST(vertexTangentsKeepTheHandedness)
+{
+	const MeshLoadOptions options{
+		.useSceneCache = false,
+		.lodLevels = 1,
+		.buildMeshlets = false,
+		.generateTangents = true,
+		.residency = CpuResidency_Keep,
+	};
+	const LoadMesh mesh((std::filesystem::path(GaiaTests::getFixtureDirectory()) / "mirrored_uvs.gltf").string(), options);
+	GAIA_CHECK(mesh.m_subMeshes.size() == 2);
+	if (mesh.m_subMeshes.size() != 2)
+		return;
+
+	const glm::vec3 positionAlongU[2] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f) };
+	const glm::vec3 positionAlongV = glm::vec3(0.0f, 0.0f, 1.0f);
+	float handedness[2] = {};
+	for (VertexFormat format : { VertexFormat_Full, VertexFormat_Compact, VertexFormat_CompactHalfPosition })
+	{
+		std::vector<uint8_t> encoded(mesh.getVertices().size() * VertexEncoding::getVertexStride(format));
+		VertexEncoding::encodeVertices(format, mesh.getVertices(), encoded.data());
+		for (uint32_t s = 0; s < 2; s++)
+		{
+			const SubMesh& subMesh = mesh.m_subMeshes[s];
+			for (uint32_t i = subMesh.vertexOffset; i < subMesh.vertexOffset + subMesh.vertexCount; i++)
+			{
+				const VertexAttributes v = VertexEncoding::decodeVertex(format, encoded.data(), i);
+				const glm::vec3 tangent = glm::vec3(v.Tangent);
+				const glm::vec3 bitangent = glm::cross(v.Normal, tangent) * v.Tangent.w;
+				GAIA_CHECK(std::abs(v.Tangent.w) == 1.0f);
+				GAIA_CHECK(glm::dot(tangent, positionAlongU[s]) > 0.99f);
+				GAIA_CHECK(glm::dot(bitangent, positionAlongV) > 0.99f);
+				handedness[s] = v.Tangent.w;
+			}
+		}
+		GAIA_CHECK(handedness[0] == -handedness[1]);
+	}
+}
+
+//single threaded throughput on a 1M triangle sphere, LoadMesh runs one primitive per core on top of this
+GAIA_BENCHMARK(tangentGeneratorThroughput)
+{
+	const ReferenceMesh mesh = buildSphere(512, 1024);
+	std::vector<glm::vec4> tangents(mesh.vertexCount);
+	const double milliseconds = GaiaTests::measureMilliseconds(5, [&]() {
+		TangentGenerator::generate(mesh.indices, mesh.positions.data(), mesh.normals.data(), mesh.texCoords.data(), mesh.vertexCount, tangents.data());
+		});
+	const double numTriangles = double(mesh.indices.size() / 3);
+	GAIA_INFO("TangentGenerator: {} triangles in {:.2f} ms, {:.2f} M triangles/s", size_t(numTriangles), milliseconds, numTriangles / milliseconds / 1000.0);
+}
@@ -0,0 +1,127 @@
+#include "Tests.h"
+#include "Gaia/GltfLoader/stb_image_write.h"
+#include <fstream>
+
+namespace GaiaTests
+{
+	namespace
+	{
+		uint32_t numFailures = 0;
+		std::string fixtureDirectory = "fixtures";
+	}
+
+	std::vector<TestCase>& getTestCases()
+	{
+		//function local so the registrations of every source file can run first
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	TestRegistration::TestRegistration(const char* name, TestFunction function, bool isBenchmark)
+	{
+		getTestCases().push_back(TestCase{ .name = name, .function = function, .isBenchmark = isBenchmark });
+	}
+
+	void reportFailure(const char* expression, const char* file, int line)
+	{
+		numFailures++;
+		GAIA_ERROR("{}({}): check failed: {}", file, line, expression);
+	}
+
+	const std::string& getFixtureDirectory()
+	{
+		return fixtureDirectory;
+	}
+
+	std::string writeTexturedScene(const std::filesystem::path& directory, uint32_t numTextures, int textureSize, bool noisy)
+	{
+		const float positions[] = { -1, 0, -1,  1, 0, -1,  1, 0, 1,  -1, 0, 1 };
+		const float normals[] = { 0, 1, 0,  0, 1, 0,  0, 1, 0,  0, 1, 0 };
+		const float texCoords[] = { 0, 0,  1, 0,  1, 1,  0, 1 };
+		const uint32_t indices[] = { 0, 2, 1, 0, 3, 2 };
+		std::ofstream bin(directory / "scene.bin", std::ios::binary);
+		bin.write(reinterpret_cast<const char*>(positions), sizeof(positions));
+		bin.write(reinterpret_cast<const char*>(normals), sizeof(normals));
+		bin.write(reinterpret_cast<const char*>(texCoords), sizeof(texCoords));
+		bin.write(reinterpret_cast<const char*>(indices), sizeof(indices));
+		bin.close();
+
+		//the texels differ between textures so none of them are shared
+		std::mt19937 random(7);
+		std::vector<uint8_t> rgba(size_t(textureSize) * textureSize * 4);
+		for (uint32_t t = 0; t < numTextures; t++)
+		{
+			for (int y = 0; y < textureSize; y++)
+			{
+				for (int x = 0; x < textureSize; x++)
+				{
+					uint8_t* texel = &rgba[(size_t(y) * textureSize + x) * 4];
+					texel[0] = uint8_t(x + t);
+					texel[1] = uint8_t(y + t * 3);
+					texel[2] = noisy ? uint8_t(random()) : uint8_t(x ^ y);
+					texel[3] = 0xFF;
+				}
+			}
+			const std::string name = (directory / ("texture" + std::to_string(t) + ".png")).string();
+			stbi_write_png(name.c_str(), textureSize, textureSize, 4, rgba.data(), textureSize * 4);
+		}
+
+		std::string primitives, materials, textures, images;
+		for (uint32_t t = 0; t < numTextures; t++)
+		{
+			const char* separator = t == 0 ? "" : ",";
+			primitives += fmt::format("{}{{\"attributes\":{{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2}},\"indices\":3,\"material\":{}}}", separator, t);
+			materials += fmt::format("{}{{\"name\":\"Material{}\",\"pbrMetallicRoughness\":{{\"baseColorTexture\":{{\"index\":{}}}}}}}", separator, t, t);
+			textures += fmt::format("{}{{\"source\":{}}}", separator, t);
+			images += fmt::format("{}{{\"uri\":\"texture{}.png\"}}", separator, t);
+		}
+		const std::filesystem::path path = directory / "scene.gltf";
+		std::ofstream gltf(path);
+		gltf << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"Gaia_Tests fixture\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+			"\"nodes\":[{\"name\":\"Quads\",\"mesh\":0}],"
+			"\"meshes\":[{\"name\":\"Quads\",\"primitives\":[" << primitives << "]}],"
+			"\"materials\":[" << materials << "],\"textures\":[" << textures << "],\"images\":[" << images << "],"
+			"\"buffers\":[{\"uri\":\"scene.bin\",\"byteLength\":152}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":48},{\"buffer\":0,\"byteOffset\":48,\"byteLength\":48},"
+			"{\"buffer\":0,\"byteOffset\":96,\"byteLength\":32},{\"buffer\":0,\"byteOffset\":128,\"byteLength\":24}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\",\"min\":[-1,0,-1],\"max\":[1,0,1]},"
+			"{\"bufferView\":1,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+			"{\"bufferView\":2,\"componentType\":5126,\"count\":4,\"type\":\"VEC2\"},"
+			"{\"bufferView\":3,\"componentType\":5125,\"count\":6,\"type\":\"SCALAR\"}]}";
+		return path.string();
+	}
+}
+
+//Gaia_Tests [--bench] [--fixtures <directory>] [name filter]
+int main(int argc, char** argv)
+{
+	Gaia::Log::init();
+	bool runBenchmarks = false;
+	std::string filter;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--bench")
+			runBenchmarks = true;
+		else if (argument == "--fixtures" && i + 1 < argc)
+			GaiaTests::fixtureDirectory = argv[++i];
+		else
+			filter = argument;
+	}
+
+	uint32_t numRun = 0;
+	uint32_t numFailed = 0;
+	for (const GaiaTests::TestCase& testCase : GaiaTests::getTestCases())
+	{
+		if (testCase.isBenchmark != runBenchmarks || std::string_view(testCase.name).find(filter) == std::string_view::npos)
+			continue;
+		const uint32_t failuresBefore = GaiaTests::numFailures;
+		testCase.function();
+		numRun++;
+		const bool passed = GaiaTests::numFailures == failuresBefore;
+		numFailed += passed ? 0 : 1;
+		GAIA_INFO("[{}] {}", passed ? "PASS" : "FAIL", testCase.name);
+	}
+	GAIA_INFO("{} of {} {} passed", numRun - numFailed, numRun, runBenchmarks ? "benchmarks" : "tests");
+	return numFailed == 0 ? 0 : 1;
+}
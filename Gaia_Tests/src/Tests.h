@@ -0,0 +1,57 @@
+#pragma once
+#include "Gaia/Log.h"
+#include <span>
+
+//a minimal runner for the engine's CPU side code: tests check results and fail the run, benchmarks only print their
+//numbers and run with --bench. Every test source registers its cases with GAIA_TEST / GAIA_BENCHMARK
+namespace GaiaTests
+{
+	using TestFunction = void(*)();
+
+	struct TestCase
+	{
+		const char* name = nullptr;
+		TestFunction function = nullptr;
+		bool isBenchmark = false;
+	};
+
+	std::vector<TestCase>& getTestCases();
+
+	struct TestRegistration
+	{
+		TestRegistration(const char* name, TestFunction function, bool isBenchmark);
+	};
+
+	void reportFailure(const char* expression, const char* file, int line);
+
+	//directory of the glTF fixtures, "fixtures" next to the project unless --fixtures is given
+	const std::string& getFixtureDirectory();
+
+	//writes directory/scene.gltf with one quad per texture, every quad has its own material with its own base color png.
+	//Noisy texels make the pngs slow to decode, the default gradients encode and decode quickly. Returns the path of the glTF
+	std::string writeTexturedScene(const std::filesystem::path& directory, uint32_t numTextures, int textureSize, bool noisy);
+
+	//best wall clock time of a few runs in milliseconds, the first run also warms the caches
+	template<typename Function>
+	inline double measureMilliseconds(uint32_t repetitions, Function&& function)
+	{
+		double best = std::numeric_limits<double>::max();
+		for (uint32_t i = 0; i < repetitions; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	template<typename T>
+	inline bool equalBytes(std::span<const T> a, std::span<const T> b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size_bytes()) == 0);
+	}
+}
+
+#define GAIA_TEST(name) static void name(); static GaiaTests::TestRegistration name##Registration(#name, name, false); static void name()
+#define GAIA_BENCHMARK(name) static void name(); static GaiaTests::TestRegistration name##Registration(#name, name, true); static void name()
+#define GAIA_CHECK(x) { if (!(x)) GaiaTests::reportFailure(#x, __FILE__, __LINE__); }
@@ -0,0 +1,40 @@
+#include "Tests.h"
+#include "Gaia/Renderer/TextureRegistry.h"
+
+using namespace Gaia;
+
+namespace
+{
+	Texture makeTexture(uint8_t value)
+	{
+		Texture texture{ .width = 4, .height = 4 };
+		texture.textureData.assign(4 * 4 * 4, value);
+		return texture;
+	}
+}
+
+//with hashContents images of different assets share a slot only when their texels are equal, without it only the
+//references to the same source image of one asset do
+GAIA_TEST(textureRegistrySharesEqualTexels)
+{
+	const Texture texture = makeTexture(7);
+	const Texture sameTexels = makeTexture(7);
+	Texture oneTexelOff = makeTexture(7);
+	oneTexelOff.textureData.back() = 8;
+
+	TextureRegistry byContent(true);
+	byContent.beginAsset();
+	const TextureRegistry::Slot first = byContent.acquire(texture, 0, Format_RGBA_UN8);
+	GAIA_CHECK(first.isNew && byContent.acquire(texture, 0, Format_RGBA_UN8).index == first.index);
+	byContent.beginAsset();
+	const TextureRegistry::Slot shared = byContent.acquire(sameTexels, 0, Format_RGBA_UN8);
+	GAIA_CHECK(!shared.isNew && shared.index == first.index);
+	GAIA_CHECK(byContent.acquire(oneTexelOff, 1, Format_RGBA_UN8).isNew);
+	GAIA_CHECK(byContent.acquire(sameTexels, 2, Format_RGBA_SRGB8).isNew);
+
+	TextureRegistry bySource;
+	bySource.beginAsset();
+	GAIA_CHECK(bySource.acquire(texture, 0, Format_RGBA_UN8).isNew);
+	bySource.beginAsset();
+	GAIA_CHECK(bySource.acquire(sameTexels, 0, Format_RGBA_UN8).isNew);
+}
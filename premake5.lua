@@ -155,6 +155,12 @@ project "Gaia"
 			"PX_PHYSX_STATIC_LIB"
 		}
 
+		--the SPIR-V the renderer loads is rebuilt from the GLSL sources, so it can not fall behind a shader edit
+		prebuildcommands
+		{
+			"cd src\\Gaia\\Renderer\\Shaders && call compile.bat nopause"
+		}
+
 
 	filter "configurations:Debug"
 		defines "GAIA_DEBUG"
@@ -229,3 +235,56 @@ project "Gaia_Editor"
 		defines "GAIA_DIST"
 		runtime "Release"
 		optimize "On"
+
+project "Gaia_Tests"
+
+	location "Gaia_Tests"
+	kind "ConsoleApp"
+	language "c++"
+	staticruntime "off"
+	cppdialect "c++20"
+
+	targetdir ("bin/"..outputdir.."/%{prj.name}")
+	objdir ("bin-int/"..outputdir.."/%{prj.name}")
+
+	--run from the project directory so the default fixture directory resolves
+	debugdir "%{prj.name}"
+
+	files
+	{
+		"%{prj.name}/src/**.h",
+		"%{prj.name}/src/**.cpp",
+		"%{prj.name}/fixtures/**.gltf"
+	}
+	includedirs
+	{
+		"$(VULKAN_SDK)/include",
+		"Gaia/vendor/spdlog/include",
+		"%{IncludeDir.glm}",
+		"Gaia/src",
+	}
+	links "Gaia"
+
+	filter "system:windows"
+		
+		systemversion "latest"
+
+		defines
+		{
+			"GAIA_PLATFORM_WINDOWS"
+		}
+		
+	filter "configurations:Debug"
+		defines "GAIA_DEBUG"
+		runtime "Debug"
+		symbols "On"
+
+	filter "configurations:Release"
+		defines "GAIA_RELEASE"
+		runtime "Release"
+		optimize "On"
+
+	filter "configurations:Dist"
+		defines "GAIA_DIST"
+		runtime "Release"
+		optimize "On"